@@ -0,0 +1,100 @@
+#include "common/binary_log.hpp"
+#include "common/logger.hpp"
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace chat;
+
+namespace {
+
+/**
+ * @brief 在 threads 个线程上各执行 ops 次 fn，返回每次操作的平均耗时（纳秒）
+ *
+ * 每个线程先预热 ops 次（创建线程局部缓冲、触碰内存页），再计时执行 ops 次
+ */
+template <typename Fn>
+double runBenchmark(size_t threads, size_t ops, Fn&& fn) {
+    std::vector<std::thread> workers;
+    std::vector<double> nanos(threads);
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&fn, &nanos, t, ops]() {
+            for (size_t i = 0; i < ops; ++i) {
+                fn(i);
+            }
+            auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < ops; ++i) {
+                fn(i);
+            }
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            nanos[t] = std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(ops);
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    double total = 0;
+    for (double value : nanos) {
+        total += value;
+    }
+    return total / static_cast<double>(threads);
+}
+
+} // namespace
+
+/**
+ * @brief 对比消息路径上的两种日志方式
+ *
+ * 异步 Logger：调用点拼接字符串并格式化时间，再放入无锁队列；
+ * BinaryLogger：调用点只拷贝格式编号、时间戳和参数的原始字节
+ *
+ * 队列和环形缓冲足以容纳全部记录，测得的是调用线程的开销
+ *
+ * 用法：binary_log_bench [threads] [operations_per_thread]
+ */
+int main(int argc, char* argv[]) {
+    size_t threads = (argc > 1) ? std::stoul(argv[1]) : 1;
+    size_t ops = (argc > 2) ? std::stoul(argv[2]) : 10000;
+    const std::string textLog = "binary_log_bench.log";
+    const std::string binaryLog = "binary_log_bench.blog";
+    std::string room = "lobby";
+    std::string user = "alice";
+
+    Logger::getInstance().setLogFile(textLog);
+    LoggerOptions options;
+    options.mode = LogMode::Async;
+    options.queueCapacity = 2 * threads * ops;
+    Logger::getInstance().configure(options);
+    double text = runBenchmark(threads, ops, [&](size_t i) {
+        CHAT_LOG_INFO("message #" + std::to_string(i) + " room=" + room + " user=" + user +
+                      " bytes=" + std::to_string(i % 300));
+    });
+    LoggerStats textStats = Logger::getInstance().getStats();
+    Logger::getInstance().configure(LoggerOptions());
+
+    BinaryLogOptions binaryOptions;
+    binaryOptions.bufferBytes = 2 * ops * 64;
+    BinaryLogger::getInstance().open(binaryLog, binaryOptions);
+    double binary = runBenchmark(threads, ops, [&](size_t i) {
+        CHAT_BLOG_INFO("message #{} room={} user={} bytes={}", i, room, user, i % 300);
+    });
+    BinaryLogger::getInstance().close();
+    BinaryLogStats binaryStats = BinaryLogger::getInstance().getStats();
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "threads                  : " << threads << std::endl;
+    std::cout << "async Logger             : " << std::setw(8) << text << " ns/op (" << textStats.dropped
+              << " dropped)" << std::endl;
+    std::cout << "BinaryLogger             : " << std::setw(8) << binary << " ns/op (" << binaryStats.dropped
+              << " dropped, " << std::setprecision(1)
+              << static_cast<double>(binaryStats.bytesWritten) / static_cast<double>(binaryStats.written)
+              << " bytes/record on disk)" << std::endl;
+
+    std::remove(textLog.c_str());
+    std::remove(binaryLog.c_str());
+    return 0;
+}
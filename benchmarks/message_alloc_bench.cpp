@@ -0,0 +1,142 @@
+#include "common/message.hpp"
+#include "common/slab_allocator.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+using namespace chat;
+
+namespace {
+
+/// 全局 operator new 的调用次数
+std::atomic<uint64_t> heapCalls{0};
+
+/**
+ * @brief 基准结果
+ */
+struct Result {
+    double nanosPerOp;      ///< 每次操作的平均耗时（纳秒）
+    double heapCallsPerOp;  ///< 每次操作调用 operator new 的平均次数
+};
+
+/**
+ * @brief 预热后执行 ops 次操作，统计耗时和堆分配次数
+ */
+template <typename Fn>
+Result runBenchmark(size_t ops, Fn&& fn) {
+    for (size_t i = 0; i < ops / 10; ++i) {
+        fn(i);
+    }
+    uint64_t calls = heapCalls.load();
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < ops; ++i) {
+        fn(i);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return {std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(ops),
+            static_cast<double>(heapCalls.load() - calls) / static_cast<double>(ops)};
+}
+
+/**
+ * @brief 输出一行结果
+ */
+void report(const char* name, const Result& result) {
+    std::cout << std::left << std::setw(28) << name << std::right << std::setw(10) << result.nanosPerOp
+              << " ns/op" << std::setw(10) << result.heapCallsPerOp << " malloc/op" << std::endl;
+}
+
+} // namespace
+
+/**
+ * @brief 统计所有堆分配的次数
+ */
+void* operator new(size_t size) {
+    heapCalls.fetch_add(1, std::memory_order_relaxed);
+    if (void* pointer = std::malloc(size == 0 ? 1 : size)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    std::free(pointer);
+}
+
+/**
+ * @brief 对比通用堆与 SlabPool 的消息内容分配，以及复用解析缓冲的效果
+ *
+ * 历史：模拟内存历史按先进先出移出旧消息、追加新消息的稳态；
+ * 解析：每条消息新建 Message 与解析进每个连接复用的 Message
+ *
+ * 用法：message_alloc_bench [messages_in_memory] [operations]
+ */
+int main(int argc, char* argv[]) {
+    size_t resident = (argc > 1) ? std::stoul(argv[1]) : 100000;
+    size_t ops = (argc > 2) ? std::stoul(argv[2]) : 2000000;
+
+    // 长度 20 到 300 字节的消息内容，超出短字符串优化
+    std::vector<std::string> contents;
+    for (size_t i = 0; i < 1024; ++i) {
+        contents.push_back(std::string(20 + (i * 37) % 280, 'a' + static_cast<char>(i % 26)));
+    }
+
+    std::deque<std::string> heapQueue(resident, contents[0]);
+    Result heap = runBenchmark(ops, [&](size_t i) {
+        heapQueue.pop_front();
+        heapQueue.emplace_back(contents[i % contents.size()]);
+    });
+
+    SlabPool pool;
+    std::deque<SlabString> slabQueue;
+    for (size_t i = 0; i < resident; ++i) {
+        slabQueue.emplace_back(contents[0].data(), contents[0].size(), SlabAllocator<char>(&pool));
+    }
+    Result slab = runBenchmark(ops, [&](size_t i) {
+        const std::string& content = contents[i % contents.size()];
+        slabQueue.pop_front();
+        slabQueue.emplace_back(content.data(), content.size(), SlabAllocator<char>(&pool));
+    });
+
+    std::vector<std::string> frames;
+    for (size_t i = 0; i < contents.size(); ++i) {
+        Message msg("user" + std::to_string(i % 100), contents[i]);
+        msg.room = "lobby";
+        frames.push_back(msg.toBinary());
+    }
+    size_t checksum = 0;
+    Result fresh = runBenchmark(ops, [&](size_t i) {
+        Message message("", "");
+        Message::parseBinary(frames[i % frames.size()], message);
+        checksum += message.content.size();
+    });
+    Message scratch("", "");
+    Result reused = runBenchmark(ops, [&](size_t i) {
+        Message::parseBinary(frames[i % frames.size()], scratch);
+        checksum += scratch.content.size();
+    });
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "resident messages           : " << resident << std::endl;
+    report("history std::string", heap);
+    report("history SlabString", slab);
+    report("parse into new Message", fresh);
+    report("parse into scratch Message", reused);
+    SlabStats stats = pool.getStats();
+    std::cout << "slab chunks                 : " << stats.chunks << " (" << stats.reservedBytes / 1024
+              << " KiB reserved, " << stats.usedBytes / 1024 << " KiB used)" << std::endl;
+    // 防止编译器优化掉解析结果
+    if (checksum == 0) {
+        std::cerr << "unexpected checksum" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,114 @@
+#include "common/message.hpp"
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace chat;
+
+namespace {
+
+/**
+ * @brief 旧版基于 stringstream 的解析实现，仅作为基准对照
+ */
+Message legacyFromString(const std::string& str) {
+    if (str.empty() || str.find('@') == std::string::npos || str.find('|') == std::string::npos) {
+        throw std::runtime_error("Invalid message format: missing required separators");
+    }
+
+    std::stringstream ss(str);
+    std::string username, content, timeStr;
+
+    std::getline(ss, username, '@');
+    username = username.substr(0, username.find_last_not_of(" \t") + 1);
+
+    std::getline(ss, content, '|');
+    content = content.substr(content.find_first_not_of(" \t"),
+                             content.find_last_not_of(" \t") - content.find_first_not_of(" \t") + 1);
+
+    std::getline(ss, timeStr);
+    timeStr = timeStr.substr(timeStr.find_first_not_of(" \t"));
+
+    Message msg(username, content);
+    std::tm tm = {};
+    std::stringstream timeStream(timeStr);
+    timeStream >> std::get_time(&tm, "%Y-%m-%d %H:%M:%S");
+    if (timeStream.fail()) {
+        throw std::runtime_error("Invalid message format: invalid timestamp format");
+    }
+    msg.timestamp = std::mktime(&tm);
+    return msg;
+}
+
+/**
+ * @brief 运行基准并返回每条消息的平均耗时（纳秒）
+ */
+template <typename Fn>
+double runBenchmark(const std::vector<std::string>& lines, int rounds, Fn&& fn) {
+    size_t checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        for (const auto& line : lines) {
+            checksum += fn(line);
+        }
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    // 防止编译器优化掉解析结果
+    if (checksum == 0) {
+        std::cerr << "unexpected checksum" << std::endl;
+    }
+    double ns = std::chrono::duration<double, std::nano>(elapsed).count();
+    return ns / (static_cast<double>(lines.size()) * rounds);
+}
+
+} // namespace
+
+/**
+ * @brief 对比旧版 fromString、单遍 parse 与二进制 parseBinary 的吞吐量
+ *
+ * 用法：message_parse_bench [rounds]
+ */
+int main(int argc, char* argv[]) {
+    int rounds = (argc > 1) ? std::stoi(argv[1]) : 200;
+
+    // 构造一批典型的聊天帧，时间戳跨越多个小时
+    std::vector<std::string> lines;
+    for (int i = 0; i < 1000; ++i) {
+        char timeStr[32];
+        std::snprintf(timeStr, sizeof(timeStr), "2025-04-16 %02d:%02d:%02d", (i / 60) % 24, i % 60, (i * 7) % 60);
+        lines.push_back("user" + std::to_string(i % 50) + " @ hello world, this is message #" +
+                        std::to_string(i) + " | " + timeStr);
+    }
+
+    double legacyNs = runBenchmark(lines, rounds, [](const std::string& line) {
+        return legacyFromString(line).content.size();
+    });
+
+    Message reused("", "");
+    double parseNs = runBenchmark(lines, rounds, [&reused](const std::string& line) {
+        return Message::parse(line, reused) == ParseError::None ? reused.content.size() : 0;
+    });
+
+    // 同一批消息的二进制编码
+    std::vector<std::string> frames;
+    for (const auto& line : lines) {
+        frames.push_back(Message::fromString(line).toBinary());
+    }
+    double binaryNs = runBenchmark(frames, rounds, [&reused](const std::string& frame) {
+        return Message::parseBinary(frame, reused) == ParseError::None ? reused.content.size() : 0;
+    });
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "legacy fromString   : " << legacyNs << " ns/msg ("
+              << 1e9 / legacyNs << " msg/s)" << std::endl;
+    std::cout << "Message::parse      : " << parseNs << " ns/msg ("
+              << 1e9 / parseNs << " msg/s)" << std::endl;
+    std::cout << "Message::parseBinary: " << binaryNs << " ns/msg ("
+              << 1e9 / binaryNs << " msg/s)" << std::endl;
+    std::cout << "speedup             : " << legacyNs / parseNs << "x" << std::endl;
+    return 0;
+}
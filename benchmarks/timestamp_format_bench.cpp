@@ -0,0 +1,69 @@
+#include "common/clock.hpp"
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+
+using namespace chat;
+
+namespace {
+
+/**
+ * @brief 运行基准并返回每次格式化的平均耗时（纳秒）
+ *
+ * 时间戳每 perSecond 次调用前进一秒，模拟广播风暴下同一秒内的大量消息。
+ */
+template <typename Fn>
+double runBenchmark(int iterations, int perSecond, Fn&& fn) {
+    time_t base = 1744768800;  // 2025-04-16
+    size_t checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        checksum += fn(base + i / perSecond);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    // 防止编译器优化掉格式化结果
+    if (checksum == 0) {
+        std::cerr << "unexpected checksum" << std::endl;
+    }
+    return std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+}
+
+} // namespace
+
+/**
+ * @brief 对比 localtime + strftime 与 Clock::format 的格式化开销
+ *
+ * 用法：timestamp_format_bench [iterations] [messages_per_second]
+ */
+int main(int argc, char* argv[]) {
+    int iterations = (argc > 1) ? std::stoi(argv[1]) : 2000000;
+    int perSecond = (argc > 2) ? std::stoi(argv[2]) : 1000;
+
+    double legacyNs = runBenchmark(iterations, perSecond, [](time_t t) {
+        char timeStr[20];
+        std::strftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M:%S", std::localtime(&t));
+        return static_cast<size_t>(timeStr[18]);
+    });
+
+    double clockNs = runBenchmark(iterations, perSecond, [](time_t t) {
+        char timeStr[20];
+        std::string_view formatted = Clock::format(t);
+        std::memcpy(timeStr, formatted.data(), formatted.size());
+        return static_cast<size_t>(timeStr[18]);
+    });
+
+    // 每次都换秒的最坏情况：缓存只节省 localtime 调用
+    double missNs = runBenchmark(iterations, 1, [](time_t t) {
+        return static_cast<size_t>(Clock::format(t)[18]);
+    });
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "localtime+strftime : " << legacyNs << " ns/call" << std::endl;
+    std::cout << "Clock::format      : " << clockNs << " ns/call ("
+              << perSecond << " calls/s)" << std::endl;
+    std::cout << "Clock::format miss : " << missNs << " ns/call (1 call/s)" << std::endl;
+    std::cout << "speedup            : " << legacyNs / clockNs << "x" << std::endl;
+    return 0;
+}
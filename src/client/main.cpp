@@ -50,7 +50,7 @@ int main(int argc, char* argv[]) {
     
     // 初始化日志系统
     Logger::getInstance().setLogFile("chat_client.log");
-    Logger::getInstance().log("Client starting...");
+    CHAT_LOG_INFO("Client starting...");
     
     // 创建聊天客户端
     ChatClient client(username);
@@ -59,6 +59,9 @@ int main(int argc, char* argv[]) {
     client.setMessageCallback([username](const Message& msg) {
         // 只有当消息不是自己发送的时才显示
         if (msg.username != username) {
+            if (!msg.room.empty()) {
+                std::cout << "[" << msg.room << "] ";
+            }
             std::cout << msg.toString() << std::endl;
             std::cout << "💬: ";  // 重新显示输入提示
             std::cout.flush();
@@ -72,6 +75,11 @@ int main(int argc, char* argv[]) {
     // 显示连接信息和使用说明
     std::cout << "Connected to " << uri << std::endl;
     std::cout << "Type your message and press Enter to send" << std::endl;
+    std::cout << "Type /join <room> or /leave <room> to switch rooms" << std::endl;
+    std::cout << "Type /history <room> [count] [before <time> | between <from> <to> | next <cursor>] for history"
+              << std::endl;
+    std::cout << "Type /search <room> [count] <words or \"phrase\"> to search history" << std::endl;
+    std::cout << "Type /from <room> <user> [count] [next <cursor>] to list a user's messages" << std::endl;
     std::cout << "Type \\quit or \\exit to quit" << std::endl;
     
     // 处理用户输入
@@ -13,7 +13,7 @@ namespace chat {
  * @param username 客户端用户名
  */
 ChatClient::ChatClient(const std::string& username)
-    : username(username), connected(false) {
+    : username(username), connected(false), format(WireFormat::Text) {
     // 设置日志级别
     client.set_access_channels(websocketpp::log::alevel::none);
     client.set_error_channels(websocketpp::log::elevel::fatal);
@@ -50,10 +50,16 @@ void ChatClient::connect(const std::string& uri) {
     websocketpp::lib::error_code ec;
     WebSocketClient::connection_ptr con = client.get_connection(uri, ec);
     if (ec) {
-        Logger::getInstance().log("Error connecting: " + ec.message());
+        CHAT_LOG_ERROR("Error connecting: " + ec.message());
         return;
     }
     
+    // 请求二进制子协议，服务器未选择时使用文本格式
+    con->add_subprotocol(kBinarySubprotocol, ec);
+    if (ec) {
+        CHAT_LOG_ERROR("Error requesting subprotocol: " + ec.message());
+    }
+    
     // 建立连接
     client.connect(con);
     
@@ -78,16 +84,20 @@ void ChatClient::disconnect() {
  */
 void ChatClient::send(const std::string& message) {
     if (!connected) {
-        Logger::getInstance().log("Not connected to server");
+        CHAT_LOG_WARN("Not connected to server");
         return;
     }
     
     try {
-        // 创建消息对象并发送
+        // 创建消息对象并按协商的格式发送
         Message msg(username, message);
-        client.send(connection, msg.toString(), websocketpp::frame::opcode::text);
+        if (format == WireFormat::Binary) {
+            client.send(connection, msg.toBinary(), websocketpp::frame::opcode::binary);
+        } else {
+            client.send(connection, msg.toString(), websocketpp::frame::opcode::text);
+        }
     } catch (const std::exception& e) {
-        Logger::getInstance().log("Error sending message: " + std::string(e.what()));
+        CHAT_LOG_ERROR("Error sending message: " + std::string(e.what()));
     }
 }
 
@@ -107,8 +117,10 @@ void ChatClient::setMessageCallback(std::function<void(const Message&)> callback
  */
 void ChatClient::onOpen(ConnectionHdl hdl) {
     connection = hdl;
+    format = (client.get_con_from_hdl(hdl)->get_subprotocol() == kBinarySubprotocol)
+        ? WireFormat::Binary : WireFormat::Text;
     connected = true;
-    Logger::getInstance().log("Connected to server");
+    CHAT_LOG_INFO("Connected to server");
 }
 
 /**
@@ -118,25 +130,34 @@ void ChatClient::onOpen(ConnectionHdl hdl) {
  */
 void ChatClient::onClose(ConnectionHdl hdl) {
     connected = false;
-    Logger::getInstance().log("Disconnected from server");
+    CHAT_LOG_INFO("Disconnected from server");
 }
 
 /**
  * @brief 处理接收到的消息
  * 
- * 解析消息并调用回调函数
+ * 按帧的操作码选择二进制或文本解析，然后调用回调函数
  * 
  * @param hdl 连接句柄
  * @param msg 消息内容
  */
 void ChatClient::onMessage(ConnectionHdl hdl, WebSocketClient::message_ptr msg) {
+    Message message("", "");
+    ParseError error = (msg->get_opcode() == websocketpp::frame::opcode::binary)
+        ? Message::parseBinary(msg->get_payload(), message)
+        : Message::parse(msg->get_payload(), message);
+    if (error != ParseError::None) {
+        CHAT_LOG_ERROR("Error processing message: Invalid message format: " +
+                       std::string(parseErrorMessage(error)));
+        return;
+    }
+
     try {
-        Message message = Message::fromString(msg->get_payload());
         if (messageCallback) {
             messageCallback(message);
         }
     } catch (const std::exception& e) {
-        Logger::getInstance().log("Error processing message: " + std::string(e.what()));
+        CHAT_LOG_ERROR("Error processing message: " + std::string(e.what()));
     }
 }
 
@@ -149,7 +170,7 @@ void ChatClient::run() {
     try {
         client.run();
     } catch (const std::exception& e) {
-        Logger::getInstance().log("Client error: " + std::string(e.what()));
+        CHAT_LOG_ERROR("Client error: " + std::string(e.what()));
     }
 }
 
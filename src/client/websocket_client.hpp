@@ -5,6 +5,7 @@
 #include <functional>
 #include <string>
 #include "../common/message.hpp"
+#include "../common/wire_format.hpp"
 
 namespace chat {
 
@@ -20,6 +21,7 @@ using ConnectionHdl = websocketpp::connection_hdl;
  * - 发送和接收消息
  * - 处理连接状态
  * - 自动重连
+ * - 优先协商二进制帧格式，服务器不支持时回退到文本格式
  */
 class ChatClient {
 public:
@@ -63,6 +65,12 @@ public:
      */
     bool isConnected() const { return connected; }
 
+    /**
+     * @brief 获取与服务器协商的消息编码格式
+     * @return 当前连接使用的编码格式
+     */
+    WireFormat getWireFormat() const { return format; }
+
 private:
     /**
      * @brief 处理连接建立事件
@@ -93,6 +101,7 @@ private:
     std::string username;            ///< 客户端用户名
     std::function<void(const Message&)> messageCallback;  ///< 消息处理回调函数
     bool connected;                  ///< 连接状态
+    WireFormat format;               ///< 协商出的消息编码格式
 };
 
 } // namespace chat 
\ No newline at end of file
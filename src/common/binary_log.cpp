@@ -0,0 +1,580 @@
+#include "binary_log.hpp"
+#include "clock.hpp"
+#include "wire_format.hpp"
+#include <cerrno>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace chat {
+
+namespace {
+
+/// 文件头：魔数加版本号，每次打开文件时写入
+constexpr char kFileMagic[] = "CHATBLOG";
+constexpr size_t kFileMagicSize = sizeof(kFileMagic) - 1;
+constexpr uint8_t kFileVersion = 1;
+
+/// 文件中的条目类型
+constexpr char kFormatEntry = 'F';
+constexpr char kRecordEntry = 'R';
+
+/**
+ * @brief 追加一个变长整数长度前缀的字符串
+ */
+void appendString(std::string& out, std::string_view text) {
+    appendVarint(out, text.size());
+    out.append(text);
+}
+
+/**
+ * @brief 读取一个变长整数长度前缀的字符串
+ */
+bool readString(std::string_view& in, std::string_view& text) {
+    uint64_t size;
+    if (!readVarint(in, size) || size > in.size()) {
+        return false;
+    }
+    text = in.substr(0, size);
+    in.remove_prefix(size);
+    return true;
+}
+
+/**
+ * @brief 读取本机字节序的定长数值
+ */
+template <typename T>
+T loadRaw(const char* data) {
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return value;
+}
+
+/**
+ * @brief 输出带微秒的本地时间
+ */
+void writeTime(std::ostream& out, int64_t nanos) {
+    int64_t seconds = nanos / 1000000000;
+    int64_t micros = (nanos % 1000000000) / 1000;
+    if (micros < 0) {
+        seconds -= 1;
+        micros += 1000000;
+    }
+    out << Clock::format(static_cast<time_t>(seconds)) << '.' << std::setw(6) << std::setfill('0') << micros;
+}
+
+} // namespace
+
+/**
+ * @brief 获取BinaryLogger单例实例
+ */
+BinaryLogger& BinaryLogger::getInstance() {
+    static BinaryLogger instance;
+    return instance;
+}
+
+/**
+ * @brief 析构函数，写完缓冲中的记录并关闭文件
+ */
+BinaryLogger::~BinaryLogger() {
+    close();
+}
+
+/**
+ * @brief 构造环形缓冲
+ *
+ * @param capacity 最小容量，向上取整为 2 的幂
+ */
+BinaryLogger::StagingBuffer::StagingBuffer(size_t capacity)
+    : capacity(size_t(1) << (64 - __builtin_clzll(std::max<size_t>(capacity, 4096) - 1))),
+      data(new char[this->capacity]) {}
+
+/**
+ * @brief 预留一段连续空间
+ *
+ * 记录放不进缓冲末尾的剩余空间时，剩余部分作为填充一并占用
+ *
+ * @param bytes 记录长度
+ * @return 空间不足时返回nullptr
+ */
+char* BinaryLogger::StagingBuffer::reserve(size_t bytes) {
+    uint64_t head = writePos.load(std::memory_order_relaxed);
+    size_t offset = static_cast<size_t>(head & (capacity - 1));
+    size_t contiguous = capacity - offset;
+    size_t skip = bytes > contiguous ? contiguous : 0;
+    if (head + skip + bytes - cachedReadPos > capacity) {
+        cachedReadPos = readPos.load(std::memory_order_acquire);
+        if (head + skip + bytes - cachedReadPos > capacity) {
+            return nullptr;
+        }
+    }
+    if (skip >= sizeof(uint32_t)) {
+        std::memset(data.get() + offset, 0, sizeof(uint32_t));
+    }
+    pendingPos = head + skip;
+    return data.get() + (pendingPos & (capacity - 1));
+}
+
+/**
+ * @brief 取下一条记录，跳过填充
+ *
+ * @param record 输出的记录
+ * @return 没有记录时返回false
+ */
+bool BinaryLogger::StagingBuffer::front(std::string_view& record) {
+    uint64_t head = writePos.load(std::memory_order_acquire);
+    consumerPos = readPos.load(std::memory_order_relaxed);
+    while (consumerPos != head) {
+        size_t offset = static_cast<size_t>(consumerPos & (capacity - 1));
+        size_t contiguous = capacity - offset;
+        uint32_t size = 0;
+        if (contiguous >= sizeof(uint32_t)) {
+            size = loadRaw<uint32_t>(data.get() + offset);
+        }
+        if (size == 0) {
+            consumerPos += contiguous;
+            continue;
+        }
+        record = std::string_view(data.get() + offset, size);
+        return true;
+    }
+    readPos.store(consumerPos, std::memory_order_release);
+    return false;
+}
+
+/**
+ * @brief 登记调用点的格式
+ *
+ * 多个线程同时第一次经过同一调用点时只登记一次
+ *
+ * @param site 调用点
+ * @param args 参数类型
+ * @return 格式编号
+ */
+uint32_t BinaryLogger::registerSite(BinaryLogSite& site, std::initializer_list<BinaryArgType> args) {
+    std::lock_guard<std::mutex> lock(formatsMutex);
+    uint32_t id = site.id.load(std::memory_order_relaxed);
+    if (id != 0) {
+        return id;
+    }
+    formats.push_back(Format{site.level, site.file, site.line, site.format, args});
+    id = static_cast<uint32_t>(formats.size());
+    site.id.store(id, std::memory_order_release);
+    return id;
+}
+
+/**
+ * @brief 为当前线程创建环形缓冲并登记
+ *
+ * 线程退出时缓冲被标记为退役，后台线程取完其中的记录后移除
+ */
+BinaryLogger::StagingBuffer* BinaryLogger::attachThread() {
+    struct Holder {
+        std::shared_ptr<StagingBuffer> buffer;
+        ~Holder() {
+            if (buffer) {
+                buffer->retired.store(true, std::memory_order_release);
+            }
+        }
+    };
+    thread_local Holder holder;
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    holder.buffer = std::make_shared<StagingBuffer>(options.bufferBytes);
+    buffers.push_back(holder.buffer);
+    return holder.buffer.get();
+}
+
+/**
+ * @brief 打开日志文件并启动后台线程
+ *
+ * @param path 日志文件路径
+ * @param options 配置
+ * @return 文件打开成功时返回true
+ */
+bool BinaryLogger::open(const std::string& path, const BinaryLogOptions& options) {
+    close();
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        std::cerr << "Failed to open binary log file: " << path << std::endl;
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        this->options = options;
+    }
+    output.assign(kFileMagic, kFileMagicSize);
+    output.push_back(static_cast<char>(kFileVersion));
+    formatsWritten = 0;
+    lastTimestamp = 0;
+    lastWrite = std::chrono::steady_clock::now();
+    stopping = false;
+    exited = false;
+    worker = std::thread([this]() { run(); });
+    running.store(true);
+    return true;
+}
+
+/**
+ * @brief 写完各缓冲中的记录，停止后台线程并关闭文件
+ */
+void BinaryLogger::close() {
+    if (!worker.joinable()) {
+        return;
+    }
+    running.store(false);
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        stopping = true;
+        wakeCondition.notify_one();
+    }
+    worker.join();
+    ::close(fd);
+    fd = -1;
+}
+
+/**
+ * @brief 等待此前放入缓冲的记录全部写入文件
+ */
+void BinaryLogger::flush() {
+    std::unique_lock<std::mutex> lock(wakeMutex);
+    if (!worker.joinable()) {
+        return;
+    }
+    uint64_t ticket = ++flushRequested;
+    wakeCondition.notify_one();
+    flushCondition.wait(lock, [this, ticket]() {
+        return flushCompleted >= ticket || exited;
+    });
+}
+
+/**
+ * @brief 获取统计信息
+ */
+BinaryLogStats BinaryLogger::getStats() const {
+    BinaryLogStats stats;
+    {
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        stats.logged = retiredLogged;
+        stats.dropped = retiredDropped;
+        for (const auto& buffer : buffers) {
+            stats.logged += buffer->records.load(std::memory_order_relaxed);
+            stats.dropped += buffer->dropped.load(std::memory_order_relaxed);
+        }
+        stats.threads = buffers.size();
+    }
+    {
+        std::lock_guard<std::mutex> lock(formatsMutex);
+        stats.formats = formats.size();
+    }
+    stats.written = written.load(std::memory_order_relaxed);
+    stats.bytesWritten = bytesWritten.load(std::memory_order_relaxed);
+    return stats;
+}
+
+/**
+ * @brief 后台线程主循环
+ *
+ * 轮询所有缓冲；有 flush 请求或正在停止时取完记录并写出全部输出，
+ * 距上次写出超过 flushInterval 时写出已编码的输出，空闲的服务器上记录也不会
+ * 长时间滞留在内存中；没有取到记录时休眠 pollInterval。调用线程从不唤醒后台线程
+ */
+void BinaryLogger::run() {
+    for (;;) {
+        size_t drained = drain();
+        if (!output.empty() && std::chrono::steady_clock::now() - lastWrite >= options.flushInterval) {
+            writeOutput();
+        }
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        if (flushCompleted < flushRequested || stopping) {
+            uint64_t ticket = flushRequested;
+            bool stop = stopping;
+            lock.unlock();
+            // 取得票号后再取一次，保证 flush 之前的记录都已写出
+            drain();
+            writeOutput();
+            lock.lock();
+            flushCompleted = ticket;
+            exited = stop;
+            flushCondition.notify_all();
+            if (stop) {
+                break;
+            }
+            continue;
+        }
+        if (drained == 0) {
+            wakeCondition.wait_for(lock, options.pollInterval, [this]() {
+                return stopping || flushCompleted < flushRequested;
+            });
+        }
+    }
+}
+
+/**
+ * @brief 取出所有缓冲中的记录并编码到输出缓冲
+ *
+ * 所属线程已退出且已取空的缓冲被移除，其统计计入 retired*
+ *
+ * @return 取出的记录数
+ */
+size_t BinaryLogger::drain() {
+    {
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        polling.assign(buffers.begin(), buffers.end());
+    }
+    size_t count = 0;
+    bool removable = false;
+    for (const auto& buffer : polling) {
+        // 先读退役标记：之后取空就说明线程退出前写入的记录都已取出
+        bool retired = buffer->retired.load(std::memory_order_acquire);
+        std::string_view record;
+        while (buffer->front(record)) {
+            encodeRecord(record);
+            buffer->pop(record.size());
+            ++count;
+        }
+        removable = removable || retired;
+    }
+    if (removable) {
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        for (size_t i = 0; i < buffers.size();) {
+            StagingBuffer& buffer = *buffers[i];
+            if (buffer.retired.load(std::memory_order_acquire) &&
+                buffer.readPos.load(std::memory_order_relaxed) == buffer.writePos.load(std::memory_order_acquire)) {
+                retiredLogged += buffer.records.load(std::memory_order_relaxed);
+                retiredDropped += buffer.dropped.load(std::memory_order_relaxed);
+                buffers[i] = std::move(buffers.back());
+                buffers.pop_back();
+            } else {
+                ++i;
+            }
+        }
+    }
+    polling.clear();
+    return count;
+}
+
+/**
+ * @brief 将一条原始记录压缩编码到输出缓冲
+ *
+ * 条目格式：'R'、格式编号、与上一条记录的时间戳差值（zigzag）、各参数。
+ * 整数为变长整数（有符号数经 zigzag），浮点数为 8 字节，字符串带长度前缀，
+ * 时刻参数为与记录时间戳的差值。格式第一次出现前先写出其定义
+ *
+ * @param record 原始记录
+ */
+void BinaryLogger::encodeRecord(std::string_view record) {
+    uint32_t id = loadRaw<uint32_t>(record.data() + 4);
+    int64_t timestamp = loadRaw<int64_t>(record.data() + 8);
+    if (id > known.size()) {
+        std::lock_guard<std::mutex> lock(formatsMutex);
+        for (size_t i = known.size(); i < formats.size(); ++i) {
+            known.push_back(&formats[i]);
+        }
+    }
+    while (formatsWritten < id) {
+        const Format& format = *known[formatsWritten++];
+        output.push_back(kFormatEntry);
+        appendVarint(output, formatsWritten);
+        output.push_back(static_cast<char>(format.level));
+        appendVarint(output, static_cast<uint64_t>(format.line));
+        appendString(output, format.file);
+        appendString(output, format.format);
+        appendVarint(output, format.args.size());
+        for (BinaryArgType type : format.args) {
+            output.push_back(static_cast<char>(type));
+        }
+    }
+
+    output.push_back(kRecordEntry);
+    appendVarint(output, id);
+    appendVarint(output, zigzagEncode(timestamp - lastTimestamp));
+    lastTimestamp = timestamp;
+    const char* in = record.data() + kRecordHeaderBytes;
+    for (BinaryArgType type : known[id - 1]->args) {
+        switch (type) {
+            case BinaryArgType::Int:
+                appendVarint(output, zigzagEncode(loadRaw<int64_t>(in)));
+                in += 8;
+                break;
+            case BinaryArgType::Uint:
+                appendVarint(output, loadRaw<uint64_t>(in));
+                in += 8;
+                break;
+            case BinaryArgType::Double:
+                appendFixed64(output, loadRaw<uint64_t>(in));
+                in += 8;
+                break;
+            case BinaryArgType::String: {
+                uint32_t size = loadRaw<uint32_t>(in);
+                appendString(output, std::string_view(in + 4, size));
+                in += 4 + size;
+                break;
+            }
+            case BinaryArgType::Timestamp:
+                appendVarint(output, zigzagEncode(loadRaw<int64_t>(in) - timestamp));
+                in += 8;
+                break;
+        }
+    }
+    written.fetch_add(1, std::memory_order_relaxed);
+    if (output.size() >= options.flushBytes) {
+        writeOutput();
+    }
+}
+
+/**
+ * @brief 将输出缓冲写入文件并清空
+ */
+void BinaryLogger::writeOutput() {
+    const char* data = output.data();
+    size_t remaining = output.size();
+    while (remaining > 0) {
+        ssize_t n = ::write(fd, data, remaining);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            std::cerr << "Error writing binary log: " << std::strerror(errno) << std::endl;
+            break;
+        }
+        data += n;
+        remaining -= static_cast<size_t>(n);
+    }
+    bytesWritten.fetch_add(output.size() - remaining, std::memory_order_relaxed);
+    output.clear();
+    lastWrite = std::chrono::steady_clock::now();
+}
+
+/**
+ * @brief 将二进制日志解码为文本
+ *
+ * 文件可以包含多个会话，每个会话以文件头开始，格式编号和时间戳差值在会话内有效
+ *
+ * @param data 日志文件内容
+ * @param out 输出流
+ * @return 数据完整时返回true
+ */
+bool decodeBinaryLog(std::string_view data, std::ostream& out) {
+    struct DecodedFormat {
+        LogLevel level;
+        std::string_view format;
+        std::vector<BinaryArgType> args;
+    };
+    std::vector<DecodedFormat> formats;
+    int64_t lastTimestamp = 0;
+    std::string line;
+    std::ostringstream arg;
+
+    while (!data.empty()) {
+        if (data.substr(0, kFileMagicSize) == std::string_view(kFileMagic, kFileMagicSize)) {
+            if (data.size() < kFileMagicSize + 1 || static_cast<uint8_t>(data[kFileMagicSize]) != kFileVersion) {
+                return false;
+            }
+            data.remove_prefix(kFileMagicSize + 1);
+            formats.clear();
+            lastTimestamp = 0;
+            continue;
+        }
+        char tag = data.front();
+        data.remove_prefix(1);
+        uint64_t id;
+        if (!readVarint(data, id)) {
+            return false;
+        }
+
+        if (tag == kFormatEntry) {
+            DecodedFormat format;
+            uint64_t line, argc;
+            std::string_view file;
+            if (id != formats.size() + 1 || data.empty() || static_cast<uint8_t>(data.front()) > 4) {
+                return false;
+            }
+            format.level = static_cast<LogLevel>(data.front());
+            data.remove_prefix(1);
+            if (!readVarint(data, line) || !readString(data, file) || !readString(data, format.format) ||
+                !readVarint(data, argc) || argc > data.size()) {
+                return false;
+            }
+            for (uint64_t i = 0; i < argc; ++i) {
+                if (static_cast<uint8_t>(data[i]) > static_cast<uint8_t>(BinaryArgType::Timestamp)) {
+                    return false;
+                }
+                format.args.push_back(static_cast<BinaryArgType>(data[i]));
+            }
+            data.remove_prefix(argc);
+            formats.push_back(std::move(format));
+            continue;
+        }
+
+        uint64_t delta;
+        if (tag != kRecordEntry || id == 0 || id > formats.size() || !readVarint(data, delta)) {
+            return false;
+        }
+        const DecodedFormat& format = formats[id - 1];
+        int64_t timestamp = lastTimestamp + zigzagDecode(delta);
+        lastTimestamp = timestamp;
+
+        // 依次解码参数并替换格式中的 {}
+        line.clear();
+        size_t pos = 0;
+        for (BinaryArgType type : format.args) {
+            arg.str("");
+            uint64_t value;
+            std::string_view text;
+            switch (type) {
+                case BinaryArgType::Int:
+                    if (!readVarint(data, value)) {
+                        return false;
+                    }
+                    arg << zigzagDecode(value);
+                    break;
+                case BinaryArgType::Uint:
+                    if (!readVarint(data, value)) {
+                        return false;
+                    }
+                    arg << value;
+                    break;
+                case BinaryArgType::Double: {
+                    if (data.size() < 8) {
+                        return false;
+                    }
+                    uint64_t bits = loadFixed64(data.data());
+                    double number;
+                    std::memcpy(&number, &bits, sizeof(number));
+                    arg << number;
+                    data.remove_prefix(8);
+                    break;
+                }
+                case BinaryArgType::String:
+                    if (!readString(data, text)) {
+                        return false;
+                    }
+                    arg << text;
+                    break;
+                case BinaryArgType::Timestamp:
+                    if (!readVarint(data, value)) {
+                        return false;
+                    }
+                    writeTime(arg, timestamp + zigzagDecode(value));
+                    break;
+            }
+            size_t placeholder = format.format.find("{}", pos);
+            if (placeholder == std::string_view::npos) {
+                continue;
+            }
+            line.append(format.format.substr(pos, placeholder - pos)).append(arg.str());
+            pos = placeholder + 2;
+        }
+        line.append(format.format.substr(pos));
+
+        out << '[';
+        writeTime(out, timestamp);
+        out << "] [" << logLevelName(format.level) << "] " << line << '\n';
+    }
+    return true;
+}
+
+} // namespace chat
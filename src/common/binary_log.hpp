@@ -0,0 +1,390 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "logger.hpp"
+
+/**
+ * @brief 以二进制格式记录日志，格式化推迟到离线解码时进行
+ *
+ * format 必须是字符串字面量，其中的 {} 依次替换为参数。每个调用点的格式只登记一次，
+ * 之后调用线程只把格式编号、时间戳和参数的原始字节拷贝进本线程的环形缓冲，
+ * 不拼接字符串、不加锁、不做系统调用。参数可以是整数、浮点数、字符串（string、
+ * string_view 或 const char*）和 system_clock::time_point。
+ *
+ * 级别的编译期与运行时过滤与 CHAT_LOG 相同，且只在 BinaryLogger 打开时记录
+ */
+#define CHAT_BLOG(level, format, ...)                                                  \
+    do {                                                                               \
+        if constexpr (static_cast<int>(level) >= CHAT_LOG_MIN_LEVEL) {                 \
+            ::chat::BinaryLogger& chatBinaryLogger_ = ::chat::BinaryLogger::getInstance(); \
+            if (chatBinaryLogger_.isEnabled(level)) {                                  \
+                static ::chat::BinaryLogSite chatLogSite_{level, __FILE__, __LINE__, format}; \
+                chatBinaryLogger_.write(chatLogSite_, ##__VA_ARGS__);                  \
+            }                                                                          \
+        }                                                                              \
+    } while (0)
+
+#define CHAT_BLOG_DEBUG(format, ...) CHAT_BLOG(::chat::LogLevel::Debug, format, ##__VA_ARGS__)
+#define CHAT_BLOG_INFO(format, ...) CHAT_BLOG(::chat::LogLevel::Info, format, ##__VA_ARGS__)
+#define CHAT_BLOG_WARN(format, ...) CHAT_BLOG(::chat::LogLevel::Warn, format, ##__VA_ARGS__)
+#define CHAT_BLOG_ERROR(format, ...) CHAT_BLOG(::chat::LogLevel::Error, format, ##__VA_ARGS__)
+
+namespace chat {
+
+/**
+ * @brief 二进制日志参数类型
+ */
+enum class BinaryArgType : uint8_t {
+    Int = 0,        ///< 有符号整数
+    Uint = 1,       ///< 无符号整数和 bool
+    Double = 2,     ///< 浮点数
+    String = 3,     ///< 字符串，超过 kMaxStringBytes 的部分被截断
+    Timestamp = 4   ///< system_clock 时刻
+};
+
+/**
+ * @brief 获取参数类型对应的 BinaryArgType
+ */
+template <typename T>
+constexpr BinaryArgType binaryArgType() {
+    using U = std::decay_t<T>;
+    if constexpr (std::is_same_v<U, std::chrono::system_clock::time_point>) {
+        return BinaryArgType::Timestamp;
+    } else if constexpr (std::is_same_v<U, bool> || std::is_unsigned_v<U>) {
+        return BinaryArgType::Uint;
+    } else if constexpr (std::is_integral_v<U>) {
+        return BinaryArgType::Int;
+    } else if constexpr (std::is_floating_point_v<U>) {
+        return BinaryArgType::Double;
+    } else {
+        static_assert(std::is_convertible_v<const U&, std::string_view>,
+                      "binary log arguments must be integers, floating point, strings or time points");
+        return BinaryArgType::String;
+    }
+}
+
+/**
+ * @brief 日志调用点，由 CHAT_BLOG 以静态变量的形式定义
+ *
+ * 编号在第一次记录时登记得到，0 表示尚未登记
+ */
+struct BinaryLogSite {
+    LogLevel level;                  ///< 日志级别
+    const char* file;                ///< 源文件
+    int line;                        ///< 行号
+    const char* format;              ///< 格式字符串
+    std::atomic<uint32_t> id{0};     ///< 格式编号
+};
+
+/**
+ * @brief 二进制日志配置
+ */
+struct BinaryLogOptions {
+    size_t bufferBytes = 1 << 20;                 ///< 每个线程的环形缓冲大小，缓冲满时新记录被丢弃
+    std::chrono::milliseconds pollInterval{10};   ///< 后台线程轮询各缓冲的间隔
+    size_t flushBytes = 64 << 10;                 ///< 输出缓冲超过该字节数时写入文件
+    std::chrono::milliseconds flushInterval{1000}; ///< 输出缓冲中的记录最长多久写入文件一次
+};
+
+/**
+ * @brief 二进制日志统计
+ */
+struct BinaryLogStats {
+    uint64_t logged = 0;         ///< 放入环形缓冲的记录数
+    uint64_t dropped = 0;        ///< 缓冲已满而丢弃的记录数
+    uint64_t written = 0;        ///< 写入文件的记录数
+    uint64_t bytesWritten = 0;   ///< 写入文件的字节数
+    size_t formats = 0;          ///< 已登记的格式数
+    size_t threads = 0;          ///< 持有环形缓冲的线程数
+};
+
+/**
+ * @brief 二进制日志记录器，使用单例模式实现
+ *
+ * 每个线程拥有一个单生产者单消费者的环形缓冲，记录以原始字节写入；
+ * 后台线程定期轮询所有缓冲，把记录压缩编码（变长整数、时间戳差值）后批量写入文件，
+ * 并在文件中第一次出现某个格式编号之前写出该格式的定义。
+ *
+ * 文件以追加方式打开，每次打开写入一个新的文件头，decodeBinaryLog 可以解码多个会话。
+ */
+class BinaryLogger {
+public:
+    /// 字符串参数保留的最大字节数
+    static constexpr size_t kMaxStringBytes = 1024;
+
+    /**
+     * @brief 获取BinaryLogger单例实例
+     * @return BinaryLogger实例的引用
+     */
+    static BinaryLogger& getInstance();
+
+    /**
+     * @brief 打开日志文件并启动后台线程，已打开时先关闭
+     * @param path 日志文件路径
+     * @param options 配置，缓冲大小只对之后创建缓冲的线程生效
+     * @return 文件打开成功时返回true
+     */
+    bool open(const std::string& path, const BinaryLogOptions& options = BinaryLogOptions());
+
+    /**
+     * @brief 写完各缓冲中的记录，停止后台线程并关闭文件
+     *
+     * 与 close 并发的记录可能留在缓冲中，在下次打开后写入
+     */
+    void close();
+
+    /**
+     * @brief 等待此前放入缓冲的记录全部写入文件
+     */
+    void flush();
+
+    /**
+     * @brief 某个级别当前是否记录
+     * @param level 日志级别
+     * @return 已打开且 Logger 启用该级别时返回true
+     */
+    bool isEnabled(LogLevel level) const {
+        return running.load(std::memory_order_relaxed) && Logger::getInstance().isEnabled(level);
+    }
+
+    /**
+     * @brief 获取统计信息
+     */
+    BinaryLogStats getStats() const;
+
+    /**
+     * @brief 记录一条日志，由 CHAT_BLOG 调用
+     *
+     * 记录布局（本机字节序）：总长度 u32、格式编号 u32、时间戳纳秒 i64、各参数。
+     * 整数和浮点数占 8 字节，字符串为长度 u32 加内容
+     *
+     * @param site 调用点
+     * @param args 参数
+     */
+    template <typename... Args>
+    void write(BinaryLogSite& site, const Args&... args) {
+        uint32_t id = site.id.load(std::memory_order_acquire);
+        if (id == 0) {
+            id = registerSite(site, {binaryArgType<Args>()...});
+        }
+        size_t size = kRecordHeaderBytes + (encodedSize(args) + ... + 0);
+        StagingBuffer& buffer = localBuffer();
+        char* out = buffer.reserve(size);
+        if (!out) {
+            buffer.dropped.store(buffer.dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return;
+        }
+        int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        out = storeRaw(out, static_cast<uint32_t>(size));
+        out = storeRaw(out, id);
+        out = storeRaw(out, now);
+        ((out = encodeArg(out, args)), ...);
+        buffer.commit(size);
+    }
+
+private:
+    /// 记录头：总长度、格式编号、时间戳
+    static constexpr size_t kRecordHeaderBytes = 16;
+
+    /**
+     * @brief 登记的格式
+     */
+    struct Format {
+        LogLevel level;                       ///< 日志级别
+        std::string file;                     ///< 源文件
+        int line;                             ///< 行号
+        std::string format;                   ///< 格式字符串
+        std::vector<BinaryArgType> args;      ///< 参数类型
+    };
+
+    /**
+     * @brief 单生产者单消费者的字节环形缓冲
+     *
+     * 位置单调递增，对容量取模得到偏移。记录不跨越缓冲末尾：剩余空间不足时
+     * 写入长度为 0 的填充标记（剩余不足 4 字节时省略）并从头开始
+     */
+    struct StagingBuffer {
+        explicit StagingBuffer(size_t capacity);
+
+        /**
+         * @brief 预留一段连续空间（生产者）
+         * @param bytes 记录长度
+         * @return 空间不足时返回nullptr
+         */
+        char* reserve(size_t bytes);
+
+        /**
+         * @brief 发布预留的记录（生产者）
+         * @param bytes 记录长度
+         */
+        void commit(size_t bytes) {
+            writePos.store(pendingPos + bytes, std::memory_order_release);
+            records.store(records.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief 取下一条记录（消费者）
+         * @param record 输出的记录
+         * @return 没有记录时返回false
+         */
+        bool front(std::string_view& record);
+
+        /**
+         * @brief 释放 front 取出的记录（消费者）
+         */
+        void pop(size_t bytes) { readPos.store(consumerPos + bytes, std::memory_order_release); }
+
+        const size_t capacity;                              ///< 容量（2 的幂）
+        std::unique_ptr<char[]> data;                       ///< 缓冲区
+        alignas(64) std::atomic<uint64_t> writePos{0};      ///< 生产者已发布的位置
+        uint64_t pendingPos = 0;                            ///< 生产者预留记录的起始位置
+        uint64_t cachedReadPos = 0;                         ///< 生产者缓存的消费位置
+        std::atomic<uint64_t> records{0};                   ///< 记录数，只由生产者修改
+        std::atomic<uint64_t> dropped{0};                   ///< 丢弃数，只由生产者修改
+        alignas(64) std::atomic<uint64_t> readPos{0};       ///< 消费者已释放的位置
+        uint64_t consumerPos = 0;                           ///< 消费者当前记录的起始位置
+        std::atomic<bool> retired{false};                   ///< 所属线程是否已退出
+    };
+
+    BinaryLogger() = default;
+    ~BinaryLogger();
+    BinaryLogger(const BinaryLogger&) = delete;
+    BinaryLogger& operator=(const BinaryLogger&) = delete;
+
+    /**
+     * @brief 登记调用点的格式，返回其编号
+     */
+    uint32_t registerSite(BinaryLogSite& site, std::initializer_list<BinaryArgType> args);
+
+    /**
+     * @brief 获取当前线程的环形缓冲，第一次调用时创建
+     */
+    StagingBuffer& localBuffer() {
+        thread_local StagingBuffer* buffer = nullptr;
+        return buffer ? *buffer : *(buffer = attachThread());
+    }
+
+    /**
+     * @brief 为当前线程创建环形缓冲并登记
+     */
+    StagingBuffer* attachThread();
+
+    /**
+     * @brief 后台线程主循环
+     */
+    void run();
+
+    /**
+     * @brief 取出所有缓冲中的记录并编码到输出缓冲
+     * @return 取出的记录数
+     */
+    size_t drain();
+
+    /**
+     * @brief 将一条原始记录压缩编码到输出缓冲
+     */
+    void encodeRecord(std::string_view record);
+
+    /**
+     * @brief 将输出缓冲写入文件
+     */
+    void writeOutput();
+
+    template <typename T>
+    static char* storeRaw(char* out, const T& value) {
+        std::memcpy(out, &value, sizeof(T));
+        return out + sizeof(T);
+    }
+
+    template <typename T>
+    static size_t encodedSize(const T& value) {
+        if constexpr (binaryArgType<T>() == BinaryArgType::String) {
+            return 4 + std::min(std::string_view(value).size(), kMaxStringBytes);
+        } else {
+            return 8;
+        }
+    }
+
+    template <typename T>
+    static char* encodeArg(char* out, const T& value) {
+        constexpr BinaryArgType type = binaryArgType<T>();
+        if constexpr (type == BinaryArgType::String) {
+            std::string_view text(value);
+            uint32_t size = static_cast<uint32_t>(std::min(text.size(), kMaxStringBytes));
+            out = storeRaw(out, size);
+            std::memcpy(out, text.data(), size);
+            return out + size;
+        } else if constexpr (type == BinaryArgType::Timestamp) {
+            return storeRaw(out, static_cast<int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                value.time_since_epoch()).count()));
+        } else if constexpr (type == BinaryArgType::Double) {
+            return storeRaw(out, static_cast<double>(value));
+        } else if constexpr (type == BinaryArgType::Uint) {
+            return storeRaw(out, static_cast<uint64_t>(value));
+        } else {
+            return storeRaw(out, static_cast<int64_t>(value));
+        }
+    }
+
+    std::atomic<bool> running{false};             ///< 是否已打开
+
+    mutable std::mutex formatsMutex;              ///< 保护 formats
+    std::deque<Format> formats;                   ///< 已登记的格式，下标为编号减一
+
+    mutable std::mutex buffersMutex;              ///< 保护 buffers 和 retired* 统计
+    std::vector<std::shared_ptr<StagingBuffer>> buffers;   ///< 各线程的环形缓冲
+    uint64_t retiredLogged = 0;                   ///< 已移除缓冲的记录数
+    uint64_t retiredDropped = 0;                  ///< 已移除缓冲的丢弃数
+
+    BinaryLogOptions options;                     ///< 配置
+    int fd = -1;                                  ///< 日志文件，只由后台线程写入
+    std::thread worker;                           ///< 后台线程
+    std::mutex wakeMutex;                         ///< 配合条件变量使用
+    std::condition_variable wakeCondition;        ///< 唤醒后台线程
+    std::condition_variable flushCondition;       ///< 通知 flush 调用方
+    // 以下四项受 wakeMutex 保护
+    bool stopping = false;                        ///< 是否正在停止
+    uint64_t flushRequested = 0;                  ///< 已发出的 flush 请求票号
+    uint64_t flushCompleted = 0;                  ///< 已完成的 flush 请求票号
+    bool exited = false;                          ///< 后台线程是否已退出
+
+    // 以下只由后台线程访问
+    std::vector<std::shared_ptr<StagingBuffer>> polling;   ///< 本轮轮询的缓冲
+    std::vector<const Format*> known;             ///< 后台线程缓存的格式
+    size_t formatsWritten = 0;                    ///< 当前文件中已写出定义的格式数
+    int64_t lastTimestamp = 0;                    ///< 当前文件中上一条记录的时间戳
+    std::string output;                           ///< 输出缓冲
+    std::chrono::steady_clock::time_point lastWrite;   ///< 上次写入文件的时间
+
+    std::atomic<uint64_t> written{0};             ///< 写入文件的记录数
+    std::atomic<uint64_t> bytesWritten{0};        ///< 写入文件的字节数
+};
+
+/**
+ * @brief 将二进制日志解码为文本
+ *
+ * 每条记录输出一行：[YYYY-MM-DD HH:MM:SS.ffffff] [LEVEL] 格式化后的消息
+ *
+ * @param data 日志文件内容
+ * @param out 输出流
+ * @return 数据完整时返回true；遇到损坏或截断时在已解码部分之后停止并返回false
+ */
+bool decodeBinaryLog(std::string_view data, std::ostream& out);
+
+} // namespace chat
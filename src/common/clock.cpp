@@ -0,0 +1,117 @@
+#include "clock.hpp"
+#include <limits>
+
+namespace chat {
+
+namespace {
+
+/// 时区偏移缓存区间：半点/刻钟时区的夏令时切换同样落在 15 分钟边界上
+constexpr time_t kOffsetBucketSeconds = 15 * 60;
+constexpr time_t kSecondsPerDay = 24 * 60 * 60;
+
+/**
+ * @brief 向下取整的整数除法（支持 1970 年之前的负时间戳）
+ */
+time_t floorDiv(time_t value, time_t divisor) {
+    time_t q = value / divisor;
+    return (value % divisor < 0) ? q - 1 : q;
+}
+
+/**
+ * @brief 将自 1970-01-01 起的天数转换为公历日期
+ *
+ * 采用 Howard Hinnant 的 civil_from_days 算法，纯整数运算，不访问时区数据。
+ */
+void civilFromDays(time_t days, int& year, int& month, int& day) {
+    days += 719468;
+    const time_t era = floorDiv(days, 146097);
+    const unsigned doe = static_cast<unsigned>(days - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    day = static_cast<int>(doy - (153 * mp + 2) / 5 + 1);
+    month = static_cast<int>(mp < 10 ? mp + 3 : mp - 9);
+    year = static_cast<int>(yoe + era * 400 + (month <= 2 ? 1 : 0));
+}
+
+/**
+ * @brief 以固定宽度写入十进制数字
+ */
+void writeDigits(char* out, int value, int width) {
+    for (int i = width - 1; i >= 0; --i) {
+        out[i] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    }
+}
+
+} // namespace
+
+/**
+ * @brief 获取本地时区偏移
+ *
+ * 同一 15 分钟区间内复用上次 localtime_r 的结果。
+ *
+ * @param timestamp 时间戳
+ * @return 本地时间相对 UTC 的偏移（秒）
+ */
+long Clock::utcOffset(time_t timestamp) {
+    struct OffsetCache {
+        time_t bucket = std::numeric_limits<time_t>::min();
+        long offset = 0;
+    };
+    thread_local OffsetCache cache;
+
+    time_t bucket = floorDiv(timestamp, kOffsetBucketSeconds);
+    if (bucket != cache.bucket) {
+        std::tm tm = {};
+        localtime_r(&timestamp, &tm);
+        cache.offset = tm.tm_gmtoff;
+        cache.bucket = bucket;
+    }
+    return cache.offset;
+}
+
+/**
+ * @brief 将时间戳格式化为本地时间字符串
+ *
+ * 命中同一秒时直接返回缓存；否则用缓存的时区偏移换算出本地时间，
+ * 再按固定宽度写入各字段，不经过 localtime/strftime。
+ *
+ * @param timestamp 时间戳
+ * @return 指向线程局部缓冲区的视图
+ */
+std::string_view Clock::format(time_t timestamp) {
+    struct FormatCache {
+        time_t second = std::numeric_limits<time_t>::min();
+        char text[kTimeStringLength + 1] = {};
+    };
+    thread_local FormatCache cache;
+
+    if (timestamp != cache.second) {
+        time_t local = timestamp + utcOffset(timestamp);
+        time_t days = floorDiv(local, kSecondsPerDay);
+        int secondsOfDay = static_cast<int>(local - days * kSecondsPerDay);
+
+        int year, month, day;
+        civilFromDays(days, year, month, day);
+
+        // "YYYY-MM-DD HH:MM:SS"
+        char* out = cache.text;
+        writeDigits(out, year, 4);
+        out[4] = '-';
+        writeDigits(out + 5, month, 2);
+        out[7] = '-';
+        writeDigits(out + 8, day, 2);
+        out[10] = ' ';
+        writeDigits(out + 11, secondsOfDay / 3600, 2);
+        out[13] = ':';
+        writeDigits(out + 14, secondsOfDay / 60 % 60, 2);
+        out[16] = ':';
+        writeDigits(out + 17, secondsOfDay % 60, 2);
+        out[kTimeStringLength] = '\0';
+        cache.second = timestamp;
+    }
+    return std::string_view(cache.text, kTimeStringLength);
+}
+
+} // namespace chat
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string_view>
+#include <ctime>
+
+namespace chat {
+
+/**
+ * @brief 时间格式化服务
+ *
+ * 为消息和日志提供 YYYY-MM-DD HH:MM:SS 格式的本地时间字符串：
+ * - 每个线程缓存最近一次格式化的秒及其结果，同一秒内只需拷贝
+ * - 时区偏移按 15 分钟区间缓存，避免每次调用 localtime（glibc 内部持有全局锁）
+ *
+ * 所有缓存均为线程局部变量，无需加锁。
+ */
+class Clock {
+public:
+    /// 格式化后时间字符串的长度（不含结尾 '\0'）
+    static constexpr size_t kTimeStringLength = 19;
+
+    /**
+     * @brief 将时间戳格式化为本地时间字符串
+     * @param timestamp 时间戳
+     * @return 指向线程局部缓冲区的视图，在本线程下一次调用前有效
+     */
+    static std::string_view format(time_t timestamp);
+
+    /**
+     * @brief 格式化当前时间
+     * @return 指向线程局部缓冲区的视图，在本线程下一次调用前有效
+     */
+    static std::string_view formatNow() { return format(std::time(nullptr)); }
+
+    /**
+     * @brief 获取指定时刻的本地时区偏移
+     * @param timestamp 时间戳
+     * @return 本地时间相对 UTC 的偏移（秒）
+     */
+    static long utcOffset(time_t timestamp);
+};
+
+} // namespace chat
@@ -0,0 +1,157 @@
+#include "crc32c.hpp"
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <nmmintrin.h>
+#define CHAT_CRC32C_SSE42 1
+#endif
+
+namespace chat {
+
+namespace {
+
+/// CRC32C 多项式（反射形式）
+constexpr uint32_t kCastagnoliPolynomial = 0x82F63B78;
+
+/**
+ * @brief 生成 slicing-by-8 使用的 8 张 256 项表
+ *
+ * 第 0 张为逐字节表；第 k 张对应该字节之后还跟着 k 个零字节时的贡献，
+ * 这样每次可以用 8 次查表处理 8 个字节
+ */
+constexpr std::array<std::array<uint32_t, 256>, 8> makeTables() {
+    std::array<std::array<uint32_t, 256>, 8> tables = {};
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 1) ? (crc >> 1) ^ kCastagnoliPolynomial : crc >> 1;
+        }
+        tables[0][i] = crc;
+    }
+    for (size_t k = 1; k < 8; ++k) {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t previous = tables[k - 1][i];
+            tables[k][i] = tables[0][previous & 0xFF] ^ (previous >> 8);
+        }
+    }
+    return tables;
+}
+
+constexpr std::array<std::array<uint32_t, 256>, 8> kTables = makeTables();
+
+/**
+ * @brief 读取一个小端序 64 位整数
+ */
+uint64_t loadLittleEndian64(const uint8_t* bytes) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; ++i) {
+        value |= static_cast<uint64_t>(bytes[i]) << (8 * i);
+    }
+    return value;
+}
+
+#ifdef CHAT_CRC32C_SSE42
+/**
+ * @brief 使用 SSE4.2 crc32 指令计算，每条指令处理 8 字节
+ *
+ * 只为本函数开启 sse4.2 目标特性，其余代码仍可在不支持的 CPU 上运行
+ */
+__attribute__((target("sse4.2")))
+uint32_t crc32cHardware(const void* data, size_t length, uint32_t crc) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    uint64_t state = ~crc;
+    // 先按字节处理到 8 字节对齐
+    while (length > 0 && (reinterpret_cast<uintptr_t>(bytes) & 7) != 0) {
+        state = _mm_crc32_u8(static_cast<uint32_t>(state), *bytes++);
+        --length;
+    }
+    while (length >= 8) {
+        uint64_t word;
+        std::memcpy(&word, bytes, sizeof(word));
+        state = _mm_crc32_u64(state, word);
+        bytes += 8;
+        length -= 8;
+    }
+    while (length > 0) {
+        state = _mm_crc32_u8(static_cast<uint32_t>(state), *bytes++);
+        --length;
+    }
+    return ~static_cast<uint32_t>(state);
+}
+#endif
+
+using Crc32cFunction = uint32_t (*)(const void*, size_t, uint32_t);
+
+/**
+ * @brief 检测 CPU 并选择实现
+ */
+Crc32cFunction selectImplementation() {
+#ifdef CHAT_CRC32C_SSE42
+    // 在静态初始化阶段调用，需先显式初始化 CPU 特性信息
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.2")) {
+        return crc32cHardware;
+    }
+#endif
+    return crc32cPortable;
+}
+
+/// 选定的实现，在静态初始化时确定
+const Crc32cFunction kImplementation = selectImplementation();
+
+} // namespace
+
+/**
+ * @brief 可移植的 CRC32C 实现
+ *
+ * slicing-by-8：每轮读入 8 字节，用 8 张表各查一次后异或合并
+ *
+ * @param data 数据
+ * @param length 数据长度
+ * @param crc 之前各段的校验和
+ * @return 校验和
+ */
+uint32_t crc32cPortable(const void* data, size_t length, uint32_t crc) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    crc = ~crc;
+    while (length >= 8) {
+        uint64_t word = loadLittleEndian64(bytes) ^ crc;
+        crc = kTables[7][word & 0xFF] ^ kTables[6][(word >> 8) & 0xFF] ^
+              kTables[5][(word >> 16) & 0xFF] ^ kTables[4][(word >> 24) & 0xFF] ^
+              kTables[3][(word >> 32) & 0xFF] ^ kTables[2][(word >> 40) & 0xFF] ^
+              kTables[1][(word >> 48) & 0xFF] ^ kTables[0][word >> 56];
+        bytes += 8;
+        length -= 8;
+    }
+    while (length > 0) {
+        crc = kTables[0][(crc ^ *bytes++) & 0xFF] ^ (crc >> 8);
+        --length;
+    }
+    return ~crc;
+}
+
+/**
+ * @brief 计算 CRC32C 校验和
+ *
+ * @param data 数据
+ * @param length 数据长度
+ * @param crc 之前各段的校验和
+ * @return 校验和
+ */
+uint32_t crc32c(const void* data, size_t length, uint32_t crc) {
+    return kImplementation(data, length, crc);
+}
+
+/**
+ * @brief crc32c 是否使用了硬件指令
+ */
+bool crc32cHardwareAccelerated() {
+#ifdef CHAT_CRC32C_SSE42
+    return kImplementation == crc32cHardware;
+#else
+    return false;
+#endif
+}
+
+} // namespace chat
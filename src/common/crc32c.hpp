@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace chat {
+
+/**
+ * @brief 计算 CRC32C（Castagnoli 多项式）校验和
+ *
+ * 程序启动时检测 CPU：支持 SSE4.2 时使用 crc32 指令，否则使用查表实现。
+ * 可分段计算：将上一段的结果作为 crc 传入即可继续累加。
+ *
+ * @param data 数据
+ * @param length 数据长度
+ * @param crc 之前各段的校验和，首段为 0
+ * @return 校验和
+ */
+uint32_t crc32c(const void* data, size_t length, uint32_t crc = 0);
+
+/**
+ * @brief 可移植的 CRC32C 实现（slicing-by-8 查表）
+ *
+ * 结果与 crc32c 相同，用于不支持硬件指令的 CPU 以及测试对照
+ */
+uint32_t crc32cPortable(const void* data, size_t length, uint32_t crc = 0);
+
+/**
+ * @brief crc32c 是否使用了硬件指令
+ */
+bool crc32cHardwareAccelerated();
+
+} // namespace chat
@@ -0,0 +1,79 @@
+#include "file_util.hpp"
+#include <cerrno>
+#include <cstdio>
+#include <filesystem>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace chat {
+
+/**
+ * @brief 读取整个文件
+ *
+ * @param path 文件路径
+ * @param data 用于接收文件内容的字符串
+ * @return 文件不存在或读取失败时返回false
+ */
+bool readFile(const std::string& path, std::string& data) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    data.clear();
+    char buffer[64 << 10];
+    for (;;) {
+        ssize_t n = ::read(fd, buffer, sizeof(buffer));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            ::close(fd);
+            return n == 0;
+        }
+        data.append(buffer, static_cast<size_t>(n));
+    }
+}
+
+/**
+ * @brief 以临时文件加改名的方式原子地写入文件并落盘
+ *
+ * @param path 文件路径
+ * @param data 文件内容
+ * @return 成功时返回true
+ */
+bool writeFileAtomic(const std::string& path, const std::string& data) {
+    std::string temp = path + ".tmp";
+    int fd = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    const char* pos = data.data();
+    size_t remaining = data.size();
+    while (remaining > 0) {
+        ssize_t n = ::write(fd, pos, remaining);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        pos += n;
+        remaining -= static_cast<size_t>(n);
+    }
+    bool ok = remaining == 0 && ::fsync(fd) == 0;
+    ::close(fd);
+    if (!ok || std::rename(temp.c_str(), path.c_str()) != 0) {
+        ::unlink(temp.c_str());
+        return false;
+    }
+    // 改名本身需要目录落盘才能在崩溃后保留
+    std::string directory = std::filesystem::path(path).parent_path().string();
+    int dirFd = ::open(directory.empty() ? "." : directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirFd >= 0) {
+        ::fsync(dirFd);
+        ::close(dirFd);
+    }
+    return true;
+}
+
+} // namespace chat
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <string>
+
+namespace chat {
+
+/**
+ * @brief 读取整个文件
+ * @param path 文件路径
+ * @param data 用于接收文件内容的字符串
+ * @return 文件不存在或读取失败时返回false
+ */
+bool readFile(const std::string& path, std::string& data);
+
+/**
+ * @brief 以临时文件加改名的方式原子地写入文件并落盘
+ *
+ * 先写入 path.tmp 并 fsync，再改名为 path 并 fsync 所在目录，
+ * 崩溃后 path 要么是旧内容，要么是完整的新内容
+ *
+ * @param path 文件路径
+ * @param data 文件内容
+ * @return 成功时返回true，失败时 errno 指示原因
+ */
+bool writeFileAtomic(const std::string& path, const std::string& data);
+
+} // namespace chat
@@ -0,0 +1,191 @@
+#include "log_throttle.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+namespace chat {
+
+namespace {
+
+/**
+ * @brief 各类别的令牌桶参数
+ */
+struct LimitRegistry {
+    std::mutex mutex;                                          ///< 保护以下两项
+    LogRateLimit defaultLimit;                                 ///< 未单独配置的类别使用的参数
+    std::unordered_map<std::string, LogRateLimit> categories;  ///< 按类别配置的参数
+};
+
+LimitRegistry& registry() {
+    static LimitRegistry instance;
+    return instance;
+}
+
+} // namespace
+
+std::atomic<uint64_t> LogThrottle::configGeneration{1};
+std::atomic<LogThrottle*> LogThrottle::sites{nullptr};
+std::atomic<uint64_t> LogThrottle::reportedSuppressed{0};
+
+/**
+ * @brief 判断当前记录是否放行
+ *
+ * GCRA：理论到达时间减去容差不晚于当前时间时放行，并把理论到达时间推后一个间隔
+ *
+ * @param nowNanos steady_clock 纳秒时间
+ * @return 放行时返回true
+ */
+bool LogThrottle::admit(int64_t nowNanos) {
+    if (generation.load(std::memory_order_acquire) != configGeneration.load(std::memory_order_acquire)) {
+        reload(nowNanos);
+    }
+    if (blocked.load(std::memory_order_relaxed)) {
+        suppressed.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    int64_t step = interval.load(std::memory_order_relaxed);
+    if (step > 0) {
+        int64_t arrival = theoreticalArrival.load(std::memory_order_relaxed);
+        for (;;) {
+            if (nowNanos < arrival - tolerance.load(std::memory_order_relaxed)) {
+                suppressed.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            int64_t next = std::max(arrival, nowNanos) + step;
+            if (theoreticalArrival.compare_exchange_weak(arrival, next, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+    }
+    report(nowNanos);
+    windowStart.store(nowNanos, std::memory_order_relaxed);
+    return true;
+}
+
+/**
+ * @brief 重新读取类别参数
+ *
+ * @param nowNanos steady_clock 纳秒时间
+ */
+void LogThrottle::reload(int64_t nowNanos) {
+    LimitRegistry& limits = registry();
+    {
+        std::lock_guard<std::mutex> lock(limits.mutex);
+        uint64_t current = configGeneration.load(std::memory_order_acquire);
+        auto it = limits.categories.find(category);
+        const LogRateLimit& limit = (it == limits.categories.end()) ? limits.defaultLimit : it->second;
+        int64_t step = 0;
+        if (limit.perSecond > 0) {
+            step = std::max<int64_t>(1, std::llround(1e9 / limit.perSecond));
+        }
+        interval.store(step, std::memory_order_relaxed);
+        tolerance.store(limit.burst > 0 ? step * (static_cast<int64_t>(limit.burst) - 1) : 0,
+                        std::memory_order_relaxed);
+        blocked.store(step > 0 && limit.burst == 0, std::memory_order_relaxed);
+        generation.store(current, std::memory_order_release);
+    }
+
+    if (!registered.exchange(true)) {
+        windowStart.store(nowNanos, std::memory_order_relaxed);
+        LogThrottle* head = sites.load(std::memory_order_relaxed);
+        do {
+            next = head;
+        } while (!sites.compare_exchange_weak(head, this, std::memory_order_release, std::memory_order_relaxed));
+    }
+}
+
+/**
+ * @brief 取走被抑制的计数并输出汇总
+ *
+ * 汇总格式：[类别] N similar messages suppressed in last X.Xs (文件:行号)
+ *
+ * @param nowNanos steady_clock 纳秒时间
+ * @return 输出了汇总时返回true
+ */
+bool LogThrottle::report(int64_t nowNanos) {
+    uint64_t count = suppressed.exchange(0, std::memory_order_relaxed);
+    if (count == 0) {
+        return false;
+    }
+    reportedSuppressed.fetch_add(count, std::memory_order_relaxed);
+    int64_t start = windowStart.exchange(nowNanos, std::memory_order_relaxed);
+    double seconds = static_cast<double>(std::max<int64_t>(nowNanos - start, 0)) / 1e9;
+    const char* name = std::strrchr(file, '/');
+    name = name ? name + 1 : file;
+
+    char window[32];
+    std::snprintf(window, sizeof(window), "%.1fs", seconds);
+    Logger::getInstance().log(level, "[" + std::string(category) + "] " + std::to_string(count) +
+                                     " similar messages suppressed in last " + window + " (" + name + ":" +
+                                     std::to_string(line) + ")");
+    return true;
+}
+
+/**
+ * @brief 设置某个类别的令牌桶参数
+ *
+ * @param category 类别名
+ * @param limit 令牌桶参数
+ */
+void LogThrottle::setLimit(const std::string& category, const LogRateLimit& limit) {
+    LimitRegistry& limits = registry();
+    std::lock_guard<std::mutex> lock(limits.mutex);
+    limits.categories[category] = limit;
+    configGeneration.fetch_add(1, std::memory_order_acq_rel);
+}
+
+/**
+ * @brief 设置未单独配置的类别使用的令牌桶参数
+ *
+ * @param limit 令牌桶参数
+ */
+void LogThrottle::setDefaultLimit(const LogRateLimit& limit) {
+    LimitRegistry& limits = registry();
+    std::lock_guard<std::mutex> lock(limits.mutex);
+    limits.defaultLimit = limit;
+    configGeneration.fetch_add(1, std::memory_order_acq_rel);
+}
+
+/**
+ * @brief 清除所有类别的配置，恢复默认参数
+ */
+void LogThrottle::resetLimits() {
+    LimitRegistry& limits = registry();
+    std::lock_guard<std::mutex> lock(limits.mutex);
+    limits.categories.clear();
+    limits.defaultLimit = LogRateLimit();
+    configGeneration.fetch_add(1, std::memory_order_acq_rel);
+}
+
+/**
+ * @brief 为所有有被抑制记录的调用点输出汇总
+ *
+ * @return 输出的汇总条数
+ */
+size_t LogThrottle::reportSuppressed() {
+    int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    size_t reported = 0;
+    for (LogThrottle* site = sites.load(std::memory_order_acquire); site; site = site->next) {
+        if (site->report(now)) {
+            ++reported;
+        }
+    }
+    return reported;
+}
+
+/**
+ * @brief 所有调用点累计抑制的记录数
+ */
+uint64_t LogThrottle::totalSuppressed() {
+    uint64_t total = reportedSuppressed.load(std::memory_order_relaxed);
+    for (LogThrottle* site = sites.load(std::memory_order_acquire); site; site = site->next) {
+        total += site->pendingSuppressed();
+    }
+    return total;
+}
+
+} // namespace chat
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include "logger.hpp"
+
+/**
+ * @brief 按调用点限速记录日志
+ *
+ * 每个调用点有一个令牌桶，参数由 category 对应的 LogRateLimit 决定。
+ * 没有令牌时只计数、不对消息表达式求值；下一条放行的记录之前（或 LogThrottle::reportSuppressed
+ * 被调用时）输出一条 "N similar messages suppressed in last Xs" 汇总。
+ * 编译期和运行时的级别过滤与 CHAT_LOG 相同
+ */
+#define CHAT_LOG_THROTTLED(level, category, ...)                                          \
+    do {                                                                                  \
+        if constexpr (static_cast<int>(level) >= CHAT_LOG_MIN_LEVEL) {                    \
+            if (::chat::Logger::getInstance().isEnabled(level)) {                         \
+                static ::chat::LogThrottle chatLogThrottle_{level, category, __FILE__, __LINE__}; \
+                if (chatLogThrottle_.admit()) {                                           \
+                    ::chat::Logger::getInstance().log(level, __VA_ARGS__);                \
+                }                                                                         \
+            }                                                                             \
+        }                                                                                 \
+    } while (0)
+
+namespace chat {
+
+/**
+ * @brief 令牌桶参数
+ */
+struct LogRateLimit {
+    double perSecond = 1.0;   ///< 每秒补充的令牌数，不大于 0 表示不限速
+    uint32_t burst = 10;      ///< 桶容量，即允许的突发条数；为 0 时只输出汇总
+};
+
+/**
+ * @brief 一个日志调用点的限速状态，由 CHAT_LOG_THROTTLED 以静态变量的形式定义
+ *
+ * 令牌桶以 GCRA（理论到达时间）实现：只有一个原子时间戳，放行时 CAS 推进，
+ * 多个 I/O 线程同时出错时不需要加锁。参数按类别配置，修改后各调用点在下一次调用时重新读取。
+ *
+ * 调用点第一次使用时挂入全局链表且不会摘除，因此对象必须具有静态存储期。
+ */
+class LogThrottle {
+public:
+    /**
+     * @brief 构造函数（常量初始化，不分配内存）
+     * @param level 日志级别，汇总使用同一级别
+     * @param category 类别名，须为字符串字面量
+     * @param file 源文件
+     * @param line 行号
+     */
+    constexpr LogThrottle(LogLevel level, const char* category, const char* file, int line)
+        : level(level), category(category), file(file), line(line) {}
+
+    LogThrottle(const LogThrottle&) = delete;
+    LogThrottle& operator=(const LogThrottle&) = delete;
+
+    /**
+     * @brief 判断当前记录是否放行
+     *
+     * 放行且此前有被抑制的记录时，先输出汇总
+     *
+     * @return 放行时返回true，调用方随后记录日志
+     */
+    bool admit() {
+        return admit(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    /**
+     * @brief 以指定时间判断当前记录是否放行
+     * @param nowNanos steady_clock 纳秒时间
+     */
+    bool admit(int64_t nowNanos);
+
+    /**
+     * @brief 被抑制且尚未汇总的记录数
+     */
+    uint64_t pendingSuppressed() const { return suppressed.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief 设置某个类别的令牌桶参数
+     * @param category 类别名
+     * @param limit 令牌桶参数
+     */
+    static void setLimit(const std::string& category, const LogRateLimit& limit);
+
+    /**
+     * @brief 设置未单独配置的类别使用的令牌桶参数
+     * @param limit 令牌桶参数
+     */
+    static void setDefaultLimit(const LogRateLimit& limit);
+
+    /**
+     * @brief 清除所有类别的配置，恢复默认参数
+     */
+    static void resetLimits();
+
+    /**
+     * @brief 为所有有被抑制记录的调用点输出汇总
+     *
+     * 风暴结束后不会再有放行的记录带出汇总，应定期调用
+     *
+     * @return 输出的汇总条数
+     */
+    static size_t reportSuppressed();
+
+    /**
+     * @brief 所有调用点累计抑制的记录数
+     */
+    static uint64_t totalSuppressed();
+
+private:
+    /**
+     * @brief 重新读取类别参数，第一次调用时把调用点挂入全局链表
+     * @param nowNanos steady_clock 纳秒时间
+     */
+    void reload(int64_t nowNanos);
+
+    /**
+     * @brief 取走被抑制的计数并输出汇总
+     * @param nowNanos steady_clock 纳秒时间
+     * @return 有被抑制的记录并输出了汇总时返回true
+     */
+    bool report(int64_t nowNanos);
+
+    const LogLevel level;                        ///< 日志级别
+    const char* const category;                  ///< 类别名
+    const char* const file;                      ///< 源文件
+    const int line;                              ///< 行号
+
+    std::atomic<uint64_t> generation{0};         ///< 已读取的配置版本
+    std::atomic<int64_t> interval{0};            ///< 补充一个令牌的间隔（纳秒），0 表示不限速
+    std::atomic<int64_t> tolerance{0};           ///< 可提前放行的时长，即 (burst - 1) * interval
+    std::atomic<bool> blocked{false};            ///< burst 为 0，只输出汇总
+    std::atomic<int64_t> theoreticalArrival{0};  ///< GCRA 理论到达时间
+    std::atomic<uint64_t> suppressed{0};         ///< 被抑制且尚未汇总的记录数
+    std::atomic<int64_t> windowStart{0};         ///< 上一次输出记录或汇总的时间，0 表示尚未输出
+    std::atomic<bool> registered{false};         ///< 是否已挂入全局链表
+    LogThrottle* next = nullptr;                 ///< 全局链表中的下一个调用点
+
+    static std::atomic<uint64_t> configGeneration;   ///< 配置版本，每次修改加一
+    static std::atomic<LogThrottle*> sites;          ///< 全局调用点链表头
+    static std::atomic<uint64_t> reportedSuppressed; ///< 已汇总的抑制记录数
+};
+
+} // namespace chat
@@ -1,12 +1,164 @@
 #include "logger.hpp"
+#include "clock.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
 #include <iostream>
-#include <ctime>
+#include <utility>
+#include <vector>
+#ifdef CHAT_HAVE_ZLIB
+#include <zlib.h>
+#endif
 
 namespace chat {
 
+namespace {
+
+/// 轮转文件名中时间戳的长度：YYYYMMDD-HHMMSS
+constexpr size_t kRotationStampLength = 15;
+
+/**
+ * @brief 将时间格式化为轮转文件名中的 YYYYMMDD-HHMMSS
+ */
+std::string rotationStamp(time_t now) {
+    std::string_view text = Clock::format(now);   // YYYY-MM-DD HH:MM:SS
+    std::string stamp;
+    stamp.reserve(kRotationStampLength);
+    for (char c : text) {
+        if (c >= '0' && c <= '9') {
+            stamp.push_back(c);
+        }
+        if (stamp.size() == 8 && c == ' ') {
+            stamp.push_back('-');
+        }
+    }
+    return stamp;
+}
+
+/**
+ * @brief 解析轮转文件名 <文件名>.<YYYYMMDD-HHMMSS>[-N][.gz] 的后缀部分
+ *
+ * @param suffix 文件名中 "<文件名>." 之后的部分
+ * @param key 输出的排序键：时间戳和同一秒内的序号
+ * @return 符合轮转文件名格式时返回true
+ */
+bool parseRotatedSuffix(std::string_view suffix, std::pair<std::string, uint64_t>& key) {
+    constexpr std::string_view kGzip = ".gz";
+    if (suffix.size() >= kGzip.size() && suffix.substr(suffix.size() - kGzip.size()) == kGzip) {
+        suffix.remove_suffix(kGzip.size());
+    }
+    if (suffix.size() < kRotationStampLength) {
+        return false;
+    }
+    for (size_t i = 0; i < kRotationStampLength; ++i) {
+        bool digit = suffix[i] >= '0' && suffix[i] <= '9';
+        if ((i == 8) ? suffix[i] != '-' : !digit) {
+            return false;
+        }
+    }
+    key.first = std::string(suffix.substr(0, kRotationStampLength));
+    key.second = 0;
+    suffix.remove_prefix(kRotationStampLength);
+    if (suffix.empty()) {
+        return true;
+    }
+    if (suffix.size() < 2 || suffix.front() != '-') {
+        return false;
+    }
+    for (char c : suffix.substr(1)) {
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        key.second = key.second * 10 + static_cast<uint64_t>(c - '0');
+    }
+    return true;
+}
+
+/**
+ * @brief 将文件压缩为 <path>.gz 并删除原文件
+ *
+ * 先写入临时文件再改名，中途失败时保留原文件
+ *
+ * @param path 文件路径
+ */
+void compressFile(const std::string& path) {
+#ifdef CHAT_HAVE_ZLIB
+    std::string temp = path + ".gz.tmp";
+    std::ifstream in(path, std::ios::binary);
+    gzFile out = gzopen(temp.c_str(), "wb");
+    bool ok = in.is_open() && out != nullptr;
+    char buffer[64 << 10];
+    while (ok && (in.read(buffer, sizeof(buffer)) || in.gcount() > 0)) {
+        int size = static_cast<int>(in.gcount());
+        ok = gzwrite(out, buffer, static_cast<unsigned>(size)) == size;
+    }
+    if (out != nullptr && gzclose(out) != Z_OK) {
+        ok = false;
+    }
+    if (!ok || std::rename(temp.c_str(), (path + ".gz").c_str()) != 0) {
+        std::cerr << "Failed to compress rotated log file: " << path << std::endl;
+        std::remove(temp.c_str());
+        return;
+    }
+    std::remove(path.c_str());
+#else
+    (void)path;
+#endif
+}
+
+/**
+ * @brief 删除超出保留数的最旧轮转文件
+ *
+ * @param base 日志文件路径
+ * @param keepFiles 保留的轮转文件数
+ */
+void pruneRotated(const std::string& base, size_t keepFiles) {
+    namespace fs = std::filesystem;
+    fs::path basePath(base);
+    fs::path directory = basePath.has_parent_path() ? basePath.parent_path() : fs::path(".");
+    std::string prefix = basePath.filename().string() + ".";
+
+    std::vector<std::pair<std::pair<std::string, uint64_t>, fs::path>> rotated;
+    std::error_code ec;
+    for (fs::directory_iterator it(directory, ec), end; !ec && it != end; it.increment(ec)) {
+        std::string name = it->path().filename().string();
+        std::pair<std::string, uint64_t> key;
+        if (name.compare(0, prefix.size(), prefix) == 0 &&
+            parseRotatedSuffix(std::string_view(name).substr(prefix.size()), key)) {
+            rotated.emplace_back(std::move(key), it->path());
+        }
+    }
+    if (rotated.size() <= keepFiles) {
+        return;
+    }
+    std::sort(rotated.begin(), rotated.end());
+    for (size_t i = 0; i + keepFiles < rotated.size(); ++i) {
+        fs::remove(rotated[i].second, ec);
+    }
+}
+
+} // namespace
+
+/**
+ * @brief 获取日志级别的名称
+ *
+ * @param level 日志级别
+ * @return 名称
+ */
+const char* logLevelName(LogLevel level) {
+    switch (level) {
+        case LogLevel::Debug: return "DEBUG";
+        case LogLevel::Info:  return "INFO";
+        case LogLevel::Warn:  return "WARN";
+        case LogLevel::Error: return "ERROR";
+        case LogLevel::Off:   return "OFF";
+    }
+    return "UNKNOWN";
+}
+
 /**
  * @brief 获取Logger单例实例
- * 
+ *
  * 使用局部静态变量确保线程安全的单例模式
  */
 Logger& Logger::getInstance() {
@@ -16,10 +168,19 @@ Logger& Logger::getInstance() {
 
 /**
  * @brief 析构函数
- * 
- * 确保在对象销毁时关闭日志文件
+ *
+ * 写完异步队列中的记录并处理完轮转文件，确保在对象销毁时关闭日志文件
  */
 Logger::~Logger() {
+    stopWorker();
+    {
+        std::lock_guard<std::mutex> lock(maintenanceMutex);
+        maintenanceStopping = true;
+    }
+    maintenanceCondition.notify_one();
+    if (maintenance.joinable()) {
+        maintenance.join();
+    }
     if (logFile.is_open()) {
         logFile.close();
     }
@@ -27,13 +188,16 @@ Logger::~Logger() {
 
 /**
  * @brief 设置日志文件
- * 
+ *
  * 如果已经打开了一个日志文件，会先关闭它
  * 然后打开新的日志文件
- * 
+ *
  * @param filename 日志文件路径
  */
 void Logger::setLogFile(const std::string& filename) {
+    if (async.load()) {
+        flush();
+    }
     std::lock_guard<std::mutex> lock(logMutex);
     if (logFile.is_open()) {
         logFile.close();
@@ -43,31 +207,304 @@ void Logger::setLogFile(const std::string& filename) {
     if (!logFile.is_open()) {
         std::cerr << "Failed to open log file: " << filename << std::endl;
     }
+    std::error_code ec;
+    uintmax_t size = std::filesystem::file_size(filename, ec);
+    fileBytes = ec ? 0 : static_cast<uint64_t>(size);
+    scheduleRotationLocked(std::time(nullptr));
+}
+
+/**
+ * @brief 修改日志配置
+ *
+ * @param options 日志配置
+ */
+void Logger::configure(const LoggerOptions& options) {
+    stopWorker();
+    {
+        std::lock_guard<std::mutex> lock(logMutex);
+        this->options = options;
+        scheduleRotationLocked(std::time(nullptr));
+    }
+    if (options.mode == LogMode::Async) {
+        queue = std::make_unique<MpscQueue<LogRecord>>(options.queueCapacity);
+        stopping.store(false);
+        exited = false;
+        async.store(true);
+        worker = std::thread([this]() { run(); });
+    }
+}
+
+/**
+ * @brief 写完队列中的记录并停止后台线程
+ */
+void Logger::stopWorker() {
+    if (!worker.joinable()) {
+        return;
+    }
+    async.store(false);
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        stopping.store(true);
+        wakeCondition.notify_one();
+    }
+    worker.join();
 }
 
 /**
  * @brief 记录一条日志消息
- * 
- * 消息格式：[YYYY-MM-DD HH:MM:SS] message
- * 
+ *
+ * 消息格式：[YYYY-MM-DD HH:MM:SS] [LEVEL] message
+ *
+ * 异步模式下只在后台线程休眠且需要它立即写出（错误记录或队列过半）时才加锁唤醒
+ *
+ * @param level 日志级别
  * @param message 要记录的日志消息
  */
-void Logger::log(const std::string& message) {
+void Logger::log(LogLevel level, const std::string& message) {
+    if (!isEnabled(level)) {
+        return;
+    }
+    // 在加锁前格式化时间，Clock 的缓存是线程局部的
+    std::string_view timeStr = Clock::formatNow();
+    std::string_view levelName = logLevelName(level);
+    logged.fetch_add(1, std::memory_order_relaxed);
+
+    if (async.load(std::memory_order_acquire)) {
+        LogRecord record;
+        record.text.reserve(timeStr.size() + levelName.size() + message.size() + 7);
+        record.text.append("[").append(timeStr).append("] [").append(levelName).append("] ").append(message);
+        record.text.push_back('\n');
+        record.error = options.flushOnError && level >= LogLevel::Error;
+        bool error = record.error;
+        if (!queue->tryPush(std::move(record))) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        if (error) {
+            urgent.store(true);
+        }
+        if ((error || queue->sizeApprox() >= queue->capacity() / 2) && sleeping.load()) {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            wakeCondition.notify_one();
+        }
+        return;
+    }
+
     std::lock_guard<std::mutex> lock(logMutex);
     if (!logFile.is_open()) {
         std::cerr << "Log file not open" << std::endl;
         return;
     }
-    
-    // 获取当前时间并格式化为字符串
-    char timeStr[20];
-    time_t now = time(nullptr);
-    std::strftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M:%S", std::localtime(&now));
-    
+
+    rotateIfDueLocked(std::time(nullptr));
     // 写入日志消息
-    logFile << "[" << timeStr << "] " << message << std::endl;
+    logFile << "[" << timeStr << "] [" << levelName << "] " << message << std::endl;
     // 立即刷新缓冲区，确保日志被写入文件
     logFile.flush();
+    fileBytes += timeStr.size() + levelName.size() + message.size() + 7;
+    writes.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * @brief 等待此前的记录全部写入文件
+ *
+ * 同步模式下记录已在 log 返回前写入，这里只刷新文件流
+ */
+void Logger::flush() {
+    if (!async.load()) {
+        std::lock_guard<std::mutex> lock(logMutex);
+        logFile.flush();
+        return;
+    }
+    std::unique_lock<std::mutex> lock(wakeMutex);
+    uint64_t ticket = ++flushRequested;
+    wakeCondition.notify_one();
+    flushCondition.wait(lock, [this, ticket]() {
+        return flushCompleted >= ticket || exited;
+    });
+}
+
+/**
+ * @brief 获取日志统计
+ */
+LoggerStats Logger::getStats() const {
+    LoggerStats stats;
+    stats.logged = logged.load(std::memory_order_relaxed);
+    stats.dropped = dropped.load(std::memory_order_relaxed);
+    stats.writes = writes.load(std::memory_order_relaxed);
+    stats.rotations = rotations.load(std::memory_order_relaxed);
+    stats.queueDepth = queue ? queue->sizeApprox() : 0;
+    return stats;
+}
+
+/**
+ * @brief 后台线程主循环
+ *
+ * 不断把队列中的记录取到缓冲区，缓冲超过 flushBytes 时写出；
+ * 有错误记录、flush 请求、距上次写出超过 flushInterval 或正在停止时写出全部缓冲，
+ * 否则休眠至多 flushInterval
+ */
+void Logger::run() {
+    std::string buffer;
+    auto lastWrite = std::chrono::steady_clock::now();
+    auto drain = [this, &buffer]() {
+        LogRecord record;
+        while (queue->tryPop(record)) {
+            buffer.append(record.text);
+            if (buffer.size() >= options.flushBytes) {
+                writeBuffer(buffer);
+            }
+        }
+    };
+
+    for (;;) {
+        drain();
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        bool due = !buffer.empty() && std::chrono::steady_clock::now() - lastWrite >= options.flushInterval;
+        if (flushCompleted < flushRequested || urgent.load() || due || stopping.load()) {
+            uint64_t ticket = flushRequested;
+            bool stop = stopping.load();
+            urgent.store(false);
+            lock.unlock();
+            // 取得票号后再排空一次，保证 flush 之前的记录都已写出
+            drain();
+            if (!buffer.empty()) {
+                writeBuffer(buffer);
+            }
+            lastWrite = std::chrono::steady_clock::now();
+            lock.lock();
+            flushCompleted = ticket;
+            exited = stop;
+            flushCondition.notify_all();
+            if (stop) {
+                break;
+            }
+            continue;
+        }
+
+        sleeping.store(true);
+        wakeCondition.wait_for(lock, options.flushInterval, [this]() {
+            return stopping.load() || urgent.load() || flushCompleted < flushRequested ||
+                   queue->sizeApprox() >= queue->capacity() / 2;
+        });
+        sleeping.store(false);
+    }
+}
+
+/**
+ * @brief 将缓冲的记录写入文件并刷新，然后清空缓冲
+ *
+ * @param buffer 缓冲的记录
+ */
+void Logger::writeBuffer(std::string& buffer) {
+    {
+        std::lock_guard<std::mutex> lock(logMutex);
+        rotateIfDueLocked(std::time(nullptr));
+        if (logFile.is_open()) {
+            logFile.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            logFile.flush();
+            fileBytes += buffer.size();
+            writes.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            std::cerr << "Log file not open" << std::endl;
+        }
+    }
+    buffer.clear();
+}
+
+/**
+ * @brief 需要时轮转日志文件
+ *
+ * 文件达到 rotateBytes 或到达按时间轮转的时刻时，把当前文件改名为
+ * <文件名>.<YYYYMMDD-HHMMSS>（同一秒内重复时加 -N）并重新打开。
+ * 持锁期间只做改名和打开，压缩与删除旧文件交给后台线程
+ *
+ * @param now 当前时间
+ */
+void Logger::rotateIfDueLocked(time_t now) {
+    bool bySize = options.rotateBytes > 0 && fileBytes >= options.rotateBytes;
+    bool byTime = nextRotation != 0 && now >= nextRotation;
+    if (!logFile.is_open() || (!bySize && !byTime)) {
+        return;
+    }
+
+    // 同一秒内的序号只增不减：旧文件被后台删除后不能重用其名字，否则新文件会排在最前被当作最旧的删掉
+    std::string stamp = rotationStamp(now);
+    uint64_t index = (stamp == lastRotationStamp) ? lastRotationIndex + 1 : 0;
+    std::string rotated;
+    std::error_code ec;
+    for (;; ++index) {
+        rotated = currentLogFile + "." + stamp + (index > 0 ? "-" + std::to_string(index) : std::string());
+        if (!std::filesystem::exists(rotated, ec) && !std::filesystem::exists(rotated + ".gz", ec)) {
+            break;
+        }
+    }
+    lastRotationStamp = stamp;
+    lastRotationIndex = index;
+    logFile.close();
+    if (std::rename(currentLogFile.c_str(), rotated.c_str()) != 0) {
+        std::cerr << "Failed to rotate log file: " << currentLogFile << std::endl;
+    } else if (options.compressRotated || options.keepFiles > 0) {
+        {
+            std::lock_guard<std::mutex> lock(maintenanceMutex);
+            rotationJobs.push_back(RotationJob{currentLogFile, rotated, options.compressRotated, options.keepFiles});
+            if (!maintenance.joinable()) {
+                maintenance = std::thread([this]() { runMaintenance(); });
+            }
+        }
+        maintenanceCondition.notify_one();
+    }
+    logFile.open(currentLogFile, std::ios::app);
+    if (!logFile.is_open()) {
+        std::cerr << "Failed to open log file: " << currentLogFile << std::endl;
+    }
+    fileBytes = 0;
+    scheduleRotationLocked(now);
+    rotations.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * @brief 计算下一次按时间轮转的时刻
+ *
+ * 轮转时刻按本地时间对齐到 rotateInterval 的整数倍
+ *
+ * @param now 当前时间
+ */
+void Logger::scheduleRotationLocked(time_t now) {
+    time_t interval = static_cast<time_t>(options.rotateInterval.count());
+    if (interval <= 0) {
+        nextRotation = 0;
+        return;
+    }
+    time_t offset = static_cast<time_t>(Clock::utcOffset(now));
+    nextRotation = ((now + offset) / interval + 1) * interval - offset;
+}
+
+/**
+ * @brief 轮转文件后台线程主循环
+ *
+ * 依次压缩轮转出的文件并删除超出保留数的旧文件；停止时先处理完剩余的任务
+ */
+void Logger::runMaintenance() {
+    std::unique_lock<std::mutex> lock(maintenanceMutex);
+    for (;;) {
+        maintenanceCondition.wait(lock, [this]() {
+            return maintenanceStopping || !rotationJobs.empty();
+        });
+        if (rotationJobs.empty()) {
+            return;
+        }
+        RotationJob job = std::move(rotationJobs.front());
+        rotationJobs.pop_front();
+        lock.unlock();
+        if (job.compress) {
+            compressFile(job.rotated);
+        }
+        if (job.keepFiles > 0) {
+            pruneRotated(job.base, job.keepFiles);
+        }
+        lock.lock();
+    }
 }
 
-} // namespace chat 
\ No newline at end of file
+} // namespace chat
@@ -1,18 +1,115 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <ctime>
+#include <deque>
 #include <string>
 #include <fstream>
+#include <memory>
 #include <mutex>
+#include <thread>
+#include "mpsc_queue.hpp"
+
+/**
+ * @brief 编译期的最低日志级别（LogLevel 的数值）
+ *
+ * 低于该级别的 CHAT_LOG_* 调用在编译期被整个丢弃，参数不会求值，也不产生代码。
+ * 由构建系统定义，未定义时保留全部级别
+ */
+#ifndef CHAT_LOG_MIN_LEVEL
+#define CHAT_LOG_MIN_LEVEL 0
+#endif
+
+/**
+ * @brief 按级别记录日志
+ *
+ * 低于 CHAT_LOG_MIN_LEVEL 的级别在编译期丢弃；运行时级别未启用时不对消息表达式求值，
+ * 因此可以直接传入字符串拼接表达式
+ */
+#define CHAT_LOG(level, ...)                                                       \
+    do {                                                                           \
+        if constexpr (static_cast<int>(level) >= CHAT_LOG_MIN_LEVEL) {             \
+            ::chat::Logger& chatLogger_ = ::chat::Logger::getInstance();           \
+            if (chatLogger_.isEnabled(level)) {                                    \
+                chatLogger_.log(level, __VA_ARGS__);                               \
+            }                                                                      \
+        }                                                                          \
+    } while (0)
+
+#define CHAT_LOG_DEBUG(...) CHAT_LOG(::chat::LogLevel::Debug, __VA_ARGS__)
+#define CHAT_LOG_INFO(...) CHAT_LOG(::chat::LogLevel::Info, __VA_ARGS__)
+#define CHAT_LOG_WARN(...) CHAT_LOG(::chat::LogLevel::Warn, __VA_ARGS__)
+#define CHAT_LOG_ERROR(...) CHAT_LOG(::chat::LogLevel::Error, __VA_ARGS__)
 
 namespace chat {
 
+/**
+ * @brief 日志级别，从低到高
+ */
+enum class LogLevel {
+    Debug = 0,   ///< 调试信息，如连接建立和断开
+    Info = 1,    ///< 常规运行信息
+    Warn = 2,    ///< 可恢复的异常情况
+    Error = 3,   ///< 错误
+    Off = 4      ///< 关闭日志
+};
+
+/**
+ * @brief 获取日志级别的名称
+ * @param level 日志级别
+ * @return 名称（静态存储，无需释放）
+ */
+const char* logLevelName(LogLevel level);
+
+/**
+ * @brief 日志写入方式
+ */
+enum class LogMode {
+    Sync,   ///< 调用线程加锁写入并刷新，返回时日志已写入文件
+    Async   ///< 调用线程只把记录放入无锁队列，由后台线程批量写入
+};
+
+/**
+ * @brief 日志配置
+ */
+struct LoggerOptions {
+    LogMode mode = LogMode::Sync;                  ///< 写入方式
+    size_t queueCapacity = 16384;                  ///< 异步队列容量，队列满时新记录被丢弃
+    std::chrono::milliseconds flushInterval{1000}; ///< 异步模式下缓冲的记录最长多久写出一次
+    size_t flushBytes = 64 << 10;                  ///< 异步模式下缓冲超过该字节数时立即写出
+    bool flushOnError = true;                      ///< 异步模式下 Error 级别的记录是否立即写出
+    size_t rotateBytes = 0;                        ///< 文件达到该字节数后在下一次写入前轮转，0 表示不按大小轮转
+    std::chrono::seconds rotateInterval{0};        ///< 按本地时间对齐的轮转间隔（如 24 小时即每天零点），0 表示不按时间轮转
+    size_t keepFiles = 0;                          ///< 保留的轮转文件数，超出时删除最旧的，0 表示全部保留
+    bool compressRotated = false;                  ///< 是否在后台把轮转文件压缩为 .gz（需要以 zlib 构建）
+};
+
+/**
+ * @brief 日志统计
+ */
+struct LoggerStats {
+    uint64_t logged = 0;     ///< 记录数
+    uint64_t dropped = 0;    ///< 异步队列已满而丢弃的记录数
+    uint64_t writes = 0;     ///< 写入并刷新文件的次数
+    uint64_t rotations = 0;  ///< 轮转次数
+    size_t queueDepth = 0;   ///< 异步队列中的记录数（近似值）
+};
+
 /**
  * @brief 日志记录器类，使用单例模式实现
- * 
+ *
  * 提供线程安全的日志记录功能，支持：
  * - 设置日志文件
- * - 记录带时间戳的日志消息
- * - 自动刷新日志缓冲区
+ * - 记录带时间戳和级别的日志消息，低于当前级别的记录被忽略
+ * - 同步模式：每条记录加锁写入并立即刷新（默认，便于测试）
+ * - 异步模式：调用线程格式化后放入有界无锁队列，不加锁、不做系统调用；
+ *   后台线程批量写入，按 flushInterval、flushBytes 和 flushOnError 决定何时写出
+ * - 按大小或时间轮转：写入前把当前文件改名为 <文件名>.<YYYYMMDD-HHMMSS> 并重新打开，
+ *   压缩和按保留数删除旧文件由独立的后台线程完成，不阻塞写入
+ *
+ * 应通过 CHAT_LOG_* 宏记录日志，以便在级别未启用时跳过参数求值。
  */
 class Logger {
 public:
@@ -21,37 +118,163 @@ public:
      * @return Logger实例的引用
      */
     static Logger& getInstance();
-    
+
+    /**
+     * @brief 记录一条 Info 级别的日志消息
+     * @param message 要记录的日志消息
+     */
+    void log(const std::string& message) { log(LogLevel::Info, message); }
+
     /**
      * @brief 记录一条日志消息
+     * @param level 日志级别，低于当前级别时忽略
      * @param message 要记录的日志消息
      */
-    void log(const std::string& message);
+    void log(LogLevel level, const std::string& message);
+
+    /**
+     * @brief 某个级别当前是否启用
+     * @param level 日志级别
+     * @return 不低于当前级别时返回true
+     */
+    bool isEnabled(LogLevel level) const {
+        return static_cast<int>(level) >= minLevel.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 设置运行时的最低日志级别
+     * @param level 最低级别，默认为 Info
+     */
+    void setLevel(LogLevel level) { minLevel.store(static_cast<int>(level), std::memory_order_relaxed); }
 
     /**
      * @brief 设置日志文件
+     *
+     * 异步模式下先写出此前的记录，保证它们写入原来的文件
+     *
      * @param filename 日志文件路径
      */
     void setLogFile(const std::string& filename);
 
+    /**
+     * @brief 修改日志配置
+     *
+     * 先写完异步队列中的记录并停止后台线程，再按新配置启动。
+     * 不能与 log 并发调用，应在程序启动或退出时使用
+     *
+     * @param options 日志配置
+     */
+    void configure(const LoggerOptions& options);
+
+    /**
+     * @brief 等待此前的记录全部写入文件
+     */
+    void flush();
+
+    /**
+     * @brief 获取日志统计
+     */
+    LoggerStats getStats() const;
+
 private:
+    /**
+     * @brief 异步队列中的一条记录
+     */
+    struct LogRecord {
+        std::string text;     ///< 带时间戳和换行符的完整一行
+        bool error = false;   ///< 是否为错误记录
+    };
+
     /**
      * @brief 私有构造函数，防止外部创建实例
      */
     Logger() = default;
 
     /**
-     * @brief 析构函数，确保关闭日志文件
+     * @brief 析构函数，写完异步队列中的记录并关闭日志文件
      */
     ~Logger();
-    
+
     // 禁止拷贝和赋值
     Logger(const Logger&) = delete;
     Logger& operator=(const Logger&) = delete;
-    
+
+    /**
+     * @brief 轮转后交给后台处理的文件
+     */
+    struct RotationJob {
+        std::string base;       ///< 日志文件路径
+        std::string rotated;    ///< 改名后的路径
+        bool compress;          ///< 是否压缩
+        size_t keepFiles;       ///< 保留的轮转文件数
+    };
+
+    /**
+     * @brief 写完队列中的记录并停止后台线程
+     */
+    void stopWorker();
+
+    /**
+     * @brief 需要时轮转日志文件，调用方持有 logMutex
+     * @param now 当前时间
+     */
+    void rotateIfDueLocked(time_t now);
+
+    /**
+     * @brief 计算下一次按时间轮转的时刻，调用方持有 logMutex
+     * @param now 当前时间
+     */
+    void scheduleRotationLocked(time_t now);
+
+    /**
+     * @brief 轮转文件后台线程主循环：压缩并删除超出保留数的旧文件
+     */
+    void runMaintenance();
+
+    /**
+     * @brief 后台线程主循环
+     */
+    void run();
+
+    /**
+     * @brief 将缓冲的记录写入文件并刷新，然后清空缓冲
+     */
+    void writeBuffer(std::string& buffer);
+
     std::ofstream logFile;        ///< 日志文件流
-    std::mutex logMutex;          ///< 用于线程同步的互斥锁
+    std::mutex logMutex;          ///< 保护日志文件
     std::string currentLogFile;   ///< 当前日志文件路径
+    uint64_t fileBytes = 0;       ///< 当前文件的字节数，受 logMutex 保护
+    time_t nextRotation = 0;      ///< 下一次按时间轮转的时刻，0 表示不按时间轮转，受 logMutex 保护
+    std::string lastRotationStamp;  ///< 上一次轮转文件名中的时间部分，受 logMutex 保护
+    uint64_t lastRotationIndex = 0; ///< 上一次轮转在同一秒内的序号，受 logMutex 保护
+
+    std::atomic<int> minLevel{static_cast<int>(LogLevel::Info)};  ///< 运行时的最低日志级别
+    LoggerOptions options;                        ///< 日志配置
+    std::atomic<bool> async{false};               ///< 是否处于异步模式
+    std::unique_ptr<MpscQueue<LogRecord>> queue;  ///< 异步队列，停止后保留到下次启动
+    std::thread worker;                           ///< 后台写入线程
+    std::mutex wakeMutex;                         ///< 配合条件变量使用
+    std::condition_variable wakeCondition;        ///< 唤醒后台线程
+    std::condition_variable flushCondition;       ///< 通知 flush 调用方
+    std::atomic<bool> sleeping{false};            ///< 后台线程是否在等待
+    std::atomic<bool> urgent{false};              ///< 是否有需要立即写出的错误记录
+    std::atomic<bool> stopping{false};            ///< 是否正在停止
+    // 以下三项受 wakeMutex 保护
+    uint64_t flushRequested = 0;                  ///< 已发出的 flush 请求票号
+    uint64_t flushCompleted = 0;                  ///< 已完成的 flush 请求票号
+    bool exited = false;                          ///< 后台线程是否已退出
+
+    std::atomic<uint64_t> logged{0};              ///< 记录数
+    std::atomic<uint64_t> dropped{0};             ///< 丢弃的记录数
+    std::atomic<uint64_t> writes{0};              ///< 写入次数
+    std::atomic<uint64_t> rotations{0};           ///< 轮转次数
+
+    std::thread maintenance;                      ///< 轮转文件后台线程，第一次轮转时启动
+    std::mutex maintenanceMutex;                  ///< 保护以下两项
+    std::condition_variable maintenanceCondition; ///< 唤醒轮转文件后台线程
+    std::deque<RotationJob> rotationJobs;         ///< 待处理的轮转文件
+    bool maintenanceStopping = false;             ///< 轮转文件后台线程是否正在停止
 };
 
-} // namespace chat 
\ No newline at end of file
+} // namespace chat
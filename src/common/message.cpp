@@ -1,23 +1,157 @@
 #include "message.hpp"
-#include <sstream>
-#include <iomanip>
+#include "clock.hpp"
+#include "wire_format.hpp"
+#include <stdexcept>
 
 namespace chat {
 
+namespace {
+
+/**
+ * @brief 从指定位置读取固定位数的十进制数字
+ *
+ * @param str 输入字符串
+ * @param pos 起始位置
+ * @param width 数字位数
+ * @param value 输出的数值
+ * @return 全部为数字时返回true
+ */
+bool parseDigits(std::string_view str, size_t pos, size_t width, int& value) {
+    int result = 0;
+    for (size_t i = pos; i < pos + width; ++i) {
+        unsigned digit = static_cast<unsigned>(str[i] - '0');
+        if (digit > 9) {
+            return false;
+        }
+        result = result * 10 + static_cast<int>(digit);
+    }
+    value = result;
+    return true;
+}
+
+/**
+ * @brief 将本地时间字段转换为time_t
+ *
+ * mktime 开销较大且会访问时区数据，这里按小时缓存其结果：
+ * 时区偏移只会在整点切换，同一小时内的秒数直接累加即可。
+ * 缓存为线程局部变量，无需加锁。
+ */
+time_t localTimeToEpoch(int year, int month, int day, int hour, int minute, int second) {
+    struct HourCache {
+        int year = -1;
+        int month = 0;
+        int day = 0;
+        int hour = 0;
+        time_t base = 0;
+    };
+    thread_local HourCache cache;
+
+    if (cache.year != year || cache.month != month || cache.day != day || cache.hour != hour) {
+        std::tm tm = {};
+        tm.tm_year = year - 1900;
+        tm.tm_mon = month - 1;
+        tm.tm_mday = day;
+        tm.tm_hour = hour;
+        tm.tm_isdst = -1;
+        cache.base = std::mktime(&tm);
+        cache.year = year;
+        cache.month = month;
+        cache.day = day;
+        cache.hour = hour;
+    }
+    return cache.base + minute * 60 + second;
+}
+
+/**
+ * @brief 解析 YYYY-MM-DD HH:MM:SS 格式的时间字符串
+ *
+ * @param str 时间字符串（已去除前导空白）
+ * @param timestamp 输出的时间戳
+ * @return 格式正确时返回true
+ */
+bool parseTimestamp(std::string_view str, time_t& timestamp) {
+    constexpr size_t kTimeLength = 19;  // "YYYY-MM-DD HH:MM:SS"
+    if (str.size() < kTimeLength) {
+        return false;
+    }
+    // 只允许时间后跟随空白字符（例如文件中的 '\r'）
+    if (str.find_first_not_of(" \t\r\n", kTimeLength) != std::string_view::npos) {
+        return false;
+    }
+    if (str[4] != '-' || str[7] != '-' || str[10] != ' ' || str[13] != ':' || str[16] != ':') {
+        return false;
+    }
+
+    int year, month, day, hour, minute, second;
+    if (!parseDigits(str, 0, 4, year) || !parseDigits(str, 5, 2, month) ||
+        !parseDigits(str, 8, 2, day) || !parseDigits(str, 11, 2, hour) ||
+        !parseDigits(str, 14, 2, minute) || !parseDigits(str, 17, 2, second)) {
+        return false;
+    }
+    if (month < 1 || month > 12 || day < 1 || day > 31 ||
+        hour > 23 || minute > 59 || second > 60) {
+        return false;
+    }
+
+    timestamp = localTimeToEpoch(year, month, day, hour, minute, second);
+    return true;
+}
+
+} // namespace
+
+/**
+ * @brief 获取解析错误码对应的描述
+ *
+ * @param error 解析错误码
+ * @return 错误描述字符串
+ */
+const char* parseErrorMessage(ParseError error) {
+    switch (error) {
+        case ParseError::None:               return "no error";
+        case ParseError::MissingSeparator:   return "missing required separators";
+        case ParseError::EmptyUsername:      return "empty username";
+        case ParseError::EmptyContent:       return "empty content";
+        case ParseError::EmptyTimestamp:     return "empty timestamp";
+        case ParseError::InvalidTimestamp:   return "invalid timestamp format";
+        case ParseError::Truncated:          return "truncated binary frame";
+        case ParseError::UnsupportedVersion: return "unsupported binary frame version";
+        case ParseError::TrailingData:       return "trailing data after binary frame";
+    }
+    return "unknown error";
+}
+
+/**
+ * @brief 检查房间名是否合法
+ *
+ * @param room 房间名
+ * @return 合法时返回true
+ */
+bool isValidRoomName(std::string_view room) {
+    if (room.empty() || room.size() > kMaxRoomNameLength) {
+        return false;
+    }
+    for (char c : room) {
+        if (static_cast<unsigned char>(c) <= ' ' || c == '\x7f') {
+            return false;
+        }
+    }
+    return true;
+}
+
 /**
  * @brief 将消息转换为字符串格式
  * 
  * 格式：username @ content | YYYY-MM-DD HH:MM:SS
  * 例如：alice @ 你好 | 2025-04-16 10:00:00
+ *
+ * 时间字符串来自 Clock 的线程局部缓存，结果一次性预留容量后直接拼接。
  */
 std::string Message::toString() const {
-    std::stringstream ss;
-    char timeStr[20];
-    // 将时间戳转换为可读的日期时间字符串
-    std::strftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M:%S", std::localtime(&timestamp));
-    // 按照指定格式组合消息
-    ss << username << " @ " << content << " | " << timeStr;
-    return ss.str();
+    std::string_view timeStr = Clock::format(timestamp);
+    std::string result;
+    result.reserve(username.size() + content.size() + timeStr.size() + 6);
+    result.append(username).append(" @ ").append(content).append(" | ").append(timeStr);
+    return result;
 }
 
 /**
@@ -31,51 +165,163 @@ std::string Message::toString() const {
  * @throw std::runtime_error 当字符串格式不正确时抛出异常
  */
 Message Message::fromString(const std::string& str) {
-    // 验证基本格式
-    if (str.empty() || str.find('@') == std::string::npos || str.find('|') == std::string::npos) {
-        throw std::runtime_error("Invalid message format: missing required separators");
-    }
-
-    std::stringstream ss(str);
-    std::string username, content, timeStr;
-    
-    // 解析用户名（@符号前的部分）
-    std::getline(ss, username, '@');
-    if (username.empty()) {
-        throw std::runtime_error("Invalid message format: empty username");
-    }
-    // 去除用户名前后的空白字符
-    username = username.substr(0, username.find_last_not_of(" \t") + 1);
-    
-    // 解析消息内容（@和|之间的部分）
-    std::getline(ss, content, '|');
-    if (content.empty()) {
-        throw std::runtime_error("Invalid message format: empty content");
-    }
-    // 去除内容前后的空白字符
-    content = content.substr(content.find_first_not_of(" \t"), 
-                           content.find_last_not_of(" \t") - content.find_first_not_of(" \t") + 1);
-    
-    // 解析时间戳（|后的部分）
-    std::getline(ss, timeStr);
-    if (timeStr.empty()) {
-        throw std::runtime_error("Invalid message format: empty timestamp");
-    }
-    timeStr = timeStr.substr(timeStr.find_first_not_of(" \t"));
-    
-    // 创建消息对象
-    Message msg(username, content);
-    
-    // 解析时间字符串为time_t类型
-    std::tm tm = {};
-    std::stringstream timeStream(timeStr);
-    timeStream >> std::get_time(&tm, "%Y-%m-%d %H:%M:%S");
-    if (timeStream.fail()) {
-        throw std::runtime_error("Invalid message format: invalid timestamp format");
-    }
-    msg.timestamp = std::mktime(&tm);
-    
+    Message msg("", "");
+    ParseError error = parse(str, msg);
+    if (error != ParseError::None) {
+        throw std::runtime_error(std::string("Invalid message format: ") + parseErrorMessage(error));
+    }
     return msg;
 }
 
-} // namespace chat 
\ No newline at end of file
+/**
+ * @brief 单遍解析消息
+ *
+ * 依次定位 '@' 和其后的第一个 '|'，各字段以 string_view 切片方式去除空白，
+ * 仅在最后将用户名和内容写入 out。时间戳按固定宽度直接解析，
+ * 不经过 stringstream/get_time。
+ *
+ * 字段规则与 fromString 保持一致：
+ * - 用户名为 '@' 之前的部分，去除尾部空白
+ * - 内容为 '@' 与 '|' 之间的部分，去除首尾空白
+ * - 时间戳为 '|' 之后的部分，去除前导空白
+ *
+ * @param str 格式化的消息字符串
+ * @param out 用于接收解析结果的消息对象
+ * @return 解析错误码
+ */
+ParseError Message::parse(std::string_view str, Message& out) {
+    constexpr std::string_view kBlank = " \t";
+
+    size_t at = str.find('@');
+    if (at == std::string_view::npos) {
+        return ParseError::MissingSeparator;
+    }
+    size_t bar = str.find('|', at + 1);
+    if (bar == std::string_view::npos) {
+        return ParseError::MissingSeparator;
+    }
+
+    // 用户名：去除尾部空白
+    std::string_view user = str.substr(0, at);
+    size_t userEnd = user.find_last_not_of(kBlank);
+    if (userEnd == std::string_view::npos) {
+        return ParseError::EmptyUsername;
+    }
+    user = user.substr(0, userEnd + 1);
+
+    // 内容：去除首尾空白
+    std::string_view content = str.substr(at + 1, bar - at - 1);
+    size_t contentBegin = content.find_first_not_of(kBlank);
+    if (contentBegin == std::string_view::npos) {
+        return ParseError::EmptyContent;
+    }
+    content = content.substr(contentBegin, content.find_last_not_of(kBlank) - contentBegin + 1);
+
+    // 时间戳：去除前导空白
+    std::string_view timeStr = str.substr(bar + 1);
+    size_t timeBegin = timeStr.find_first_not_of(kBlank);
+    if (timeBegin == std::string_view::npos) {
+        return ParseError::EmptyTimestamp;
+    }
+    time_t timestamp;
+    if (!parseTimestamp(timeStr.substr(timeBegin), timestamp)) {
+        return ParseError::InvalidTimestamp;
+    }
+
+    out.username.assign(user.data(), user.size());
+    out.content.assign(content.data(), content.size());
+    out.timestamp = timestamp;
+    out.id = 0;  // 文本格式不携带消息编号和房间
+    out.room.clear();
+    return ParseError::None;
+}
+
+/**
+ * @brief 将消息编码为二进制帧
+ *
+ * @return 编码后的二进制数据
+ */
+std::string Message::toBinary() const {
+    std::string out;
+    appendBinary(out);
+    return out;
+}
+
+/**
+ * @brief 将消息的二进制编码追加到缓冲区
+ *
+ * 时间戳以毫秒为单位编码，便于今后提高精度而不改变格式。
+ *
+ * @param out 输出缓冲区
+ */
+void Message::appendBinary(std::string& out) const {
+    // 版本号 + 2 个最长 10 字节的变长整数 + 3 个长度前缀
+    out.reserve(out.size() + 1 + 50 + room.size() + username.size() + content.size());
+    out.push_back(static_cast<char>(kBinaryFormatVersion));
+    appendVarint(out, id);
+    appendVarint(out, zigzagEncode(static_cast<int64_t>(timestamp) * 1000));
+    appendVarint(out, room.size());
+    out.append(room);
+    appendVarint(out, username.size());
+    out.append(username);
+    appendVarint(out, content.size());
+    out.append(content);
+}
+
+/**
+ * @brief 解析二进制帧
+ *
+ * 各字段均带长度前缀，无需扫描分隔符，内容可以包含任意字节（包括 '@' 和 '|'）。
+ *
+ * @param data 二进制帧数据
+ * @param out 用于接收解析结果的消息对象
+ * @return 解析错误码
+ */
+ParseError Message::parseBinary(std::string_view data, Message& out) {
+    if (data.empty()) {
+        return ParseError::Truncated;
+    }
+    if (static_cast<uint8_t>(data[0]) != kBinaryFormatVersion) {
+        return ParseError::UnsupportedVersion;
+    }
+    data.remove_prefix(1);
+
+    uint64_t id, timestampMs, roomLength, userLength, contentLength;
+    if (!readVarint(data, id) || !readVarint(data, timestampMs) ||
+        !readVarint(data, roomLength) || roomLength > data.size()) {
+        return ParseError::Truncated;
+    }
+    std::string_view room = data.substr(0, roomLength);
+    data.remove_prefix(roomLength);
+
+    if (!readVarint(data, userLength) || userLength > data.size()) {
+        return ParseError::Truncated;
+    }
+    std::string_view user = data.substr(0, userLength);
+    data.remove_prefix(userLength);
+
+    if (!readVarint(data, contentLength) || contentLength > data.size()) {
+        return ParseError::Truncated;
+    }
+    std::string_view content = data.substr(0, contentLength);
+    data.remove_prefix(contentLength);
+
+    if (!data.empty()) {
+        return ParseError::TrailingData;
+    }
+    if (user.empty()) {
+        return ParseError::EmptyUsername;
+    }
+    if (content.empty()) {
+        return ParseError::EmptyContent;
+    }
+
+    out.username.assign(user.data(), user.size());
+    out.content.assign(content.data(), content.size());
+    out.timestamp = static_cast<time_t>(zigzagDecode(timestampMs) / 1000);
+    out.id = id;
+    out.room.assign(room.data(), room.size());
+    return ParseError::None;
+}
+
+} // namespace chat
@@ -1,20 +1,70 @@
 #pragma once
 
 #include <string>
+#include <string_view>
+#include <cstdint>
 #include <ctime>
 
 namespace chat {
 
+/**
+ * @brief 消息解析错误码
+ *
+ * 由 Message::parse 返回，热路径上用于替代异常
+ */
+enum class ParseError {
+    None = 0,            ///< 解析成功
+    MissingSeparator,    ///< 缺少 '@' 或 '|' 分隔符
+    EmptyUsername,       ///< 用户名为空
+    EmptyContent,        ///< 消息内容为空
+    EmptyTimestamp,      ///< 时间戳为空
+    InvalidTimestamp,    ///< 时间戳格式错误
+    Truncated,           ///< 二进制帧长度不足或变长整数不完整
+    UnsupportedVersion,  ///< 二进制帧版本号不受支持
+    TrailingData         ///< 二进制帧末尾存在多余数据
+};
+
+/**
+ * @brief 获取解析错误码对应的描述
+ * @param error 解析错误码
+ * @return 错误描述字符串（静态存储，无需释放）
+ */
+const char* parseErrorMessage(ParseError error);
+
+/// 新连接默认加入的房间
+constexpr const char* kDefaultRoom = "lobby";
+
+/// 房间名的最大长度
+constexpr size_t kMaxRoomNameLength = 64;
+
+/**
+ * @brief 检查房间名是否合法
+ *
+ * 房间名非空、不超过 kMaxRoomNameLength 字节，且不含空白和控制字符
+ *
+ * @param room 房间名
+ * @return 合法时返回true
+ */
+bool isValidRoomName(std::string_view room);
+
 /**
  * @brief 聊天消息类，用于封装聊天消息的各个属性
- * 
- * 消息格式：username @ content | timestamp
+ *
+ * 文本格式：username @ content | timestamp
  * 例如：alice @ 你好 | 2025-04-16 10:00:00
+ *
+ * 二进制格式（子协议 chatcpp.binary.v2）：
+ * version(u8) | id(varint) | zigzag(timestamp_ms)(varint) |
+ * len(varint) room | len(varint) username | len(varint) content
+ *
+ * 文本格式不携带房间，收到的文本消息归入连接当前所在的房间。
  */
 struct Message {
     std::string username;    ///< 发送者的用户名
     std::string content;     ///< 消息内容
     time_t timestamp;        ///< 消息发送时间戳
+    uint64_t id;             ///< 服务器分配的消息编号，0 表示未分配
+    std::string room;        ///< 所属房间，为空表示由服务器按连接当前房间决定
 
     /**
      * @brief 构造函数
@@ -22,7 +72,7 @@ struct Message {
      * @param msg 消息内容
      */
     Message(const std::string& user, const std::string& msg)
-        : username(user), content(msg), timestamp(std::time(nullptr)) {}
+        : username(user), content(msg), timestamp(std::time(nullptr)), id(0) {}
 
     /**
      * @brief 将消息转换为字符串格式
@@ -38,6 +88,41 @@ struct Message {
      */
     static Message fromString(const std::string& str);
 
+    /**
+     * @brief 单遍解析消息，不抛出异常
+     *
+     * 直接在 string_view 上扫描，除写入 out 的 username/content 外不做堆分配。
+     * 解析失败时 out 的内容未定义。
+     *
+     * @param str 格式化的消息字符串
+     * @param out 用于接收解析结果的消息对象（可复用以避免重复分配）
+     * @return 解析错误码，成功时为 ParseError::None
+     */
+    static ParseError parse(std::string_view str, Message& out);
+
+    /**
+     * @brief 将消息编码为二进制帧
+     * @return 编码后的二进制数据
+     */
+    std::string toBinary() const;
+
+    /**
+     * @brief 将消息的二进制编码追加到缓冲区
+     * @param out 输出缓冲区（可复用以避免重复分配）
+     */
+    void appendBinary(std::string& out) const;
+
+    /**
+     * @brief 解析二进制帧，不抛出异常
+     *
+     * 除写入 out 的 username/content 外不做堆分配，解析失败时 out 的内容未定义。
+     *
+     * @param data 二进制帧数据
+     * @param out 用于接收解析结果的消息对象
+     * @return 解析错误码，成功时为 ParseError::None
+     */
+    static ParseError parseBinary(std::string_view data, Message& out);
+
     /**
      * @brief 更新消息内容
      * @param new_content 新的消息内容
@@ -48,4 +133,4 @@ struct Message {
     }
 };
 
-} // namespace chat 
\ No newline at end of file
+} // namespace chat
\ No newline at end of file
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace chat {
+
+/**
+ * @brief 有界无锁多生产者队列
+ *
+ * 基于 Dmitry Vyukov 的有界队列：每个槽位带一个序号，生产者和消费者
+ * 各自通过 CAS 推进位置，无需互斥锁。容量向上取整为 2 的幂。
+ *
+ * 任意线程均可 tryPush；tryPop 也是线程安全的，但本项目中每个队列
+ * 只有一个消费线程。
+ *
+ * @tparam T 元素类型，需可移动构造
+ */
+template <typename T>
+class MpscQueue {
+public:
+    /**
+     * @brief 构造函数
+     * @param capacity 最小容量（至少为 2）
+     */
+    explicit MpscQueue(size_t capacity) : mask(roundUpPowerOfTwo(capacity) - 1),
+                                          slots(new Slot[mask + 1]) {
+        for (size_t i = 0; i <= mask; ++i) {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief 析构函数，销毁队列中剩余的元素
+     */
+    ~MpscQueue() {
+        // 析构时已无并发访问，直接销毁已入队的元素
+        size_t tail = enqueuePos.load(std::memory_order_relaxed);
+        for (size_t pos = dequeuePos.load(std::memory_order_relaxed); pos != tail; ++pos) {
+            Slot& slot = slots[pos & mask];
+            if (slot.sequence.load(std::memory_order_relaxed) == pos + 1) {
+                std::launder(reinterpret_cast<T*>(&slot.storage))->~T();
+            }
+        }
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    /**
+     * @brief 尝试入队
+     * @param item 要入队的元素
+     * @return 队列已满时返回false，此时 item 不被移动
+     */
+    template <typename U>
+    bool tryPush(U&& item) {
+        size_t pos = enqueuePos.load(std::memory_order_relaxed);
+        Slot* slot;
+        for (;;) {
+            slot = &slots[pos & mask];
+            size_t seq = slot->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+        new (&slot->storage) T(std::forward<U>(item));
+        slot->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief 尝试出队
+     * @param item 接收出队元素
+     * @return 队列为空时返回false
+     */
+    bool tryPop(T& item) {
+        size_t pos = dequeuePos.load(std::memory_order_relaxed);
+        Slot* slot;
+        for (;;) {
+            slot = &slots[pos & mask];
+            size_t seq = slot->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+        T* stored = std::launder(reinterpret_cast<T*>(&slot->storage));
+        item = std::move(*stored);
+        stored->~T();
+        slot->sequence.store(pos + mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief 获取队列容量
+     * @return 实际容量（2 的幂）
+     */
+    size_t capacity() const { return mask + 1; }
+
+    /**
+     * @brief 获取近似元素个数
+     *
+     * 并发修改时只是一个快照，仅用于统计
+     *
+     * @return 近似元素个数
+     */
+    size_t sizeApprox() const {
+        size_t tail = enqueuePos.load(std::memory_order_relaxed);
+        size_t head = dequeuePos.load(std::memory_order_relaxed);
+        return tail > head ? tail - head : 0;
+    }
+
+private:
+    /**
+     * @brief 队列槽位
+     */
+    struct Slot {
+        std::atomic<size_t> sequence{0};  ///< 槽位序号，决定当前可由生产者还是消费者使用
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;  ///< 元素存储
+    };
+
+    static size_t roundUpPowerOfTwo(size_t value) {
+        size_t result = 2;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    // 避免生产者和消费者的位置落在同一缓存行
+    static constexpr size_t kCacheLine = 64;
+
+    const size_t mask;                                  ///< 容量减一
+    std::unique_ptr<Slot[]> slots;                      ///< 槽位数组
+    alignas(kCacheLine) std::atomic<size_t> enqueuePos{0};  ///< 下一个入队位置
+    alignas(kCacheLine) std::atomic<size_t> dequeuePos{0};  ///< 下一个出队位置
+};
+
+} // namespace chat
@@ -0,0 +1,118 @@
+#include "slab_allocator.hpp"
+#include <algorithm>
+#include <new>
+
+namespace chat {
+
+/**
+ * @brief 构造函数
+ *
+ * @param chunkBytes 每次向系统申请的块大小
+ */
+SlabPool::SlabPool(size_t chunkBytes) : chunkBytes(std::max(chunkBytes, kMaxSlot)) {}
+
+/**
+ * @brief 析构函数，释放所有块
+ */
+SlabPool::~SlabPool() {
+    for (void* chunk : chunks) {
+        ::operator delete(chunk);
+    }
+}
+
+/**
+ * @brief 请求大小对应的规格下标
+ *
+ * @param bytes 请求的字节数，不超过 kMaxSlot
+ * @return 规格下标，槽位大小为 kMinSlot << 下标
+ */
+size_t SlabPool::classOf(size_t bytes) {
+    if (bytes <= kMinSlot) {
+        return 0;
+    }
+    // 向上取整到 2 的幂：bytes - 1 的最高位加一
+    size_t bits = 64 - static_cast<size_t>(__builtin_clzll(bytes - 1));
+    return bits - 4;
+}
+
+/**
+ * @brief 一次分配实际占用的字节数
+ *
+ * @param bytes 请求的字节数
+ * @return 槽位大小，超过 kMaxSlot 时为 bytes
+ */
+size_t SlabPool::slotSize(size_t bytes) {
+    return bytes > kMaxSlot ? bytes : kMinSlot << classOf(bytes);
+}
+
+/**
+ * @brief 申请一个新块并切成指定规格的槽位
+ *
+ * 槽位按地址顺序挂入链表，先分配的槽位相邻，便于顺序访问
+ *
+ * @param sizeClass 规格下标
+ */
+void SlabPool::refill(size_t sizeClass) {
+    size_t slot = kMinSlot << sizeClass;
+    size_t count = chunkBytes / slot;
+    char* chunk = static_cast<char*>(::operator new(count * slot));
+    chunks.push_back(chunk);
+    ++stats.chunks;
+    ++stats.systemAllocations;
+    stats.reservedBytes += count * slot;
+
+    FreeSlot* head = freeLists[sizeClass];
+    for (size_t i = count; i-- > 0;) {
+        FreeSlot* free = reinterpret_cast<FreeSlot*>(chunk + i * slot);
+        free->next = head;
+        head = free;
+    }
+    freeLists[sizeClass] = head;
+}
+
+/**
+ * @brief 分配内存
+ *
+ * @param bytes 字节数
+ * @return 内存地址
+ */
+void* SlabPool::allocate(size_t bytes) {
+    ++stats.allocations;
+    if (bytes > kMaxSlot) {
+        ++stats.systemAllocations;
+        stats.largeBytes += bytes;
+        return ::operator new(bytes);
+    }
+    size_t sizeClass = classOf(bytes);
+    if (!freeLists[sizeClass]) {
+        refill(sizeClass);
+    }
+    FreeSlot* slot = freeLists[sizeClass];
+    freeLists[sizeClass] = slot->next;
+    stats.usedBytes += kMinSlot << sizeClass;
+    return slot;
+}
+
+/**
+ * @brief 释放内存
+ *
+ * @param pointer allocate 返回的地址
+ * @param bytes 分配时的字节数
+ */
+void SlabPool::deallocate(void* pointer, size_t bytes) noexcept {
+    if (!pointer) {
+        return;
+    }
+    if (bytes > kMaxSlot) {
+        stats.largeBytes -= bytes;
+        ::operator delete(pointer);
+        return;
+    }
+    size_t sizeClass = classOf(bytes);
+    FreeSlot* slot = static_cast<FreeSlot*>(pointer);
+    slot->next = freeLists[sizeClass];
+    freeLists[sizeClass] = slot;
+    stats.usedBytes -= kMinSlot << sizeClass;
+}
+
+} // namespace chat
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace chat {
+
+/**
+ * @brief 分块分配器统计
+ */
+struct SlabStats {
+    size_t chunks = 0;                ///< 向系统申请的块数
+    size_t reservedBytes = 0;         ///< 块的总字节数
+    size_t usedBytes = 0;             ///< 正在使用的槽位字节数（按规格取整）
+    size_t largeBytes = 0;            ///< 超过最大规格、直接向系统申请的字节数
+    uint64_t allocations = 0;         ///< 分配次数
+    uint64_t systemAllocations = 0;   ///< 向系统申请内存的次数（新块和大对象）
+};
+
+/**
+ * @brief 按规格分级的分块分配器
+ *
+ * 槽位大小为 16 到 4096 字节之间的 2 的幂。某个规格没有空闲槽位时向系统
+ * 申请一个 chunkBytes 大小的块并整块切成该规格的槽位，释放的槽位挂回对应
+ * 规格的空闲链表，块在分配器销毁前不归还系统。因此内存用量稳定后，分配和
+ * 释放只是链表操作，不再调用 malloc。超过 4096 字节的请求直接交给系统。
+ *
+ * 不是线程安全的，由所有者串行化访问（如 HistoryStore 在持有锁时使用）。
+ */
+class SlabPool {
+public:
+    /// 最小槽位
+    static constexpr size_t kMinSlot = 16;
+
+    /// 最大槽位，更大的请求直接向系统申请
+    static constexpr size_t kMaxSlot = 4096;
+
+    /**
+     * @brief 构造函数
+     * @param chunkBytes 每次向系统申请的块大小，不小于 kMaxSlot
+     */
+    explicit SlabPool(size_t chunkBytes = 64 << 10);
+
+    /**
+     * @brief 析构函数，释放所有块；调用方需先释放全部分配
+     */
+    ~SlabPool();
+
+    // 禁止拷贝和赋值
+    SlabPool(const SlabPool&) = delete;
+    SlabPool& operator=(const SlabPool&) = delete;
+
+    /**
+     * @brief 分配内存，对齐到 16 字节
+     * @param bytes 字节数
+     * @return 内存地址
+     * @throw std::bad_alloc 系统内存不足时抛出
+     */
+    void* allocate(size_t bytes);
+
+    /**
+     * @brief 释放内存
+     * @param pointer allocate 返回的地址
+     * @param bytes 分配时的字节数
+     */
+    void deallocate(void* pointer, size_t bytes) noexcept;
+
+    /**
+     * @brief 一次分配实际占用的字节数
+     * @param bytes 请求的字节数
+     * @return 槽位大小，超过 kMaxSlot 时为 bytes
+     */
+    static size_t slotSize(size_t bytes);
+
+    /**
+     * @brief 获取统计
+     */
+    SlabStats getStats() const { return stats; }
+
+private:
+    /// 规格数：16, 32, ..., 4096
+    static constexpr size_t kClasses = 9;
+
+    /**
+     * @brief 空闲槽位，链表指针存放在槽位内
+     */
+    struct FreeSlot {
+        FreeSlot* next;
+    };
+
+    /**
+     * @brief 请求大小对应的规格下标
+     */
+    static size_t classOf(size_t bytes);
+
+    /**
+     * @brief 申请一个新块并切成指定规格的槽位
+     */
+    void refill(size_t sizeClass);
+
+    size_t chunkBytes;                          ///< 块大小
+    std::array<FreeSlot*, kClasses> freeLists{};  ///< 各规格的空闲链表
+    std::vector<void*> chunks;                  ///< 已申请的块
+    SlabStats stats;                            ///< 统计
+};
+
+/**
+ * @brief 从 SlabPool 分配内存的标准分配器
+ *
+ * 有状态：两个分配器使用同一个 SlabPool 时才相等
+ */
+template <typename T>
+class SlabAllocator {
+public:
+    using value_type = T;
+
+    /**
+     * @brief 构造函数
+     * @param pool 分配器使用的 SlabPool，生命周期需长于所有分配
+     */
+    explicit SlabAllocator(SlabPool* pool) noexcept : pool(pool) {}
+
+    template <typename U>
+    SlabAllocator(const SlabAllocator<U>& other) noexcept : pool(other.pool) {}
+
+    T* allocate(size_t n) { return static_cast<T*>(pool->allocate(n * sizeof(T))); }
+
+    void deallocate(T* pointer, size_t n) noexcept { pool->deallocate(pointer, n * sizeof(T)); }
+
+    template <typename U>
+    bool operator==(const SlabAllocator<U>& other) const noexcept { return pool == other.pool; }
+
+    template <typename U>
+    bool operator!=(const SlabAllocator<U>& other) const noexcept { return pool != other.pool; }
+
+    SlabPool* pool;   ///< 所用的 SlabPool
+};
+
+/// 内容存放在 SlabPool 中的字符串
+using SlabString = std::basic_string<char, std::char_traits<char>, SlabAllocator<char>>;
+
+} // namespace chat
@@ -0,0 +1,133 @@
+#include "symbol_table.hpp"
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+
+namespace chat {
+
+/**
+ * @brief 析构函数，释放所有块
+ */
+SymbolTable::~SymbolTable() {
+    for (auto& block : blocks) {
+        delete[] block.load(std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief 由编号计算所在的块和块内下标
+ *
+ * 第 k 个块容纳编号 [kFirstBlock * (2^k - 1), kFirstBlock * (2^(k+1) - 1))，
+ * 编号加上 kFirstBlock 后最高位的位置即块号
+ *
+ * @param id 编号
+ * @param block 块号
+ * @param offset 块内下标
+ */
+void SymbolTable::locate(uint32_t id, size_t& block, size_t& offset) {
+    uint64_t biased = uint64_t{id} + kFirstBlock;
+    size_t bit = 63 - static_cast<size_t>(__builtin_clzll(biased));
+    block = bit - kFirstBlockBits;
+    offset = static_cast<size_t>(biased - (uint64_t{1} << bit));
+}
+
+/**
+ * @brief 获取字符串的编号，不存在时分配新编号
+ *
+ * 先在读锁下查找，未找到时取写锁再查找一次并分配。新条目先写入块，
+ * 再以 release 语义发布编号数，name 的读者看到编号时条目已经完整
+ *
+ * @param str 字符串
+ * @return 编号
+ */
+uint32_t SymbolTable::intern(std::string_view str) {
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto it = ids.find(str);
+        if (it != ids.end()) {
+            return it->second;
+        }
+    }
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    auto it = ids.find(str);
+    if (it != ids.end()) {
+        return it->second;
+    }
+    uint32_t id = count.load(std::memory_order_relaxed);
+    if (id == kInvalid) {
+        throw std::length_error("symbol table is full");
+    }
+
+    size_t block, offset;
+    locate(id, block, offset);
+    std::string_view* entries = blocks[block].load(std::memory_order_relaxed);
+    if (!entries) {
+        entries = new std::string_view[kFirstBlock << block];
+        blocks[block].store(entries, std::memory_order_release);
+    }
+
+    std::unique_ptr<char[]> copy(new char[str.size() + 1]);
+    std::memcpy(copy.get(), str.data(), str.size());
+    copy[str.size()] = '\0';
+    std::string_view stored(copy.get(), str.size());
+    storage.push_back(std::move(copy));
+    storageBytes += str.size() + 1;
+
+    entries[offset] = stored;
+    ids.emplace(stored, id);
+    count.store(id + 1, std::memory_order_release);
+    return id;
+}
+
+/**
+ * @brief 查找已驻留字符串的编号
+ *
+ * @param str 字符串
+ * @return 编号，未驻留时为 kInvalid
+ */
+uint32_t SymbolTable::find(std::string_view str) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    auto it = ids.find(str);
+    return it != ids.end() ? it->second : kInvalid;
+}
+
+/**
+ * @brief 获取编号对应的字符串
+ *
+ * @param id 编号
+ * @return 字符串，编号未分配时为空
+ */
+std::string_view SymbolTable::name(uint32_t id) const {
+    if (id >= count.load(std::memory_order_acquire)) {
+        return {};
+    }
+    size_t block, offset;
+    locate(id, block, offset);
+    return blocks[block].load(std::memory_order_acquire)[offset];
+}
+
+/**
+ * @brief 已驻留的字符串数
+ */
+size_t SymbolTable::size() const {
+    return count.load(std::memory_order_acquire);
+}
+
+/**
+ * @brief 驻留的字符串及索引占用的字节数
+ *
+ * 包括字符串内容、已分配的块和哈希表的条目，不含分配器的额外开销
+ */
+size_t SymbolTable::memoryBytes() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    size_t bytes = storageBytes + ids.size() * (sizeof(std::string_view) + sizeof(uint32_t) + sizeof(void*));
+    for (const auto& block : blocks) {
+        if (block.load(std::memory_order_relaxed)) {
+            size_t index = static_cast<size_t>(&block - blocks.data());
+            bytes += (kFirstBlock << index) * sizeof(std::string_view);
+        }
+    }
+    return bytes;
+}
+
+} // namespace chat
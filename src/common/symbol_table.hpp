@@ -0,0 +1,100 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace chat {
+
+/**
+ * @brief 字符串驻留表：为每个不同的字符串分配一个稳定的 32 位编号
+ *
+ * 用于用户名等取值很少、重复出现次数很多的字符串：消息只保存编号，
+ * 比较两个名字是否相同只需比较编号。
+ *
+ * 编号从 0 起连续分配，分配后在表的生命周期内不变，字符串也不会被释放或移动。
+ * 编号到字符串的查询（name）不加锁：名字存放在按 2 的幂逐级增大的块中，
+ * 已分配的块和其中的条目都不会再改动，读线程只需读取已发布的块指针。
+ * 字符串到编号的查询（find、intern）使用读写锁，已驻留的名字只取读锁。
+ *
+ * 所有成员函数都是线程安全的。
+ */
+class SymbolTable {
+public:
+    /// 表示不存在的编号
+    static constexpr uint32_t kInvalid = UINT32_MAX;
+
+    SymbolTable() = default;
+
+    /**
+     * @brief 析构函数，释放所有块
+     */
+    ~SymbolTable();
+
+    // 禁止拷贝和赋值
+    SymbolTable(const SymbolTable&) = delete;
+    SymbolTable& operator=(const SymbolTable&) = delete;
+
+    /**
+     * @brief 获取字符串的编号，不存在时分配新编号
+     * @param str 字符串
+     * @return 编号
+     * @throw std::length_error 编号耗尽时抛出
+     */
+    uint32_t intern(std::string_view str);
+
+    /**
+     * @brief 查找已驻留字符串的编号
+     * @param str 字符串
+     * @return 编号，未驻留时为 kInvalid
+     */
+    uint32_t find(std::string_view str) const;
+
+    /**
+     * @brief 获取编号对应的字符串（不加锁）
+     *
+     * 编号必须是本表 intern 返回的值；返回的 string_view 在表的生命周期内有效
+     *
+     * @param id 编号
+     * @return 字符串
+     */
+    std::string_view name(uint32_t id) const;
+
+    /**
+     * @brief 已驻留的字符串数
+     */
+    size_t size() const;
+
+    /**
+     * @brief 驻留的字符串及索引占用的字节数（估算）
+     */
+    size_t memoryBytes() const;
+
+private:
+    /// 第一个块的条目数，第 k 个块的条目数为 kFirstBlock << k
+    static constexpr uint32_t kFirstBlockBits = 6;
+    static constexpr uint64_t kFirstBlock = uint64_t{1} << kFirstBlockBits;
+
+    /// 块数，足以容纳全部 32 位编号
+    static constexpr size_t kBlocks = 32 - kFirstBlockBits + 1;
+
+    /**
+     * @brief 由编号计算所在的块和块内下标
+     */
+    static void locate(uint32_t id, size_t& block, size_t& offset);
+
+    std::array<std::atomic<std::string_view*>, kBlocks> blocks{};   ///< 名字块，分配后不再改动
+    std::atomic<uint32_t> count{0};                                 ///< 已分配的编号数
+
+    mutable std::shared_mutex mutex;                                ///< 保护以下数据
+    std::unordered_map<std::string_view, uint32_t> ids;             ///< 字符串到编号
+    std::vector<std::unique_ptr<char[]>> storage;                   ///< 字符串内容
+    size_t storageBytes = 0;                                        ///< 字符串内容的字节数
+};
+
+} // namespace chat
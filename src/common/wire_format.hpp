@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace chat {
+
+/// 二进制帧格式的 WebSocket 子协议名
+constexpr const char* kBinarySubprotocol = "chatcpp.binary.v2";
+
+/// 二进制帧格式版本号，位于每一帧的首字节
+constexpr uint8_t kBinaryFormatVersion = 2;
+
+/**
+ * @brief 连接上协商出的消息编码格式
+ */
+enum class WireFormat {
+    Text,    ///< username @ content | timestamp 文本格式（未协商子协议时的回退）
+    Binary   ///< 变长整数长度前缀的二进制格式
+};
+
+/**
+ * @brief 追加一个 LEB128 无符号变长整数
+ * @param out 输出缓冲区
+ * @param value 要写入的数值
+ */
+inline void appendVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+/**
+ * @brief 读取一个 LEB128 无符号变长整数
+ * @param in 输入数据，成功时前移到变长整数之后
+ * @param value 输出的数值
+ * @return 数据完整且不超过 64 位时返回true
+ */
+inline bool readVarint(std::string_view& in, uint64_t& value) {
+    uint64_t result = 0;
+    for (size_t i = 0; i < in.size() && i < 10; ++i) {
+        uint8_t byte = static_cast<uint8_t>(in[i]);
+        result |= static_cast<uint64_t>(byte & 0x7F) << (7 * i);
+        if ((byte & 0x80) == 0) {
+            value = result;
+            in.remove_prefix(i + 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief 有符号整数的 ZigZag 编码，使小的负数也只占少量字节
+ */
+inline uint64_t zigzagEncode(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+/**
+ * @brief ZigZag 解码
+ */
+inline int64_t zigzagDecode(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+/**
+ * @brief 追加一个小端序 32 位整数
+ */
+inline void appendFixed32(std::string& out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out.push_back(static_cast<char>(value >> (8 * i)));
+    }
+}
+
+/**
+ * @brief 追加一个小端序 64 位整数
+ */
+inline void appendFixed64(std::string& out, uint64_t value) {
+    for (int i = 0; i < 8; ++i) {
+        out.push_back(static_cast<char>(value >> (8 * i)));
+    }
+}
+
+/**
+ * @brief 读取一个小端序 32 位整数
+ * @param data 至少 4 字节的数据
+ */
+inline uint32_t loadFixed32(const char* data) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i) {
+        value |= static_cast<uint32_t>(static_cast<uint8_t>(data[i])) << (8 * i);
+    }
+    return value;
+}
+
+/**
+ * @brief 读取一个小端序 64 位整数
+ * @param data 至少 8 字节的数据
+ */
+inline uint64_t loadFixed64(const char* data) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; ++i) {
+        value |= static_cast<uint64_t>(static_cast<uint8_t>(data[i])) << (8 * i);
+    }
+    return value;
+}
+
+} // namespace chat
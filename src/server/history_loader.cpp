@@ -0,0 +1,181 @@
+#include "history_loader.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iterator>
+#include <string_view>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace chat {
+
+namespace {
+
+/// 每个分块的最小字节数，避免小文件切得过碎
+constexpr size_t kMinChunkSize = 1 << 20;
+
+/// 每个线程分到的块数，块多于线程数可以平衡各块解析速度的差异
+constexpr size_t kChunksPerThread = 4;
+
+/**
+ * @brief 单个分块的解析结果
+ */
+struct ChunkResult {
+    std::vector<Message> messages;   ///< 解析成功的消息
+    uint64_t lines = 0;              ///< 块内的总行数（含空行）
+    uint64_t nonEmptyLines = 0;      ///< 块内的非空行数
+    uint64_t badRecords = 0;         ///< 解析失败的行数
+    uint64_t firstBadLine = 0;       ///< 块内第一个失败行的行号（从 1 开始）
+};
+
+/**
+ * @brief 解析一个以行边界对齐的分块
+ */
+void parseChunk(std::string_view chunk, ChunkResult& result) {
+    Message message("", "");
+    while (!chunk.empty()) {
+        size_t end = chunk.find('\n');
+        std::string_view line = chunk.substr(0, end);
+        chunk.remove_prefix(end == std::string_view::npos ? chunk.size() : end + 1);
+        ++result.lines;
+
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        if (line.empty()) {
+            continue;
+        }
+        ++result.nonEmptyLines;
+        if (parseHistoryLine(line, message) != ParseError::None) {
+            if (result.badRecords++ == 0) {
+                result.firstBadLine = result.lines;
+            }
+            continue;
+        }
+        result.messages.push_back(message);
+    }
+}
+
+/**
+ * @brief 将文件切分为以换行结尾的分块
+ */
+std::vector<std::string_view> splitChunks(std::string_view data, size_t count) {
+    std::vector<std::string_view> chunks;
+    size_t target = std::max(kMinChunkSize, data.size() / count + 1);
+    while (!data.empty()) {
+        size_t end = data.size();
+        if (target < data.size()) {
+            size_t newline = data.find('\n', target - 1);
+            end = newline == std::string_view::npos ? data.size() : newline + 1;
+        }
+        chunks.push_back(data.substr(0, end));
+        data.remove_prefix(end);
+    }
+    return chunks;
+}
+
+} // namespace
+
+/**
+ * @brief 解析一行文本历史记录
+ *
+ * @param line 历史记录行
+ * @param message 用于接收解析结果的消息对象
+ * @return 解析错误码
+ */
+ParseError parseHistoryLine(std::string_view line, Message& message) {
+    std::string_view room = kDefaultRoom;
+    size_t tab = line.find('\t');
+    if (tab != std::string_view::npos && tab < line.find('@') && isValidRoomName(line.substr(0, tab))) {
+        room = line.substr(0, tab);
+        line.remove_prefix(tab + 1);
+    }
+    ParseError error = Message::parse(line, message);
+    if (error == ParseError::None) {
+        message.room.assign(room.data(), room.size());
+    }
+    return error;
+}
+
+/**
+ * @brief 并行加载文本格式的历史记录文件
+ *
+ * @param filename 历史记录文件名
+ * @param history 追加加载结果的数组
+ * @param threads 解析线程数，0 表示使用硬件并发数
+ * @return 加载统计
+ */
+HistoryLoadStats loadHistoryFile(const std::string& filename, std::vector<Message>& history, size_t threads) {
+    HistoryLoadStats stats;
+    auto start = std::chrono::steady_clock::now();
+
+    int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return stats;
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        return stats;
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    void* mapped = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        return stats;
+    }
+    ::madvise(mapped, size, MADV_SEQUENTIAL);
+    stats.bytes = size;
+
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    std::vector<std::string_view> chunks =
+        splitChunks(std::string_view(static_cast<const char*>(mapped), size), threads * kChunksPerThread);
+    std::vector<ChunkResult> results(chunks.size());
+    threads = std::min(threads, chunks.size());
+
+    // 各线程从共享计数器领取下一个分块
+    std::atomic<size_t> nextChunk{0};
+    auto worker = [&]() {
+        for (size_t i; (i = nextChunk.fetch_add(1)) < chunks.size();) {
+            parseChunk(chunks[i], results[i]);
+        }
+    };
+    std::vector<std::thread> pool;
+    for (size_t i = 1; i < threads; ++i) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : pool) {
+        thread.join();
+    }
+    ::munmap(mapped, size);
+
+    // 按块顺序合并
+    size_t total = 0;
+    for (const ChunkResult& result : results) {
+        total += result.messages.size();
+    }
+    history.reserve(history.size() + total);
+    uint64_t lineBase = 0;
+    for (ChunkResult& result : results) {
+        std::move(result.messages.begin(), result.messages.end(), std::back_inserter(history));
+        stats.lines += result.nonEmptyLines;
+        if (result.badRecords > 0 && stats.badRecords == 0) {
+            stats.firstBadLine = lineBase + result.firstBadLine;
+        }
+        stats.badRecords += result.badRecords;
+        lineBase += result.lines;
+    }
+
+    stats.chunks = chunks.size();
+    stats.threads = threads;
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
+
+} // namespace chat
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "../common/message.hpp"
+
+namespace chat {
+
+/**
+ * @brief 解析一行文本历史记录
+ *
+ * 行格式为 "room<TAB>username @ content | timestamp"，没有房间前缀的旧记录归入 kDefaultRoom
+ *
+ * @param line 历史记录行（不含换行符）
+ * @param message 用于接收解析结果的消息对象
+ * @return 解析错误码
+ */
+ParseError parseHistoryLine(std::string_view line, Message& message);
+
+/**
+ * @brief 文本历史记录加载统计
+ */
+struct HistoryLoadStats {
+    uint64_t bytes = 0;          ///< 文件大小
+    uint64_t lines = 0;          ///< 非空行数
+    uint64_t badRecords = 0;     ///< 解析失败的行数
+    uint64_t firstBadLine = 0;   ///< 第一个解析失败的行号（从 1 开始，0 表示没有）
+    size_t chunks = 0;           ///< 并行解析的分块数
+    size_t threads = 0;          ///< 使用的解析线程数
+    double seconds = 0;          ///< 加载耗时（秒）
+
+    /**
+     * @brief 每秒解析的行数
+     */
+    double linesPerSecond() const { return seconds > 0 ? static_cast<double>(lines) / seconds : 0; }
+};
+
+/**
+ * @brief 并行加载文本格式的历史记录文件
+ *
+ * 将文件以只读方式 mmap 后按行边界切分为若干块，多个线程各自解析一块到
+ * 独立的结果数组，最后按块顺序合并，结果与逐行顺序读取一致。空行被跳过，
+ * 无法解析的行计入 badRecords。
+ *
+ * @param filename 历史记录文件名
+ * @param history 追加加载结果的数组
+ * @param threads 解析线程数，0 表示使用硬件并发数
+ * @return 加载统计；文件不存在时各项为 0
+ */
+HistoryLoadStats loadHistoryFile(const std::string& filename, std::vector<Message>& history, size_t threads = 0);
+
+} // namespace chat
@@ -0,0 +1,888 @@
+#include "history_log.hpp"
+#include "../common/crc32c.hpp"
+#include "../common/logger.hpp"
+#include "../common/wire_format.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace chat {
+
+namespace {
+
+/// 记录头：length(u32) + crc32c(u32)
+constexpr size_t kRecordHeaderSize = 8;
+
+/// 索引项：sequence(u64) + timestamp_ms(i64) + offset(u64)
+constexpr size_t kIndexEntrySize = 24;
+
+/// 单条记录负载的上限，超过时视为损坏
+constexpr uint32_t kMaxRecordSize = 16 << 20;
+
+/// 顺序扫描时每次 pread 的字节数
+constexpr size_t kReadChunkSize = 64 << 10;
+
+/**
+ * @brief 将时间戳换算为毫秒，超出 ±kMaxHistoryTimestamp 的按边界处理
+ */
+int64_t toMillis(time_t timestamp) {
+    return static_cast<int64_t>(std::clamp(timestamp, -kMaxHistoryTimestamp, kMaxHistoryTimestamp)) * 1000;
+}
+
+/**
+ * @brief 在指定位置写入小端序 32 位整数
+ */
+void storeFixed32(char* out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out[i] = static_cast<char>(value >> (8 * i));
+    }
+}
+
+/**
+ * @brief 将整个缓冲区写入文件，处理短写和 EINTR
+ * @return 全部写入时返回true
+ */
+bool writeAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = ::write(fd, data, size);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+/**
+ * @brief 从指定偏移读取数据，处理短读和 EINTR
+ * @return 实际读取的字节数，出错时返回 0
+ */
+size_t readAt(int fd, char* data, size_t size, uint64_t offset) {
+    size_t total = 0;
+    while (total < size) {
+        ssize_t n = ::pread(fd, data + total, size - total, static_cast<off_t>(offset + total));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return 0;
+        }
+        if (n == 0) {
+            break;
+        }
+        total += static_cast<size_t>(n);
+    }
+    return total;
+}
+
+/**
+ * @brief 获取文件大小
+ */
+uint64_t fileSize(int fd) {
+    struct stat st;
+    return ::fstat(fd, &st) == 0 ? static_cast<uint64_t>(st.st_size) : 0;
+}
+
+} // namespace
+
+/**
+ * @brief 段文件描述符，最后一个引用释放时关闭
+ *
+ * 读取方持有引用后，即使段被保留策略删除也能安全读完
+ */
+struct HistoryLog::FileHandle {
+    explicit FileHandle(int fd) : fd(fd) {}
+    ~FileHandle() {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+    FileHandle(const FileHandle&) = delete;
+    FileHandle& operator=(const FileHandle&) = delete;
+
+    int fd;
+};
+
+namespace {
+
+/**
+ * @brief 段文件的顺序记录读取器
+ *
+ * 以 kReadChunkSize 为单位 pread，跨块的记录会重新从记录起点读取
+ */
+class RecordReader {
+public:
+    enum class Status { Ok, End, Corrupt };
+
+    RecordReader(int fd, uint64_t offset, uint64_t limit) : fd(fd), position(offset), limit(limit) {}
+
+    /**
+     * @brief 读取下一条记录
+     * @param sequence 记录序号
+     * @param payload 记录中的消息编码（在下一次调用前有效）
+     * @return 读取状态；Corrupt 时 position() 指向损坏记录的起点
+     */
+    Status next(uint64_t& sequence, std::string_view& payload) {
+        if (position >= limit) {
+            return Status::End;
+        }
+        if (!ensure(kRecordHeaderSize)) {
+            return Status::Corrupt;
+        }
+        const char* header = buffer.data() + (position - bufferOffset);
+        uint32_t length = loadFixed32(header);
+        uint32_t checksum = loadFixed32(header + 4);
+        if (length == 0 || length > kMaxRecordSize || !ensure(kRecordHeaderSize + length)) {
+            return Status::Corrupt;
+        }
+        std::string_view record(buffer.data() + (position - bufferOffset) + kRecordHeaderSize, length);
+        if (crc32c(record.data(), record.size()) != checksum || !readVarint(record, sequence)) {
+            return Status::Corrupt;
+        }
+        payload = record;
+        position += kRecordHeaderSize + length;
+        return Status::Ok;
+    }
+
+    /**
+     * @brief 下一条记录的偏移
+     */
+    uint64_t offset() const { return position; }
+
+private:
+    /**
+     * @brief 确保缓冲区中包含从当前位置起的 size 字节
+     */
+    bool ensure(size_t size) {
+        if (position + size > limit) {
+            return false;
+        }
+        if (position >= bufferOffset && position + size <= bufferOffset + buffer.size()) {
+            return true;
+        }
+        size_t want = std::max<size_t>(size, static_cast<size_t>(std::min<uint64_t>(kReadChunkSize, limit - position)));
+        buffer.resize(want);
+        size_t got = readAt(fd, buffer.data(), want, position);
+        buffer.resize(got);
+        bufferOffset = position;
+        return got >= size;
+    }
+
+    int fd;
+    uint64_t position;
+    uint64_t limit;
+    std::string buffer;
+    uint64_t bufferOffset = 0;
+};
+
+} // namespace
+
+/**
+ * @brief 构造函数
+ *
+ * 列出目录中的段并加载各自的稀疏索引；只扫描最后一段中最后一个索引项之后的数据
+ *
+ * @param directory 日志目录
+ * @param options 日志配置
+ */
+HistoryLog::HistoryLog(const std::string& directory, const HistoryLogOptions& options)
+    : directory(directory), options(options) {
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+    if (ec) {
+        throw std::runtime_error("Cannot create history directory " + directory + ": " + ec.message());
+    }
+
+    std::vector<uint64_t> bases;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, ec)) {
+        const std::filesystem::path& path = entry.path();
+        if (path.extension() != ".log") {
+            continue;
+        }
+        std::string stem = path.stem().string();
+        if (stem.empty() || stem.find_first_not_of("0123456789") != std::string::npos) {
+            continue;
+        }
+        bases.push_back(std::stoull(stem));
+    }
+    std::sort(bases.begin(), bases.end());
+
+    for (size_t i = 0; i < bases.size(); ++i) {
+        bool active = i + 1 == bases.size();
+        Segment segment;
+        segment.baseSequence = bases[i];
+        int appendFlag = active ? O_APPEND : 0;
+        int logFd = ::open(segmentPath(bases[i], ".log").c_str(), (active ? O_RDWR : O_RDONLY) | appendFlag | O_CLOEXEC);
+        int idxFd = ::open(segmentPath(bases[i], ".idx").c_str(), O_RDWR | O_CREAT | appendFlag | O_CLOEXEC, 0644);
+        if (logFd < 0 || idxFd < 0) {
+            int error = errno;
+            if (logFd >= 0) ::close(logFd);
+            if (idxFd >= 0) ::close(idxFd);
+            throw std::runtime_error("Cannot open history segment " + segmentPath(bases[i], ".log") + ": " +
+                                     std::strerror(error));
+        }
+        segment.log = std::make_shared<FileHandle>(logFd);
+        segment.idx = std::make_shared<FileHandle>(idxFd);
+        segment.size = fileSize(logFd);
+        loadIndex(segment);
+        if (active) {
+            recoverTail(segment);
+        } else {
+            segment.endSequence = bases[i + 1];
+        }
+        segments.push_back(std::move(segment));
+    }
+
+    if (segments.empty()) {
+        openSegment(0);
+        return;
+    }
+    const Segment& last = segments.back();
+    next = last.endSequence;
+    activeFirstTimestampMs = last.index.empty() ? 0 : last.index.front().timestampMs;
+}
+
+/**
+ * @brief 析构函数
+ */
+HistoryLog::~HistoryLog() {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    flushLocked();
+}
+
+/**
+ * @brief 段文件路径
+ */
+std::string HistoryLog::segmentPath(uint64_t baseSequence, const char* extension) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%020" PRIu64 "%s", baseSequence, extension);
+    return (std::filesystem::path(directory) / name).string();
+}
+
+/**
+ * @brief 读取段的索引文件
+ *
+ * 丢弃不完整的尾部索引项以及指向段文件之外的索引项
+ */
+void HistoryLog::loadIndex(Segment& segment) {
+    uint64_t size = fileSize(segment.idx->fd);
+    std::string data(size - size % kIndexEntrySize, '\0');
+    data.resize(readAt(segment.idx->fd, data.data(), data.size(), 0));
+
+    for (size_t pos = 0; pos + kIndexEntrySize <= data.size(); pos += kIndexEntrySize) {
+        IndexEntry entry;
+        entry.sequence = loadFixed64(data.data() + pos);
+        entry.timestampMs = static_cast<int64_t>(loadFixed64(data.data() + pos + 8));
+        entry.offset = loadFixed64(data.data() + pos + 16);
+        if (entry.offset >= segment.size ||
+            (!segment.index.empty() && entry.offset <= segment.index.back().offset)) {
+            break;
+        }
+        segment.index.push_back(entry);
+    }
+    if (segment.index.size() * kIndexEntrySize != size) {
+        if (::ftruncate(segment.idx->fd, static_cast<off_t>(segment.index.size() * kIndexEntrySize)) != 0) {
+            CHAT_LOG_ERROR("Error recovering history index: " + std::string(std::strerror(errno)));
+        }
+    }
+}
+
+/**
+ * @brief 校验写入段的尾部
+ *
+ * 从最后一个索引项开始顺序校验记录，遇到长度或校验和不符的记录时截断段文件；
+ * 扫描过程中按写入规则补齐缺失的索引项
+ */
+void HistoryLog::recoverTail(Segment& segment) {
+    uint64_t start = segment.index.empty() ? 0 : segment.index.back().offset;
+    uint64_t lastIndexed = start;
+    bool haveIndex = !segment.index.empty();
+    RecordReader reader(segment.log->fd, start, segment.size);
+    std::vector<IndexEntry> rebuilt;
+    uint64_t sequence = 0;
+    uint64_t end = segment.baseSequence;
+    std::string_view payload;
+    Message message("", "");
+
+    for (;;) {
+        uint64_t offset = reader.offset();
+        RecordReader::Status status = reader.next(sequence, payload);
+        if (status == RecordReader::Status::Ok && Message::parseBinary(payload, message) != ParseError::None) {
+            status = RecordReader::Status::Corrupt;
+        }
+        if (status == RecordReader::Status::End) {
+            break;
+        }
+        if (status == RecordReader::Status::Corrupt) {
+            recoveredTruncation += segment.size - offset;
+            segment.size = offset;
+            CHAT_LOG_WARN("History log: truncated corrupt tail of " +
+                          segmentPath(segment.baseSequence, ".log") + " at offset " +
+                          std::to_string(offset));
+            if (::ftruncate(segment.log->fd, static_cast<off_t>(offset)) != 0) {
+                CHAT_LOG_ERROR("Error recovering history: " + std::string(std::strerror(errno)));
+            }
+            if (offset == start && haveIndex && rebuilt.empty()) {
+                // 最后一个索引项指向的记录本身已损坏：丢弃该索引项，从前一个索引项重新校验
+                segment.index.pop_back();
+                if (::ftruncate(segment.idx->fd, static_cast<off_t>(segment.index.size() * kIndexEntrySize)) != 0) {
+                    CHAT_LOG_ERROR("Error recovering history index: " + std::string(std::strerror(errno)));
+                }
+                recoverTail(segment);
+                return;
+            }
+            break;
+        }
+        if (!haveIndex || offset - lastIndexed >= options.indexIntervalBytes) {
+            rebuilt.push_back({sequence, toMillis(message.timestamp), offset});
+            lastIndexed = offset;
+            haveIndex = true;
+        }
+        end = sequence + 1;
+    }
+    bytesSinceIndex = segment.size - lastIndexed;
+
+    if (!rebuilt.empty()) {
+        std::string data;
+        for (const IndexEntry& entry : rebuilt) {
+            appendFixed64(data, entry.sequence);
+            appendFixed64(data, static_cast<uint64_t>(entry.timestampMs));
+            appendFixed64(data, entry.offset);
+        }
+        if (!writeAll(segment.idx->fd, data.data(), data.size())) {
+            CHAT_LOG_ERROR("Error recovering history index: " + std::string(std::strerror(errno)));
+        }
+        segment.index.insert(segment.index.end(), rebuilt.begin(), rebuilt.end());
+    }
+    segment.endSequence = end;
+}
+
+/**
+ * @brief 创建新的写入段（调用方需持有写锁或处于构造阶段）
+ */
+void HistoryLog::openSegment(uint64_t baseSequence) {
+    int logFd = ::open(segmentPath(baseSequence, ".log").c_str(),
+                       O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    int idxFd = ::open(segmentPath(baseSequence, ".idx").c_str(),
+                       O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (logFd < 0 || idxFd < 0) {
+        int error = errno;
+        if (logFd >= 0) ::close(logFd);
+        if (idxFd >= 0) ::close(idxFd);
+        throw std::runtime_error("Cannot create history segment " + segmentPath(baseSequence, ".log") + ": " +
+                                 std::strerror(error));
+    }
+    Segment segment;
+    segment.baseSequence = baseSequence;
+    segment.endSequence = baseSequence;
+    segment.log = std::make_shared<FileHandle>(logFd);
+    segment.idx = std::make_shared<FileHandle>(idxFd);
+    segments.push_back(std::move(segment));
+    bytesSinceIndex = 0;
+}
+
+/**
+ * @brief 在需要时按大小或时间滚动当前段
+ *
+ * 滚动前先写出缓冲区，保证一个缓冲区中的记录总是属于同一个段
+ */
+void HistoryLog::maybeRoll(int64_t timestampMs) {
+    uint64_t activeSize;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        activeSize = segments.back().size;
+    }
+    activeSize += writeBuffer.size();
+    if (activeSize == 0) {
+        return;
+    }
+    bool full = activeSize >= options.segmentBytes;
+    bool old = timestampMs - activeFirstTimestampMs >=
+               std::chrono::duration_cast<std::chrono::milliseconds>(options.segmentMaxAge).count();
+    if (!full && !old) {
+        return;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    flushLocked();
+    if (segments.back().size == 0) {
+        return;
+    }
+    openSegment(next);
+    applyRetention();
+}
+
+/**
+ * @brief 按 retainBytes 删除最旧的段
+ */
+void HistoryLog::applyRetention() {
+    if (options.retainBytes == 0) {
+        return;
+    }
+    uint64_t total = 0;
+    for (const Segment& segment : segments) {
+        total += segment.size;
+    }
+    size_t remove = 0;
+    while (remove + 1 < segments.size() && total > options.retainBytes) {
+        total -= segments[remove].size;
+        ::unlink(segmentPath(segments[remove].baseSequence, ".log").c_str());
+        ::unlink(segmentPath(segments[remove].baseSequence, ".idx").c_str());
+        ++remove;
+    }
+    segments.erase(segments.begin(), segments.begin() + remove);
+}
+
+/**
+ * @brief 追加一条消息到写缓冲区
+ *
+ * 记录在缓冲区中就地编码：先预留记录头，编码负载后再回填长度和校验和
+ *
+ * @param message 要追加的消息
+ * @return 分配给该消息的序号
+ */
+uint64_t HistoryLog::append(const Message& message) {
+    int64_t timestampMs = toMillis(message.timestamp);
+    maybeRoll(timestampMs);
+
+    uint64_t sequence = next++;
+    uint64_t offset;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        offset = segments.back().size + writeBuffer.size();
+    }
+    if (offset == 0) {
+        activeFirstTimestampMs = timestampMs;
+    }
+    if (offset == 0 || bytesSinceIndex >= options.indexIntervalBytes) {
+        pendingIndex.push_back({sequence, timestampMs, offset});
+        bytesSinceIndex = 0;
+    }
+
+    size_t start = writeBuffer.size();
+    writeBuffer.append(kRecordHeaderSize, '\0');
+    appendVarint(writeBuffer, sequence);
+    message.appendBinary(writeBuffer);
+    size_t length = writeBuffer.size() - start - kRecordHeaderSize;
+    char* header = &writeBuffer[start];
+    storeFixed32(header, static_cast<uint32_t>(length));
+    storeFixed32(header + 4, crc32c(header + kRecordHeaderSize, length));
+
+    bytesSinceIndex += kRecordHeaderSize + length;
+    return sequence;
+}
+
+/**
+ * @brief 将写缓冲区写入段文件和索引文件
+ *
+ * @return 写入成功时返回true
+ */
+bool HistoryLog::flush() {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    return flushLocked();
+}
+
+/**
+ * @brief 将写缓冲区写出
+ *
+ * 先以一次 write 写入记录，再追加索引项；索引项只是定位提示，
+ * 写入失败时打开日志会从段文件重建
+ *
+ * @return 写入成功时返回true
+ */
+bool HistoryLog::flushLocked() {
+    if (writeBuffer.empty()) {
+        return true;
+    }
+    Segment& segment = segments.back();
+    bool ok = writeAll(segment.log->fd, writeBuffer.data(), writeBuffer.size());
+    if (ok) {
+        std::string index;
+        index.reserve(pendingIndex.size() * kIndexEntrySize);
+        for (const IndexEntry& entry : pendingIndex) {
+            appendFixed64(index, entry.sequence);
+            appendFixed64(index, static_cast<uint64_t>(entry.timestampMs));
+            appendFixed64(index, entry.offset);
+        }
+        if (!writeAll(segment.idx->fd, index.data(), index.size())) {
+            CHAT_LOG_ERROR("Error saving history index: " + std::string(std::strerror(errno)));
+        }
+        segment.size += writeBuffer.size();
+        segment.index.insert(segment.index.end(), pendingIndex.begin(), pendingIndex.end());
+        segment.endSequence = next;
+    } else {
+        // 回滚可能写入了一部分的记录，保持段文件只包含完整记录
+        CHAT_LOG_ERROR("Error saving history: write failed: " + std::string(std::strerror(errno)));
+        if (::ftruncate(segment.log->fd, static_cast<off_t>(segment.size)) != 0) {
+            CHAT_LOG_ERROR("Error saving history: truncate failed: " + std::string(std::strerror(errno)));
+        }
+        // 丢失记录的序号不再复用，下一条记录强制建立索引项
+        bytesSinceIndex = options.indexIntervalBytes;
+    }
+    writeBuffer.clear();
+    pendingIndex.clear();
+    return ok;
+}
+
+/**
+ * @brief 写出缓冲区并 fsync 当前段
+ *
+ * @return 成功时返回true
+ */
+bool HistoryLog::sync() {
+    std::shared_ptr<FileHandle> log;
+    std::shared_ptr<FileHandle> idx;
+    bool ok;
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        ok = flushLocked();
+        log = segments.back().log;
+        idx = segments.back().idx;
+    }
+    // fsync 在锁外执行，不阻塞读取
+    if (::fsync(log->fd) != 0 || ::fsync(idx->fd) != 0) {
+        CHAT_LOG_ERROR("Error saving history: fsync failed: " + std::string(std::strerror(errno)));
+        ok = false;
+    }
+    return ok;
+}
+
+/**
+ * @brief 扫描一个段中从 offset 开始的记录
+ *
+ * 校验和不符的记录无法确定下一条记录的边界，跳到下一个索引项继续扫描
+ *
+ * @return 回调要求停止时返回false
+ */
+bool HistoryLog::scanSegment(uint64_t baseSequence, const FileHandle& file, uint64_t offset, uint64_t limit,
+                             uint64_t fromSequence, const Visitor& visitor, size_t& count) const {
+    uint64_t sequence;
+    std::string_view payload;
+    Message message("", "");
+    while (offset < limit) {
+        RecordReader reader(file.fd, offset, limit);
+        RecordReader::Status status;
+        while ((status = reader.next(sequence, payload)) == RecordReader::Status::Ok) {
+            if (sequence < fromSequence || Message::parseBinary(payload, message) != ParseError::None) {
+                continue;
+            }
+            ++count;
+            if (!visitor(sequence, message)) {
+                return false;
+            }
+        }
+        if (status == RecordReader::Status::End) {
+            break;
+        }
+        uint64_t resume = nextIndexedOffset(baseSequence, reader.offset(), limit);
+        skippedRegions.fetch_add(1, std::memory_order_relaxed);
+        CHAT_LOG_WARN("History log: skipped corrupt data in " + segmentPath(baseSequence, ".log") +
+                      " at offset " + std::to_string(reader.offset()) + " (" +
+                      std::to_string(resume - reader.offset()) + " bytes)");
+        offset = resume;
+    }
+    return true;
+}
+
+/**
+ * @brief 查找段中偏移大于 offset 的第一个索引项
+ *
+ * @param baseSequence 段的首条记录序号
+ * @param offset 损坏数据的起点
+ * @param limit 扫描上限
+ * @return 索引项偏移，没有时返回 limit
+ */
+uint64_t HistoryLog::nextIndexedOffset(uint64_t baseSequence, uint64_t offset, uint64_t limit) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    auto segment = std::lower_bound(segments.begin(), segments.end(), baseSequence,
+                                    [](const Segment& s, uint64_t base) { return s.baseSequence < base; });
+    if (segment == segments.end() || segment->baseSequence != baseSequence) {
+        return limit;
+    }
+    auto entry = std::partition_point(segment->index.begin(), segment->index.end(),
+                                      [offset](const IndexEntry& e) { return e.offset <= offset; });
+    return entry != segment->index.end() ? std::min(entry->offset, limit) : limit;
+}
+
+/**
+ * @brief 从指定序号开始顺序读取记录
+ *
+ * 在锁内二分查找起始段和段内索引项，复制所需段的文件引用和已写出大小后
+ * 在锁外读取，读取过程不阻塞写入
+ *
+ * @param fromSequence 起始序号
+ * @param visitor 读取回调
+ * @return 读取的记录数
+ */
+size_t HistoryLog::read(uint64_t fromSequence, const Visitor& visitor) const {
+    struct Range {
+        uint64_t baseSequence;
+        std::shared_ptr<FileHandle> log;
+        uint64_t offset;
+        uint64_t limit;
+    };
+    std::vector<Range> ranges;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto it = std::upper_bound(segments.begin(), segments.end(), fromSequence,
+                                   [](uint64_t sequence, const Segment& segment) {
+                                       return sequence < segment.baseSequence;
+                                   });
+        if (it != segments.begin()) {
+            --it;
+        }
+        for (bool first = true; it != segments.end(); ++it, first = false) {
+            uint64_t offset = 0;
+            if (first) {
+                auto entry = std::upper_bound(it->index.begin(), it->index.end(), fromSequence,
+                                              [](uint64_t sequence, const IndexEntry& e) {
+                                                  return sequence < e.sequence;
+                                              });
+                if (entry != it->index.begin()) {
+                    offset = std::prev(entry)->offset;
+                }
+            }
+            ranges.push_back({it->baseSequence, it->log, offset, it->size});
+        }
+    }
+
+    size_t count = 0;
+    for (const Range& range : ranges) {
+        if (!scanSegment(range.baseSequence, *range.log, range.offset, range.limit, fromSequence, visitor, count)) {
+            break;
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief 按序号批量读取记录
+ *
+ * 序号排序去重后，在一次加锁内逐个二分查找所在的段和稀疏索引项，落在同一
+ * 索引区间（相邻两个索引项之间）的序号归为一组，并复制该区间的文件引用和
+ * 边界；锁外每组只 pread 该区间一次，只解码需要的记录。区间内遇到校验失败的
+ * 记录时放弃该组剩余的序号
+ *
+ * @param sequences 要读取的序号
+ * @param visitor 读取回调
+ * @return 读取的记录数
+ */
+size_t HistoryLog::readSequences(const std::vector<uint64_t>& sequences, const Visitor& visitor) const {
+    struct Interval {
+        uint64_t baseSequence;
+        std::shared_ptr<FileHandle> log;
+        uint64_t offset;
+        uint64_t limit;
+        size_t first;   ///< 该组在 wanted 中的起始下标
+        size_t last;    ///< 该组在 wanted 中的结束下标（不含）
+    };
+    std::vector<uint64_t> wanted(sequences);
+    std::sort(wanted.begin(), wanted.end());
+    wanted.erase(std::unique(wanted.begin(), wanted.end()), wanted.end());
+
+    std::vector<Interval> intervals;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        size_t i = 0;
+        while (i < wanted.size()) {
+            auto segment = std::upper_bound(segments.begin(), segments.end(), wanted[i],
+                                            [](uint64_t sequence, const Segment& s) {
+                                                return sequence < s.baseSequence;
+                                            });
+            if (segment == segments.begin() || wanted[i] >= std::prev(segment)->endSequence) {
+                ++i;
+                continue;
+            }
+            --segment;
+            auto entry = std::upper_bound(segment->index.begin(), segment->index.end(), wanted[i],
+                                          [](uint64_t sequence, const IndexEntry& e) {
+                                              return sequence < e.sequence;
+                                          });
+            uint64_t offset = entry != segment->index.begin() ? std::prev(entry)->offset : 0;
+            uint64_t limit = entry != segment->index.end() ? entry->offset : segment->size;
+            uint64_t intervalEnd = entry != segment->index.end() ? entry->sequence : segment->endSequence;
+            size_t first = i;
+            while (i < wanted.size() && wanted[i] < intervalEnd) {
+                ++i;
+            }
+            intervals.push_back({segment->baseSequence, segment->log, offset, limit, first, i});
+        }
+    }
+
+    size_t count = 0;
+    uint64_t sequence;
+    std::string_view payload;
+    Message message("", "");
+    for (const Interval& interval : intervals) {
+        RecordReader reader(interval.log->fd, interval.offset, interval.limit);
+        RecordReader::Status status = RecordReader::Status::End;
+        size_t next = interval.first;
+        while (next < interval.last && (status = reader.next(sequence, payload)) == RecordReader::Status::Ok) {
+            while (next < interval.last && wanted[next] < sequence) {
+                ++next;
+            }
+            if (next == interval.last || wanted[next] != sequence) {
+                continue;
+            }
+            ++next;
+            if (Message::parseBinary(payload, message) != ParseError::None) {
+                continue;
+            }
+            ++count;
+            if (!visitor(sequence, message)) {
+                return count;
+            }
+        }
+        if (status == RecordReader::Status::Corrupt) {
+            skippedRegions.fetch_add(1, std::memory_order_relaxed);
+            CHAT_LOG_WARN("History log: skipped corrupt data in " + segmentPath(interval.baseSequence, ".log") +
+                          " at offset " + std::to_string(reader.offset()) + " (" +
+                          std::to_string(interval.limit - reader.offset()) + " bytes)");
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief 查找时间戳不早于指定时间的第一条记录
+ *
+ * 先按各段首条记录的时间二分查找段，再按段内索引项的时间定位扫描起点
+ *
+ * @param timestamp 时间
+ * @return 记录序号，不存在时为 nextSequence()
+ */
+uint64_t HistoryLog::findSequenceAt(time_t timestamp) const {
+    int64_t targetMs = toMillis(timestamp);
+    uint64_t fromSequence;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        // 最后一个首条记录早于目标时间的段
+        auto it = std::partition_point(segments.begin(), segments.end(), [targetMs](const Segment& segment) {
+            return !segment.index.empty() && segment.index.front().timestampMs < targetMs;
+        });
+        if (it != segments.begin()) {
+            --it;
+        }
+        auto entry = std::partition_point(it->index.begin(), it->index.end(), [targetMs](const IndexEntry& e) {
+            return e.timestampMs < targetMs;
+        });
+        fromSequence = entry != it->index.begin() ? std::prev(entry)->sequence : it->baseSequence;
+    }
+
+    uint64_t found = nextSequence();
+    read(fromSequence, [&found, targetMs](uint64_t sequence, const Message& message) {
+        if (toMillis(message.timestamp) >= targetMs) {
+            found = sequence;
+            return false;
+        }
+        return true;
+    });
+    return found;
+}
+
+/**
+ * @brief 读取时间范围内的记录
+ *
+ * @param from 起始时间（包含）
+ * @param to 结束时间（包含）
+ * @param visitor 读取回调
+ * @return 读取的记录数
+ */
+size_t HistoryLog::readTimeRange(time_t from, time_t to, const Visitor& visitor) const {
+    size_t count = 0;
+    read(findSequenceAt(from), [&](uint64_t sequence, const Message& message) {
+        if (message.timestamp > to) {
+            return false;
+        }
+        if (message.timestamp < from) {
+            return true;
+        }
+        ++count;
+        return visitor(sequence, message);
+    });
+    return count;
+}
+
+/**
+ * @brief 查找末尾约 bytes 字节数据的起始序号
+ *
+ * @param bytes 从末尾向前的字节数
+ * @return 起始序号
+ */
+uint64_t HistoryLog::sequenceForTailBytes(uint64_t bytes) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    for (auto it = segments.rbegin(); it != segments.rend(); ++it) {
+        if (it->size < bytes) {
+            bytes -= it->size;
+            continue;
+        }
+        uint64_t target = it->size - bytes;
+        auto entry = std::partition_point(it->index.begin(), it->index.end(), [target](const IndexEntry& e) {
+            return e.offset < target;
+        });
+        return entry != it->index.end() ? entry->sequence : it->endSequence;
+    }
+    return segments.front().baseSequence;
+}
+
+/**
+ * @brief 删除所有记录都早于指定时间的段
+ *
+ * 以下一段首条记录的时间作为本段最后一条记录时间的上界，不读取段内数据
+ *
+ * @param cutoff 截止时间
+ * @return 删除的段数
+ */
+size_t HistoryLog::removeSegmentsBefore(time_t cutoff) {
+    int64_t cutoffMs = toMillis(cutoff);
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    size_t remove = 0;
+    while (remove + 1 < segments.size()) {
+        const Segment& following = segments[remove + 1];
+        if (following.index.empty() || following.index.front().timestampMs >= cutoffMs) {
+            break;
+        }
+        ::unlink(segmentPath(segments[remove].baseSequence, ".log").c_str());
+        ::unlink(segmentPath(segments[remove].baseSequence, ".idx").c_str());
+        ++remove;
+    }
+    segments.erase(segments.begin(), segments.begin() + remove);
+    return remove;
+}
+
+/**
+ * @brief 获取最早的记录序号
+ */
+uint64_t HistoryLog::firstSequence() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return segments.front().baseSequence;
+}
+
+/**
+ * @brief 获取最后一条已写出记录之后的序号
+ */
+uint64_t HistoryLog::nextSequence() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return segments.back().endSequence;
+}
+
+/**
+ * @brief 获取段数
+ */
+size_t HistoryLog::segmentCount() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return segments.size();
+}
+
+} // namespace chat
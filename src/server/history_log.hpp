@@ -0,0 +1,245 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+#include "../common/message.hpp"
+
+namespace chat {
+
+/// 时间戳的合理范围（秒，约 ±3000 年），超出时时间定位按边界处理，换算为毫秒时不会溢出
+constexpr time_t kMaxHistoryTimestamp = 100000000000;
+
+/**
+ * @brief 分段历史日志配置
+ */
+struct HistoryLogOptions {
+    size_t segmentBytes = 64 << 20;                ///< 段文件达到该大小后滚动
+    std::chrono::seconds segmentMaxAge{3600};      ///< 段内首条与新消息的时间跨度超过该值后滚动
+    size_t indexIntervalBytes = 4096;              ///< 每写入这么多字节记录一个稀疏索引项
+    size_t retainBytes = 0;                        ///< 滚动时保留的总字节数上限，0 表示不限
+};
+
+/**
+ * @brief 分段、追加写入的二进制历史日志
+ *
+ * 目录下每个段由两个文件组成，文件名为段内首条记录的序号（20 位十进制）：
+ * - NNNN.log：记录数据，每条记录为
+ *   length(u32) | crc32c(u32) | payload，payload = varint 序号 + Message 二进制编码
+ * - NNNN.idx：稀疏索引，每项为 sequence(u64) | timestamp_ms(i64) | offset(u64)，
+ *   段内第一条记录以及此后每隔 indexIntervalBytes 字节记录一项
+ *
+ * 打开时只读取各段的索引文件，并从最后一段的最后一个索引项开始校验尾部，
+ * 截断崩溃留下的不完整记录；读取时遇到段中间校验失败的记录则跳到下一个
+ * 索引项继续，并记录日志；按序号或时间定位时先二分查找段，再二分查找
+ * 稀疏索引，最后顺序扫描不超过一个索引间隔的数据。
+ *
+ * 时间定位假设记录按追加顺序大致按时间递增（ChatServer 以服务器接收时间为消息打时间戳）。
+ *
+ * 同一时刻只允许一个线程写入（append/flush/sync）；读取可与写入并发，
+ * 只能读到已 flush 的记录。
+ */
+class HistoryLog {
+public:
+    /// 读取回调：返回false时停止读取
+    using Visitor = std::function<bool(uint64_t sequence, const Message& message)>;
+
+    /**
+     * @brief 打开（必要时创建）历史日志目录并恢复状态
+     * @param directory 日志目录
+     * @param options 日志配置
+     * @throw std::runtime_error 无法创建目录或打开段文件时抛出
+     */
+    explicit HistoryLog(const std::string& directory, const HistoryLogOptions& options = {});
+
+    /**
+     * @brief 析构函数，写出缓冲区中的数据
+     */
+    ~HistoryLog();
+
+    // 禁止拷贝和赋值
+    HistoryLog(const HistoryLog&) = delete;
+    HistoryLog& operator=(const HistoryLog&) = delete;
+
+    /**
+     * @brief 追加一条消息到写缓冲区
+     * @param message 要追加的消息
+     * @return 分配给该消息的序号
+     */
+    uint64_t append(const Message& message);
+
+    /**
+     * @brief 将写缓冲区写入段文件和索引文件
+     * @return 写入成功时返回true
+     */
+    bool flush();
+
+    /**
+     * @brief 写出缓冲区并 fsync 当前段
+     * @return 成功时返回true
+     */
+    bool sync();
+
+    /**
+     * @brief 从指定序号开始顺序读取记录
+     * @param fromSequence 起始序号（小于最早序号时从最早记录开始）
+     * @param visitor 读取回调
+     * @return 读取的记录数
+     */
+    size_t read(uint64_t fromSequence, const Visitor& visitor) const;
+
+    /**
+     * @brief 按序号批量读取记录
+     *
+     * 一次加锁定位所有序号所在的段和索引区间，同一区间内的序号合并为一次扫描；
+     * 不存在或已被删除的序号跳过
+     *
+     * @param sequences 要读取的序号，顺序不限
+     * @param visitor 读取回调，按序号从小到大调用
+     * @return 读取的记录数
+     */
+    size_t readSequences(const std::vector<uint64_t>& sequences, const Visitor& visitor) const;
+
+    /**
+     * @brief 读取时间范围内的记录
+     * @param from 起始时间（包含）
+     * @param to 结束时间（包含）
+     * @param visitor 读取回调
+     * @return 读取的记录数
+     */
+    size_t readTimeRange(time_t from, time_t to, const Visitor& visitor) const;
+
+    /**
+     * @brief 查找时间戳不早于指定时间的第一条记录
+     * @param timestamp 时间
+     * @return 记录序号，不存在时为 nextSequence()
+     */
+    uint64_t findSequenceAt(time_t timestamp) const;
+
+    /**
+     * @brief 查找末尾约 bytes 字节数据的起始序号
+     *
+     * 只查稀疏索引，结果对齐到索引项，用于只读取最近一部分记录
+     *
+     * @param bytes 从末尾向前的字节数
+     * @return 起始序号，数据不足时为 firstSequence()
+     */
+    uint64_t sequenceForTailBytes(uint64_t bytes) const;
+
+    /**
+     * @brief 删除所有记录都早于指定时间的段（不含当前写入段）
+     * @param cutoff 截止时间
+     * @return 删除的段数
+     */
+    size_t removeSegmentsBefore(time_t cutoff);
+
+    /**
+     * @brief 获取最早的记录序号
+     */
+    uint64_t firstSequence() const;
+
+    /**
+     * @brief 获取最后一条已写出记录之后的序号
+     */
+    uint64_t nextSequence() const;
+
+    /**
+     * @brief 获取段数
+     */
+    size_t segmentCount() const;
+
+    /**
+     * @brief 获取打开时截断的损坏字节数
+     */
+    uint64_t truncatedBytes() const { return recoveredTruncation; }
+
+    /**
+     * @brief 获取读取时因校验失败而跳过的数据区间数
+     */
+    uint64_t corruptRegions() const { return skippedRegions.load(std::memory_order_relaxed); }
+
+private:
+    struct IndexEntry {
+        uint64_t sequence;     ///< 记录序号
+        int64_t timestampMs;   ///< 记录时间戳（毫秒）
+        uint64_t offset;       ///< 记录在段文件中的偏移
+    };
+
+    struct FileHandle;
+
+    struct Segment {
+        uint64_t baseSequence = 0;             ///< 段内首条记录的序号
+        uint64_t endSequence = 0;              ///< 段内最后一条已写出记录的序号加一
+        uint64_t size = 0;                     ///< 已写出的字节数
+        std::vector<IndexEntry> index;         ///< 稀疏索引
+        std::shared_ptr<FileHandle> log;       ///< 段文件
+        std::shared_ptr<FileHandle> idx;       ///< 索引文件
+    };
+
+    /**
+     * @brief 读取段的索引文件，丢弃超出段文件大小的索引项
+     */
+    void loadIndex(Segment& segment);
+
+    /**
+     * @brief 从最后一个索引项开始校验段尾部并截断损坏数据
+     */
+    void recoverTail(Segment& segment);
+
+    /**
+     * @brief 创建新的写入段
+     */
+    void openSegment(uint64_t baseSequence);
+
+    /**
+     * @brief 在需要时按大小或时间滚动当前段
+     */
+    void maybeRoll(int64_t timestampMs);
+
+    /**
+     * @brief 按 retainBytes 删除最旧的段（调用方需持有写锁）
+     */
+    void applyRetention();
+
+    /**
+     * @brief 将写缓冲区写出（调用方需持有写锁）
+     */
+    bool flushLocked();
+
+    /**
+     * @brief 扫描一个段中从 offset 开始的记录
+     * @return 回调要求停止时返回false
+     */
+    bool scanSegment(uint64_t baseSequence, const FileHandle& file, uint64_t offset, uint64_t limit,
+                     uint64_t fromSequence, const Visitor& visitor, size_t& count) const;
+
+    /**
+     * @brief 查找段中偏移大于 offset 的第一个索引项，用于越过损坏数据
+     * @return 索引项偏移，没有时返回 limit
+     */
+    uint64_t nextIndexedOffset(uint64_t baseSequence, uint64_t offset, uint64_t limit) const;
+
+    /**
+     * @brief 段文件路径
+     */
+    std::string segmentPath(uint64_t baseSequence, const char* extension) const;
+
+    std::string directory;                  ///< 日志目录
+    HistoryLogOptions options;              ///< 日志配置
+    mutable std::shared_mutex mutex;        ///< 保护段列表和各段元数据
+    std::vector<Segment> segments;          ///< 按序号排列的段，最后一个为写入段
+    uint64_t next = 0;                      ///< 下一条记录的序号
+    int64_t activeFirstTimestampMs = 0;     ///< 写入段首条记录的时间戳
+    uint64_t bytesSinceIndex = 0;           ///< 距上一个索引项的字节数
+    std::string writeBuffer;                ///< 尚未写出的记录
+    std::vector<IndexEntry> pendingIndex;   ///< 尚未写出的索引项
+    uint64_t recoveredTruncation = 0;       ///< 打开时截断的字节数
+    mutable std::atomic<uint64_t> skippedRegions{0};  ///< 读取时跳过的损坏区间数
+};
+
+} // namespace chat
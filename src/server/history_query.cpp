@@ -0,0 +1,395 @@
+#include "history_query.hpp"
+#include <algorithm>
+#include <charconv>
+
+namespace chat {
+
+namespace {
+
+/**
+ * @brief 取出下一个以空白分隔的词
+ * @return 没有更多词时返回空
+ */
+std::string_view nextToken(std::string_view& in) {
+    size_t start = in.find_first_not_of(" \t");
+    if (start == std::string_view::npos) {
+        in = {};
+        return {};
+    }
+    in.remove_prefix(start);
+    size_t end = std::min(in.find_first_of(" \t"), in.size());
+    std::string_view token = in.substr(0, end);
+    in.remove_prefix(end);
+    return token;
+}
+
+/**
+ * @brief 将整个词解析为整数
+ * @return 词完全由数字组成且不溢出时返回true
+ */
+template <typename T>
+bool parseNumber(std::string_view token, T& value) {
+    auto [end, error] = std::from_chars(token.data(), token.data() + token.size(), value);
+    return error == std::errc() && end == token.data() + token.size() && !token.empty();
+}
+
+/**
+ * @brief 解析查询中的时间
+ * @return 词是 ±kMaxHistoryTimestamp 范围内的整数时返回true
+ */
+bool parseTimestamp(std::string_view token, time_t& value) {
+    return parseNumber(token, value) && value >= -kMaxHistoryTimestamp && value <= kMaxHistoryTimestamp;
+}
+
+/**
+ * @brief 由时间范围的结束时间得到序号上界
+ *
+ * 结束时间包含在范围内，上界取下一秒第一条消息的序号
+ */
+uint64_t endSequenceFor(const HistoryStore& store, time_t to) {
+    return store.sequenceAt(std::min(to, kMaxHistoryTimestamp) + 1);
+}
+
+/**
+ * @brief 按页的大小决定向前翻页的游标
+ */
+std::string backwardCursor(const HistoryPage& page, size_t limit) {
+    if (page.entries.size() < limit || page.nextBefore == 0) {
+        return {};
+    }
+    return "b" + std::to_string(page.nextBefore);
+}
+
+/**
+ * @brief 按页的大小决定向后翻页的游标
+ */
+std::string forwardCursor(const HistoryPage& page, size_t limit, uint64_t end) {
+    if (page.entries.size() < limit || page.nextFrom >= end) {
+        return {};
+    }
+    return "f" + std::to_string(page.nextFrom) + "-" + std::to_string(end);
+}
+
+/**
+ * @brief 按序号从日志批量读取消息，生成从旧到新排列的结果
+ *
+ * 被日志保留策略删除的消息跳过；凑满 limit 条时以最早的序号作为游标
+ *
+ * @param log 历史日志
+ * @param sequences 从新到旧排列的序号
+ * @param limit 查询的条数
+ */
+HistoryQueryResult readSequences(const HistoryLog& log, const std::vector<uint64_t>& sequences, size_t limit) {
+    HistoryQueryResult result;
+    result.entries.reserve(sequences.size());
+    log.readSequences(sequences, [&result](uint64_t sequence, const Message& message) {
+        result.entries.push_back({sequence, message});
+        return true;
+    });
+    if (sequences.size() == limit) {
+        result.cursor = "b" + std::to_string(sequences.back());
+    }
+    return result;
+}
+
+/**
+ * @brief 解析 "next b序号" 游标
+ * @return 格式正确时返回true
+ */
+bool parseBackwardCursor(std::string_view cursor, uint64_t& before) {
+    return cursor.size() >= 2 && cursor[0] == 'b' && parseNumber(cursor.substr(1), before);
+}
+
+/**
+ * @brief 生成 "标记 房间 条数 [游标]" 格式的结束标记消息
+ */
+Message makeEndMessage(std::string_view marker, const std::string& room, const HistoryQueryResult& result) {
+    std::string content(marker);
+    content += " " + room + " " + std::to_string(result.entries.size());
+    if (!result.cursor.empty()) {
+        content += " " + result.cursor;
+    }
+    Message message("server", content);
+    message.room = room;
+    return message;
+}
+
+} // namespace
+
+/**
+ * @brief 解析历史查询命令
+ *
+ * 条数可以省略，超过 kMaxHistoryLimit 时按上限处理
+ *
+ * @param content 消息内容
+ * @param query 用于接收解析结果的查询
+ * @return 内容是格式正确的历史查询命令时返回true
+ */
+bool parseHistoryQuery(std::string_view content, HistoryQuery& query) {
+    if (content.compare(0, kHistoryCommand.size(), kHistoryCommand) != 0) {
+        return false;
+    }
+    std::string_view in = content.substr(kHistoryCommand.size());
+    std::string_view room = nextToken(in);
+    if (!isValidRoomName(room)) {
+        return false;
+    }
+    query = HistoryQuery();
+    query.room.assign(room.data(), room.size());
+
+    std::string_view token = nextToken(in);
+    if (!token.empty() && parseNumber(token, query.limit)) {
+        if (query.limit == 0) {
+            return false;
+        }
+        query.limit = std::min(query.limit, kMaxHistoryLimit);
+        token = nextToken(in);
+    }
+
+    if (token.empty()) {
+        query.kind = HistoryQueryKind::Latest;
+    } else if (token == "before") {
+        query.kind = HistoryQueryKind::Before;
+        if (!parseTimestamp(nextToken(in), query.to)) {
+            return false;
+        }
+    } else if (token == "between") {
+        query.kind = HistoryQueryKind::Between;
+        if (!parseTimestamp(nextToken(in), query.from) || !parseTimestamp(nextToken(in), query.to) ||
+            query.from > query.to) {
+            return false;
+        }
+    } else if (token == "next") {
+        query.kind = HistoryQueryKind::Cursor;
+        std::string_view cursor = nextToken(in);
+        if (cursor.empty()) {
+            return false;
+        }
+        query.cursor.assign(cursor.data(), cursor.size());
+    } else {
+        return false;
+    }
+    return nextToken(in).empty();
+}
+
+/**
+ * @brief 执行历史查询
+ *
+ * @param store 分层聊天历史
+ * @param query 查询
+ * @return 查询结果
+ */
+HistoryQueryResult executeHistoryQuery(const HistoryStore& store, const HistoryQuery& query) {
+    HistoryQueryResult result;
+    HistoryPage page;
+    switch (query.kind) {
+    case HistoryQueryKind::Latest:
+        page = store.page(query.room, HistoryStore::kLatest, query.limit);
+        result.cursor = backwardCursor(page, query.limit);
+        break;
+    case HistoryQueryKind::Before:
+        page = store.page(query.room, store.sequenceAt(query.to), query.limit);
+        result.cursor = backwardCursor(page, query.limit);
+        break;
+    case HistoryQueryKind::Between: {
+        uint64_t end = endSequenceFor(store, query.to);
+        page = store.range(query.room, store.sequenceAt(query.from), end, query.limit);
+        result.cursor = forwardCursor(page, query.limit, end);
+        break;
+    }
+    case HistoryQueryKind::Cursor: {
+        std::string_view cursor = query.cursor;
+        if (cursor.size() < 2) {
+            return result;
+        }
+        char direction = cursor[0];
+        cursor.remove_prefix(1);
+        if (direction == 'b') {
+            uint64_t before;
+            if (!parseNumber(cursor, before)) {
+                return result;
+            }
+            page = store.page(query.room, std::min(before, store.nextSequence()), query.limit);
+            result.cursor = backwardCursor(page, query.limit);
+        } else if (direction == 'f') {
+            size_t dash = cursor.find('-');
+            uint64_t from, end;
+            if (dash == std::string_view::npos || !parseNumber(cursor.substr(0, dash), from) ||
+                !parseNumber(cursor.substr(dash + 1), end)) {
+                return result;
+            }
+            // 游标由客户端回传，序号截断到日志现有的范围
+            from = std::max(from, store.firstSequence());
+            end = std::min(end, store.nextSequence());
+            if (from >= end) {
+                return result;
+            }
+            page = store.range(query.room, from, end, query.limit);
+            result.cursor = forwardCursor(page, query.limit, end);
+        }
+        break;
+    }
+    }
+    result.entries = std::move(page.entries);
+    return result;
+}
+
+/**
+ * @brief 生成查询结果的结束标记消息
+ *
+ * @param query 查询
+ * @param result 查询结果
+ * @return 结束标记消息
+ */
+Message makeHistoryEndMessage(const HistoryQuery& query, const HistoryQueryResult& result) {
+    return makeEndMessage(kHistoryEndMarker, query.room, result);
+}
+
+/**
+ * @brief 解析全文检索命令
+ *
+ * @param content 消息内容
+ * @param query 用于接收解析结果的检索
+ * @return 内容是格式正确且含有检索词的检索命令时返回true
+ */
+bool parseSearchQuery(std::string_view content, SearchQuery& query) {
+    if (content.compare(0, kSearchCommand.size(), kSearchCommand) != 0) {
+        return false;
+    }
+    std::string_view in = content.substr(kSearchCommand.size());
+    std::string_view room = nextToken(in);
+    if (!isValidRoomName(room)) {
+        return false;
+    }
+    query = SearchQuery();
+    query.room.assign(room.data(), room.size());
+
+    // 可选的条数和游标
+    std::string_view rest = in;
+    std::string_view token = nextToken(rest);
+    if (!token.empty() && parseNumber(token, query.limit)) {
+        if (query.limit == 0) {
+            return false;
+        }
+        query.limit = std::min(query.limit, kMaxSearchLimit);
+        in = rest;
+        token = nextToken(rest);
+    }
+    if (token == "next") {
+        std::string_view cursor = nextToken(rest);
+        if (!parseBackwardCursor(cursor, query.before)) {
+            return false;
+        }
+        in = rest;
+    }
+
+    // 查询项：双引号括起的短语或以空白分隔的词
+    for (;;) {
+        size_t start = in.find_first_not_of(" \t");
+        if (start == std::string_view::npos) {
+            break;
+        }
+        in.remove_prefix(start);
+        std::string_view item;
+        if (in[0] == '"') {
+            size_t close = in.find('"', 1);
+            item = in.substr(1, close == std::string_view::npos ? std::string_view::npos : close - 1);
+            in.remove_prefix(close == std::string_view::npos ? in.size() : close + 1);
+        } else {
+            item = nextToken(in);
+        }
+        std::vector<std::string> terms = tokenizeText(item);
+        if (!terms.empty()) {
+            query.phrases.push_back(std::move(terms));
+        }
+    }
+    return !query.phrases.empty();
+}
+
+/**
+ * @brief 执行全文检索
+ *
+ * @param index 全文索引
+ * @param log 历史日志
+ * @param query 检索
+ * @return 检索结果
+ */
+HistoryQueryResult executeSearchQuery(const SearchIndex& index, const HistoryLog& log, const SearchQuery& query) {
+    return readSequences(log, index.search(query.room, query.phrases, query.before, query.limit), query.limit);
+}
+
+/**
+ * @brief 生成检索结果的结束标记消息
+ *
+ * @param query 检索
+ * @param result 检索结果
+ * @return 结束标记消息
+ */
+Message makeSearchEndMessage(const SearchQuery& query, const HistoryQueryResult& result) {
+    return makeEndMessage(kSearchEndMarker, query.room, result);
+}
+
+/**
+ * @brief 解析按用户查询命令
+ *
+ * @param content 消息内容
+ * @param query 用于接收解析结果的查询
+ * @return 内容是格式正确的按用户查询命令时返回true
+ */
+bool parseUserQuery(std::string_view content, UserQuery& query) {
+    if (content.compare(0, kUserCommand.size(), kUserCommand) != 0) {
+        return false;
+    }
+    std::string_view in = content.substr(kUserCommand.size());
+    std::string_view room = nextToken(in);
+    std::string_view username = nextToken(in);
+    if (!isValidRoomName(room) || username.empty()) {
+        return false;
+    }
+    query = UserQuery();
+    query.room.assign(room.data(), room.size());
+    query.username.assign(username.data(), username.size());
+
+    std::string_view token = nextToken(in);
+    if (!token.empty() && parseNumber(token, query.limit)) {
+        if (query.limit == 0) {
+            return false;
+        }
+        query.limit = std::min(query.limit, kMaxHistoryLimit);
+        token = nextToken(in);
+    }
+    if (token == "next") {
+        if (!parseBackwardCursor(nextToken(in), query.before)) {
+            return false;
+        }
+        token = nextToken(in);
+    }
+    return token.empty();
+}
+
+/**
+ * @brief 执行按用户查询
+ *
+ * @param index 用户索引
+ * @param log 历史日志
+ * @param query 查询
+ * @return 查询结果
+ */
+HistoryQueryResult executeUserQuery(const SearchIndex& index, const HistoryLog& log, const UserQuery& query) {
+    std::vector<uint64_t> sequences =
+        index.lookup(userIndexKey(query.room, query.username), query.before, query.limit);
+    return readSequences(log, sequences, query.limit);
+}
+
+/**
+ * @brief 生成按用户查询结果的结束标记消息
+ *
+ * @param query 查询
+ * @param result 查询结果
+ * @return 结束标记消息
+ */
+Message makeUserEndMessage(const UserQuery& query, const HistoryQueryResult& result) {
+    return makeEndMessage(kUserEndMarker, query.room, result);
+}
+
+} // namespace chat
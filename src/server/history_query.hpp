@@ -0,0 +1,220 @@
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "../common/message.hpp"
+#include "history_log.hpp"
+#include "history_store.hpp"
+#include "search_index.hpp"
+
+namespace chat {
+
+/// 历史查询命令前缀
+constexpr std::string_view kHistoryCommand = "/history ";
+
+/// 历史查询结束标记，作为服务器回复的最后一条消息内容的开头
+constexpr std::string_view kHistoryEndMarker = "/history-end";
+
+/// 查询未指定条数时返回的消息数
+constexpr size_t kDefaultHistoryLimit = 50;
+
+/// 单次查询最多返回的消息数
+constexpr size_t kMaxHistoryLimit = 500;
+
+/**
+ * @brief 历史查询的类型
+ */
+enum class HistoryQueryKind {
+    Latest,    ///< 最近的 limit 条消息
+    Before,    ///< 指定时间之前的最近 limit 条消息
+    Between,   ///< 时间范围内最早的 limit 条消息
+    Cursor     ///< 以上一页返回的游标继续
+};
+
+/**
+ * @brief 客户端发来的历史查询
+ *
+ * 命令格式：
+ * - /history 房间 [条数]
+ * - /history 房间 [条数] before 时间
+ * - /history 房间 [条数] between 起始时间 结束时间
+ * - /history 房间 [条数] next 游标
+ *
+ * 时间为 Unix 时间戳（秒），不超过 ±kMaxHistoryTimestamp；between 的两端都包含在内
+ */
+struct HistoryQuery {
+    std::string room;                               ///< 房间名
+    size_t limit = kDefaultHistoryLimit;            ///< 最多返回的消息数
+    HistoryQueryKind kind = HistoryQueryKind::Latest;  ///< 查询类型
+    time_t from = 0;                                ///< Between 的起始时间
+    time_t to = 0;                                  ///< Before 的截止时间（不含）或 Between 的结束时间（包含）
+    std::string cursor;                             ///< Cursor 查询的游标
+};
+
+/**
+ * @brief 历史查询结果
+ */
+struct HistoryQueryResult {
+    std::vector<HistoryEntry> entries;   ///< 本页消息，按时间从旧到新
+    std::string cursor;                  ///< 下一页的游标，为空表示没有更多消息
+};
+
+/**
+ * @brief 解析历史查询命令
+ *
+ * @param content 消息内容
+ * @param query 用于接收解析结果的查询
+ * @return 内容是格式正确的历史查询命令时返回true
+ */
+bool parseHistoryQuery(std::string_view content, HistoryQuery& query);
+
+/**
+ * @brief 执行历史查询
+ *
+ * 时间先通过历史日志的时间索引换算为序号，之后按序号在内存队列或日志中
+ * 分页读取，查询耗时与历史总量成对数关系。游标记录翻页方向和下一页的
+ * 序号边界，服务器不为查询保存任何状态：
+ * - "b序号"：向前翻页，读取序号小于该值的消息
+ * - "f序号-序号"：向后翻页，读取序号在 [前者, 后者) 内的消息
+ *
+ * 游标格式错误时返回空结果；游标中的序号截断到日志现有的序号范围
+ *
+ * @param store 分层聊天历史
+ * @param query 查询
+ * @return 查询结果
+ */
+HistoryQueryResult executeHistoryQuery(const HistoryStore& store, const HistoryQuery& query);
+
+/**
+ * @brief 生成查询结果的结束标记消息
+ *
+ * 内容为 "/history-end 房间 条数 [游标]"，客户端据此判断本页已收完并继续翻页
+ *
+ * @param query 查询
+ * @param result 查询结果
+ * @return 结束标记消息
+ */
+Message makeHistoryEndMessage(const HistoryQuery& query, const HistoryQueryResult& result);
+
+/// 全文检索命令前缀
+constexpr std::string_view kSearchCommand = "/search ";
+
+/// 全文检索结束标记，作为服务器回复的最后一条消息内容的开头
+constexpr std::string_view kSearchEndMarker = "/search-end";
+
+/// 检索未指定条数时返回的消息数
+constexpr size_t kDefaultSearchLimit = 20;
+
+/// 单次检索最多返回的消息数
+constexpr size_t kMaxSearchLimit = 100;
+
+/**
+ * @brief 客户端发来的全文检索
+ *
+ * 命令格式：/search 房间 [条数] [next 游标] 查询
+ *
+ * 查询由空白分隔的若干项组成，所有项都须出现在消息中（AND）；
+ * 用双引号括起的项是短语，其中的词须按顺序相邻出现。不加引号的项如果
+ * 切分出多个词（如一串汉字）同样按短语匹配。紧跟房间名的纯数字被当作
+ * 条数，要检索以数字开头的查询时给它加上引号。
+ */
+struct SearchQuery {
+    std::string room;                                ///< 房间名
+    size_t limit = kDefaultSearchLimit;              ///< 最多返回的消息数
+    uint64_t before = HistoryStore::kLatest;         ///< 只返回序号小于此值的消息
+    std::vector<std::vector<std::string>> phrases;   ///< 短语列表，每个短语是一组检索词
+};
+
+/**
+ * @brief 解析全文检索命令
+ *
+ * @param content 消息内容
+ * @param query 用于接收解析结果的检索
+ * @return 内容是格式正确且含有检索词的检索命令时返回true
+ */
+bool parseSearchQuery(std::string_view content, SearchQuery& query);
+
+/**
+ * @brief 执行全文检索
+ *
+ * 在倒排索引中找出最新的 limit 条匹配消息，再按序号从历史日志读取消息内容。
+ * 结果按时间从旧到新排列；凑满 limit 条时游标为 "b最早一条的序号"，
+ * 以之继续可得到更早的匹配
+ *
+ * @param index 全文索引
+ * @param log 历史日志
+ * @param query 检索
+ * @return 检索结果
+ */
+HistoryQueryResult executeSearchQuery(const SearchIndex& index, const HistoryLog& log, const SearchQuery& query);
+
+/**
+ * @brief 生成检索结果的结束标记消息
+ *
+ * 内容为 "/search-end 房间 条数 [游标]"
+ *
+ * @param query 检索
+ * @param result 检索结果
+ * @return 结束标记消息
+ */
+Message makeSearchEndMessage(const SearchQuery& query, const HistoryQueryResult& result);
+
+/// 按用户查询命令前缀
+constexpr std::string_view kUserCommand = "/from ";
+
+/// 按用户查询结束标记，作为服务器回复的最后一条消息内容的开头
+constexpr std::string_view kUserEndMarker = "/from-end";
+
+/**
+ * @brief 按用户查询消息
+ *
+ * 命令格式：/from 房间 用户名 [条数] [next 游标]
+ *
+ * 客户端命令只能查询房间内的消息；room 为空表示跨所有房间，供审核等
+ * 服务器内部用途。用户名不能含空白。
+ */
+struct UserQuery {
+    std::string room;                           ///< 房间名，为空表示所有房间
+    std::string username;                       ///< 用户名
+    size_t limit = kDefaultHistoryLimit;        ///< 最多返回的消息数
+    uint64_t before = HistoryStore::kLatest;    ///< 只返回序号小于此值的消息
+};
+
+/**
+ * @brief 解析按用户查询命令
+ *
+ * @param content 消息内容
+ * @param query 用于接收解析结果的查询
+ * @return 内容是格式正确的按用户查询命令时返回true
+ */
+bool parseUserQuery(std::string_view content, UserQuery& query);
+
+/**
+ * @brief 执行按用户查询
+ *
+ * 在用户索引中读取该用户最新的 limit 条消息的序号，再从历史日志读取消息内容，
+ * 耗时与该用户的消息数成正比，与历史总量无关。结果按时间从旧到新排列；
+ * 凑满 limit 条时游标为 "b最早一条的序号"
+ *
+ * @param index 以 userIndexKeys 建立的用户索引
+ * @param log 历史日志
+ * @param query 查询
+ * @return 查询结果
+ */
+HistoryQueryResult executeUserQuery(const SearchIndex& index, const HistoryLog& log, const UserQuery& query);
+
+/**
+ * @brief 生成按用户查询结果的结束标记消息
+ *
+ * 内容为 "/from-end 房间 条数 [游标]"
+ *
+ * @param query 查询
+ * @param result 查询结果
+ * @return 结束标记消息
+ */
+Message makeUserEndMessage(const UserQuery& query, const HistoryQueryResult& result);
+
+} // namespace chat
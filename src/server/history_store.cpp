@@ -0,0 +1,746 @@
+#include "history_store.hpp"
+#include "search_index.hpp"
+#include "../common/crc32c.hpp"
+#include "../common/file_util.hpp"
+#include "../common/logger.hpp"
+#include "../common/wire_format.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iterator>
+
+namespace chat {
+
+namespace {
+
+/// 预热线程每读入这么多条记录合并一次，减少锁竞争
+constexpr size_t kWarmupBatch = 4096;
+
+/// 从日志向前扫描时第一个窗口的最小记录数，之后每轮翻倍
+constexpr size_t kMinScanWindow = 256;
+
+/// 快照文件头
+constexpr char kSnapshotMagic[4] = {'C', 'H', 'S', 'S'};
+
+/// 快照格式版本，版本 2 起消息以紧凑记录保存，用户名集中存放
+constexpr uint8_t kSnapshotVersion = 2;
+
+/**
+ * @brief 读取变长整数表示的长度并截取对应的数据
+ * @return 数据完整时返回true
+ */
+bool readBytes(std::string_view& in, std::string_view& out) {
+    uint64_t length;
+    if (!readVarint(in, length) || length > in.size()) {
+        return false;
+    }
+    out = in.substr(0, length);
+    in.remove_prefix(length);
+    return true;
+}
+
+/**
+ * @brief 字符串在分配器中实际占用的槽位字节数，短字符串优化时为 0
+ */
+size_t heapBytes(const SlabString& str) {
+    const char* object = reinterpret_cast<const char*>(&str);
+    bool inline_ = str.data() >= object && str.data() < object + sizeof(str);
+    return inline_ ? 0 : SlabPool::slotSize(str.capacity() + 1);
+}
+
+/**
+ * @brief 消息所属的房间，旧记录没有房间时归入默认房间
+ */
+const std::string& roomOf(const Message& message) {
+    static const std::string defaultRoom = kDefaultRoom;
+    return message.room.empty() ? defaultRoom : message.room;
+}
+
+} // namespace
+
+/**
+ * @brief 构造函数
+ *
+ * 未预热时内存中没有已持久化的记录，所有房间的队列从日志当前末尾起完整
+ *
+ * @param log 历史日志
+ * @param options 内存配置
+ */
+HistoryStore::HistoryStore(const HistoryLog& log, const HistoryStoreOptions& options)
+    : log(log), options(options), coveredFrom(log.nextSequence()), appliedSequence(log.nextSequence()) {}
+
+/**
+ * @brief 析构函数
+ *
+ * 通知预热线程尽快退出并等待其结束
+ */
+HistoryStore::~HistoryStore() {
+    cancelled.store(true);
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+/**
+ * @brief 估算一条消息占用的内存
+ *
+ * 包括记录本身和内容的堆内存，不含容器自身的少量开销；用户名由驻留表
+ * 统一保存，不计入单条消息
+ */
+size_t HistoryStore::entryBytes(const StoredEntry& entry) {
+    return sizeof(StoredEntry) + heapBytes(entry.content);
+}
+
+/**
+ * @brief 在 payloads 中复制一份消息内容
+ *
+ * @param content 消息内容
+ * @return 从 payloads 分配的字符串
+ */
+SlabString HistoryStore::makePayload(std::string_view content) {
+    return SlabString(content.data(), content.size(), SlabAllocator<char>(&payloads));
+}
+
+/**
+ * @brief 将紧凑记录还原为带序号的消息
+ *
+ * @param entry 紧凑记录
+ * @param room 记录所在队列的房间名
+ * @return 带序号的消息
+ */
+HistoryEntry HistoryStore::expand(const StoredEntry& entry, const std::string& room) const {
+    HistoryEntry result{entry.sequence, Message(std::string(usernames.name(entry.user)),
+                                                std::string(entry.content.data(), entry.content.size()))};
+    result.message.timestamp = entry.timestamp;
+    result.message.id = entry.id;
+    result.message.room = room;
+    return result;
+}
+
+/**
+ * @brief 启动后台预热
+ *
+ * 在调用线程中记下日志末尾序号，之后写入的记录由 append 提供
+ */
+void HistoryStore::startWarmup() {
+    uint64_t endSequence = log.nextSequence();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ready = false;
+    }
+    worker = std::thread([this, endSequence]() { warmup(endSequence); });
+}
+
+/**
+ * @brief 预热线程主函数
+ *
+ * 优先载入快照并只重放快照之后的日志记录；没有有效快照时按内存上限
+ * 读入日志末尾的记录。完成后把预热期间的新消息接在末尾并记录恢复耗时
+ *
+ * @param endSequence 预热的结束序号（不含）
+ */
+void HistoryStore::warmup(uint64_t endSequence) {
+    auto start = std::chrono::steady_clock::now();
+    HistoryRecoveryStats stats;
+    stats.truncatedBytes = log.truncatedBytes();
+
+    std::string snapshot;
+    uint64_t replayFrom;
+    if (!options.snapshotPath.empty() && readFile(options.snapshotPath, snapshot)) {
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.fromSnapshot = loadSnapshotLocked(snapshot, endSequence);
+        if (stats.fromSnapshot) {
+            stats.snapshotSequence = appliedSequence;
+            for (const auto& [name, room] : rooms) {
+                stats.snapshotMessages += room.entries.size();
+            }
+        }
+    }
+    snapshot.clear();
+    snapshot.shrink_to_fit();
+    if (stats.fromSnapshot) {
+        replayFrom = stats.snapshotSequence;
+    } else {
+        replayFrom = log.sequenceForTailBytes(options.totalBytes);
+        std::lock_guard<std::mutex> lock(mutex);
+        coveredFrom = replayFrom;
+    }
+
+    std::vector<HistoryEntry> batch;
+    batch.reserve(kWarmupBatch);
+    auto mergeBatch = [this, &batch, &stats]() {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const HistoryEntry& entry : batch) {
+            insertLocked(entry.sequence, entry.message);
+        }
+        stats.replayedRecords += batch.size();
+        batch.clear();
+    };
+
+    log.read(replayFrom, [&](uint64_t sequence, const Message& message) {
+        if (sequence >= endSequence || cancelled.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        batch.push_back({sequence, message});
+        if (batch.size() == kWarmupBatch) {
+            mergeBatch();
+        }
+        return true;
+    });
+    mergeBatch();
+
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        appliedSequence = std::max(appliedSequence, endSequence);
+        for (const HistoryEntry& entry : live) {
+            insertLocked(entry.sequence, entry.message);
+        }
+        live.clear();
+        live.shrink_to_fit();
+        recovery = stats;
+        ready = true;
+    }
+    readyCondition.notify_all();
+
+    if (stats.fromSnapshot) {
+        CHAT_LOG_INFO("History recovery: loaded snapshot with " + std::to_string(stats.snapshotMessages) +
+                      " messages up to #" + std::to_string(stats.snapshotSequence) + ", replayed " +
+                      std::to_string(stats.replayedRecords) + " log records in " +
+                      std::to_string(stats.seconds) + "s");
+    } else {
+        CHAT_LOG_INFO("History recovery: no snapshot, loaded " + std::to_string(stats.replayedRecords) +
+                      " recent log records in " + std::to_string(stats.seconds) + "s");
+    }
+    if (stats.truncatedBytes > 0) {
+        CHAT_LOG_WARN("History recovery: truncated " + std::to_string(stats.truncatedBytes) +
+                      " corrupt bytes from the log tail");
+    }
+}
+
+/**
+ * @brief 读取并校验快照，成功时载入内存
+ *
+ * 校验和不符、格式错误或快照超前于日志（日志尾部在崩溃中丢失）时放弃快照
+ *
+ * @param data 快照文件内容
+ * @param endSequence 日志当前的末尾序号
+ * @return 载入成功时返回true
+ */
+bool HistoryStore::loadSnapshotLocked(const std::string& data, uint64_t endSequence) {
+    constexpr size_t kHeaderSize = sizeof(kSnapshotMagic) + 1;
+    auto reject = [this](const char* reason) {
+        CHAT_LOG_WARN("History recovery: ignoring snapshot " + options.snapshotPath + ": " + reason);
+        return false;
+    };
+    if (data.size() < kHeaderSize + 4 || std::memcmp(data.data(), kSnapshotMagic, sizeof(kSnapshotMagic)) != 0) {
+        return reject("bad header");
+    }
+    if (static_cast<uint8_t>(data[sizeof(kSnapshotMagic)]) != kSnapshotVersion) {
+        return reject("unsupported version");
+    }
+    std::string_view body(data.data() + kHeaderSize, data.size() - kHeaderSize - 4);
+    if (crc32c(body.data(), body.size()) != loadFixed32(data.data() + data.size() - 4)) {
+        return reject("checksum mismatch");
+    }
+
+    uint64_t snapshotSequence, defaultCoveredFrom, userCount, roomCount;
+    if (!readVarint(body, snapshotSequence) || !readVarint(body, defaultCoveredFrom) ||
+        !readVarint(body, userCount) || userCount > body.size()) {
+        return reject("truncated");
+    }
+    if (snapshotSequence > endSequence) {
+        return reject("snapshot is ahead of the history log");
+    }
+
+    // 快照中的用户名下标换算为本进程驻留表的编号
+    std::vector<uint32_t> users;
+    users.reserve(userCount);
+    for (uint64_t i = 0; i < userCount; ++i) {
+        std::string_view name;
+        if (!readBytes(body, name)) {
+            return reject("truncated");
+        }
+        users.push_back(usernames.intern(name));
+    }
+    if (!readVarint(body, roomCount)) {
+        return reject("truncated");
+    }
+
+    // 先完整解析再替换内存状态，格式错误时不留下半个快照
+    struct SnapshotRoom {
+        std::string_view name;
+        uint64_t coveredFrom;
+        std::vector<StoredEntry> entries;
+    };
+    std::vector<SnapshotRoom> parsed;
+    for (uint64_t i = 0; i < roomCount; ++i) {
+        SnapshotRoom room;
+        uint64_t entryCount;
+        if (!readBytes(body, room.name) || !readVarint(body, room.coveredFrom) || !readVarint(body, entryCount)) {
+            return reject("truncated");
+        }
+        for (uint64_t j = 0; j < entryCount; ++j) {
+            uint64_t sequence, id, timestamp, user;
+            std::string_view content;
+            if (!readVarint(body, sequence) || !readVarint(body, id) || !readVarint(body, timestamp) ||
+                !readVarint(body, user) || user >= users.size() || !readBytes(body, content)) {
+                return reject("corrupt message");
+            }
+            room.entries.push_back({sequence, id, static_cast<time_t>(zigzagDecode(timestamp)),
+                                    users[user], makePayload(content)});
+        }
+        parsed.push_back(std::move(room));
+    }
+    if (!body.empty()) {
+        return reject("trailing data");
+    }
+
+    rooms.clear();
+    oldest.clear();
+    totalBytes = 0;
+    coveredFrom = defaultCoveredFrom;
+    for (SnapshotRoom& snapshotRoom : parsed) {
+        std::string name(snapshotRoom.name);
+        rooms[name].coveredFrom = snapshotRoom.coveredFrom;
+        for (StoredEntry& entry : snapshotRoom.entries) {
+            insertLocked(name, std::move(entry));
+        }
+    }
+    appliedSequence = snapshotSequence;
+    return true;
+}
+
+/**
+ * @brief 将当前内存状态写入快照文件
+ *
+ * 在锁内编码，在锁外写文件
+ *
+ * @return 写入成功时返回true
+ */
+bool HistoryStore::saveSnapshot() const {
+    if (options.snapshotPath.empty()) {
+        return false;
+    }
+    auto appendBytes = [](std::string& out, std::string_view bytes) {
+        appendVarint(out, bytes.size());
+        out.append(bytes);
+    };
+    std::string data(kSnapshotMagic, sizeof(kSnapshotMagic));
+    data.push_back(static_cast<char>(kSnapshotVersion));
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!ready) {
+            return false;
+        }
+        // 只写出队列中出现过的用户名，按驻留编号换算为快照内的下标
+        std::unordered_map<uint32_t, uint32_t> users;
+        std::vector<uint32_t> userOrder;
+        for (const auto& [name, room] : rooms) {
+            for (const StoredEntry& entry : room.entries) {
+                if (users.emplace(entry.user, static_cast<uint32_t>(userOrder.size())).second) {
+                    userOrder.push_back(entry.user);
+                }
+            }
+        }
+
+        data.reserve(totalBytes);
+        appendVarint(data, appliedSequence);
+        appendVarint(data, coveredFrom);
+        appendVarint(data, userOrder.size());
+        for (uint32_t user : userOrder) {
+            appendBytes(data, usernames.name(user));
+        }
+        appendVarint(data, rooms.size());
+        for (const auto& [name, room] : rooms) {
+            appendBytes(data, name);
+            appendVarint(data, room.coveredFrom);
+            appendVarint(data, room.entries.size());
+            for (const StoredEntry& entry : room.entries) {
+                appendVarint(data, entry.sequence);
+                appendVarint(data, entry.id);
+                appendVarint(data, zigzagEncode(static_cast<int64_t>(entry.timestamp)));
+                appendVarint(data, users[entry.user]);
+                appendBytes(data, entry.content);
+            }
+        }
+    }
+    constexpr size_t kHeaderSize = sizeof(kSnapshotMagic) + 1;
+    appendFixed32(data, crc32c(data.data() + kHeaderSize, data.size() - kHeaderSize));
+
+    if (!writeFileAtomic(options.snapshotPath, data)) {
+        CHAT_LOG_ERROR("Error saving history snapshot: " + std::string(std::strerror(errno)));
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief 获取启动恢复统计
+ */
+HistoryRecoveryStats HistoryStore::getRecoveryStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return recovery;
+}
+
+/**
+ * @brief 追加一条已写入日志的消息
+ *
+ * @param sequence 日志序号
+ * @param message 消息
+ */
+void HistoryStore::append(uint64_t sequence, const Message& message) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!ready) {
+        live.push_back({sequence, message});
+        return;
+    }
+    insertLocked(sequence, message);
+}
+
+/**
+ * @brief 将消息放入房间队列并按上限移出旧消息
+ *
+ * @param sequence 日志序号
+ * @param message 消息
+ */
+void HistoryStore::insertLocked(uint64_t sequence, const Message& message) {
+    insertLocked(roomOf(message),
+                 StoredEntry{sequence, message.id, message.timestamp, usernames.intern(message.username),
+                             makePayload(message.content)});
+}
+
+/**
+ * @brief 将紧凑记录放入指定房间的队列并按上限移出旧消息
+ *
+ * 新建房间的队列从默认完整起点开始完整
+ *
+ * @param roomName 房间名
+ * @param entry 紧凑记录
+ */
+void HistoryStore::insertLocked(const std::string& roomName, StoredEntry entry) {
+    auto [it, inserted] = rooms.try_emplace(roomName);
+    RoomHistory& room = it->second;
+    if (inserted) {
+        room.coveredFrom = coveredFrom;
+    }
+    uint64_t sequence = entry.sequence;
+    if (room.entries.empty()) {
+        oldest.emplace(sequence, &room);
+    }
+    room.entries.push_back(std::move(entry));
+    appliedSequence = std::max(appliedSequence, sequence + 1);
+    size_t bytes = entryBytes(room.entries.back());
+    room.bytes += bytes;
+    totalBytes += bytes;
+
+    while (room.bytes > options.roomBytes) {
+        evictFrontLocked(room);
+    }
+    while (totalBytes > options.totalBytes && !oldest.empty()) {
+        evictFrontLocked(*oldest.begin()->second);
+    }
+}
+
+/**
+ * @brief 移出房间最旧的一条消息
+ *
+ * 该消息已在日志中，移出后队列的完整起点前移到它之后
+ *
+ * @param room 房间队列
+ */
+void HistoryStore::evictFrontLocked(RoomHistory& room) {
+    const StoredEntry& front = room.entries.front();
+    oldest.erase({front.sequence, &room});
+    room.coveredFrom = front.sequence + 1;
+    size_t bytes = entryBytes(front);
+    room.bytes -= bytes;
+    totalBytes -= bytes;
+    room.entries.pop_front();
+    ++evicted;
+    if (!room.entries.empty()) {
+        oldest.emplace(room.entries.front().sequence, &room);
+    }
+}
+
+/**
+ * @brief 预热是否已完成
+ */
+bool HistoryStore::isReady() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return ready;
+}
+
+/**
+ * @brief 等待预热完成
+ *
+ * @param timeout 最长等待时间
+ * @return 预热已完成时返回true
+ */
+bool HistoryStore::waitUntilReady(std::chrono::milliseconds timeout) const {
+    std::unique_lock<std::mutex> lock(mutex);
+    return readyCondition.wait_for(lock, timeout, [this]() { return ready; });
+}
+
+/**
+ * @brief 读取房间中序号小于 before 的最近 limit 条消息
+ *
+ * 内存队列覆盖的部分在锁内复制，不足的部分在锁外从日志读取；
+ * 预热期间内存队列尚不完整，全部从日志读取
+ *
+ * @param room 房间名
+ * @param before 序号上界（不含）
+ * @param limit 最多返回的消息数
+ * @return 分页结果
+ */
+HistoryPage HistoryStore::page(const std::string& room, uint64_t before, size_t limit) const {
+    HistoryPage result;
+    std::vector<HistoryEntry> fromMemory;
+    uint64_t diskBefore = before;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (ready) {
+            auto it = rooms.find(room);
+            uint64_t covered = it != rooms.end() ? it->second.coveredFrom : coveredFrom;
+            if (before > covered) {
+                if (it != rooms.end()) {
+                    const std::deque<StoredEntry>& entries = it->second.entries;
+                    auto last = std::lower_bound(entries.begin(), entries.end(), before,
+                                                 [](const StoredEntry& entry, uint64_t sequence) {
+                                                     return entry.sequence < sequence;
+                                                 });
+                    size_t take = std::min(limit, static_cast<size_t>(last - entries.begin()));
+                    fromMemory.reserve(take);
+                    for (auto entry = last - static_cast<ptrdiff_t>(take); entry != last; ++entry) {
+                        fromMemory.push_back(expand(*entry, it->first));
+                    }
+                }
+                diskBefore = covered;
+            }
+        }
+        if (fromMemory.size() < limit && diskBefore > 0) {
+            ++diskReads;
+        } else {
+            ++memoryHits;
+        }
+    }
+
+    if (fromMemory.size() < limit && diskBefore > 0) {
+        result.entries = readFromLog(room, diskBefore, limit - fromMemory.size(), result.diskRecords);
+    }
+    std::move(fromMemory.begin(), fromMemory.end(), std::back_inserter(result.entries));
+    result.nextBefore = result.entries.empty() ? 0 : result.entries.front().sequence;
+    return result;
+}
+
+/**
+ * @brief 按房间索引给出的序号从日志批量读取消息
+ *
+ * 同一索引区间内的序号由日志合并为一次读取，被保留策略删除的序号跳过
+ *
+ * @param sequences 房间索引给出的序号
+ * @param scanned 累加读取的记录数
+ * @return 按序号从旧到新排列的消息
+ */
+std::vector<HistoryEntry> HistoryStore::readIndexed(const std::vector<uint64_t>& sequences, size_t& scanned) const {
+    std::vector<HistoryEntry> result;
+    result.reserve(sequences.size());
+    scanned += log.readSequences(sequences, [&result](uint64_t sequence, const Message& message) {
+        result.push_back({sequence, message});
+        return true;
+    });
+    return result;
+}
+
+/**
+ * @brief 从日志读取房间中序号小于 before 的最近 limit 条消息
+ *
+ * 房间索引可用时只读取索引给出的序号。否则日志只能顺序向后读，这里从 before
+ * 往前取一个窗口读到 before，不够时窗口翻倍继续向前，扫描量与实际需要的范围成正比
+ *
+ * @param room 房间名
+ * @param before 序号上界（不含）
+ * @param limit 最多返回的消息数
+ * @param scanned 累加扫描的记录数
+ * @return 按序号从旧到新排列的消息
+ */
+std::vector<HistoryEntry> HistoryStore::readFromLog(const std::string& room, uint64_t before, size_t limit,
+                                                    size_t& scanned) const {
+    uint64_t first = log.firstSequence();
+    uint64_t end = std::min(before, log.nextSequence());
+    if (options.roomIndex && options.roomIndex->isReady()) {
+        return readIndexed(options.roomIndex->lookup(room, end, limit), scanned);
+    }
+
+    std::vector<HistoryEntry> result;
+    uint64_t window = std::max<uint64_t>(kMinScanWindow, static_cast<uint64_t>(limit) * 8);
+
+    while (result.size() < limit && end > first) {
+        uint64_t start = end - first > window ? end - window : first;
+        std::vector<HistoryEntry> matches;
+        log.read(start, [&](uint64_t sequence, const Message& message) {
+            if (sequence >= end) {
+                return false;
+            }
+            ++scanned;
+            if (roomOf(message) == room) {
+                matches.push_back({sequence, message});
+            }
+            return true;
+        });
+        size_t take = std::min(limit - result.size(), matches.size());
+        result.insert(result.begin(), std::make_move_iterator(matches.end() - static_cast<ptrdiff_t>(take)),
+                      std::make_move_iterator(matches.end()));
+        end = start;
+        window *= 2;
+    }
+    return result;
+}
+
+/**
+ * @brief 读取房间中序号在 [from, end) 内最早的 limit 条消息
+ *
+ * 与 page 相同，内存队列覆盖的部分在锁内复制，队列完整起点之前的部分在锁外
+ * 从日志读取，两段按序号拼接后截取前 limit 条
+ *
+ * @param room 房间名
+ * @param from 序号下界（包含）
+ * @param end 序号上界（不含）
+ * @param limit 最多返回的消息数
+ * @return 分页结果
+ */
+HistoryPage HistoryStore::range(const std::string& room, uint64_t from, uint64_t end, size_t limit) const {
+    HistoryPage result;
+    std::vector<HistoryEntry> fromMemory;
+    uint64_t diskEnd = end;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (ready) {
+            auto it = rooms.find(room);
+            uint64_t covered = it != rooms.end() ? it->second.coveredFrom : coveredFrom;
+            if (end > covered) {
+                if (it != rooms.end()) {
+                    const std::deque<StoredEntry>& entries = it->second.entries;
+                    auto compare = [](const StoredEntry& entry, uint64_t sequence) {
+                        return entry.sequence < sequence;
+                    };
+                    auto first = std::lower_bound(entries.begin(), entries.end(), std::max(from, covered), compare);
+                    auto last = std::lower_bound(first, entries.end(), end, compare);
+                    size_t take = std::min(limit, static_cast<size_t>(last - first));
+                    fromMemory.reserve(take);
+                    for (auto entry = first; entry != first + static_cast<ptrdiff_t>(take); ++entry) {
+                        fromMemory.push_back(expand(*entry, it->first));
+                    }
+                }
+                diskEnd = covered;
+            }
+        }
+        if (from < diskEnd) {
+            ++diskReads;
+        } else {
+            ++memoryHits;
+        }
+    }
+
+    if (from < diskEnd) {
+        result.entries = readRangeFromLog(room, from, diskEnd, limit, result.diskRecords);
+    }
+    size_t take = std::min(limit - result.entries.size(), fromMemory.size());
+    std::move(fromMemory.begin(), fromMemory.begin() + static_cast<ptrdiff_t>(take),
+              std::back_inserter(result.entries));
+    result.nextFrom = result.entries.empty() ? end : result.entries.back().sequence + 1;
+    result.nextBefore = result.entries.empty() ? 0 : result.entries.front().sequence;
+    return result;
+}
+
+/**
+ * @brief 从日志读取房间中序号在 [from, end) 内最早的 limit 条消息
+ *
+ * 房间索引可用时只读取索引给出的序号，否则从 from 顺序扫描
+ *
+ * @param room 房间名
+ * @param from 序号下界（包含）
+ * @param end 序号上界（不含）
+ * @param limit 最多返回的消息数
+ * @param scanned 累加扫描的记录数
+ * @return 按序号从旧到新排列的消息
+ */
+std::vector<HistoryEntry> HistoryStore::readRangeFromLog(const std::string& room, uint64_t from, uint64_t end,
+                                                         size_t limit, size_t& scanned) const {
+    std::vector<HistoryEntry> result;
+    if (limit == 0) {
+        return result;
+    }
+    if (options.roomIndex && options.roomIndex->isReady()) {
+        return readIndexed(options.roomIndex->lookupRange(room, from, end, limit), scanned);
+    }
+    log.read(from, [&](uint64_t sequence, const Message& message) {
+        if (sequence >= end) {
+            return false;
+        }
+        ++scanned;
+        if (roomOf(message) == room) {
+            result.push_back({sequence, message});
+        }
+        return result.size() < limit;
+    });
+    return result;
+}
+
+/**
+ * @brief 查找时间戳不早于指定时间的第一条消息的序号
+ *
+ * 内存队列中的消息都已写入日志，直接使用日志的时间索引
+ *
+ * @param timestamp 时间
+ * @return 日志序号
+ */
+uint64_t HistoryStore::sequenceAt(time_t timestamp) const {
+    return log.findSequenceAt(timestamp);
+}
+
+/**
+ * @brief 日志中最早一条记录的序号
+ */
+uint64_t HistoryStore::firstSequence() const {
+    return log.firstSequence();
+}
+
+/**
+ * @brief 日志的末尾序号
+ */
+uint64_t HistoryStore::nextSequence() const {
+    return log.nextSequence();
+}
+
+/**
+ * @brief 读取房间最近的消息
+ *
+ * @param room 房间名
+ * @param limit 最多返回的消息数
+ * @return 按时间顺序排列的消息
+ */
+std::vector<HistoryEntry> HistoryStore::recent(const std::string& room, size_t limit) const {
+    return page(room, kLatest, limit).entries;
+}
+
+/**
+ * @brief 获取内存历史统计
+ */
+HistoryStoreStats HistoryStore::getStats() const {
+    HistoryStoreStats stats;
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.bytes = totalBytes;
+    stats.rooms = rooms.size();
+    stats.users = usernames.size();
+    for (const auto& [name, room] : rooms) {
+        stats.messages += room.entries.size();
+    }
+    stats.evicted = evicted;
+    stats.memoryHits = memoryHits;
+    stats.diskReads = diskReads;
+    stats.payloads = payloads.getStats();
+    return stats;
+}
+
+} // namespace chat
@@ -0,0 +1,333 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <set>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "../common/message.hpp"
+#include "../common/slab_allocator.hpp"
+#include "../common/symbol_table.hpp"
+#include "history_log.hpp"
+
+namespace chat {
+
+class SearchIndex;
+
+/**
+ * @brief 内存历史配置
+ */
+struct HistoryStoreOptions {
+    size_t roomBytes = 4 << 20;      ///< 每个房间的内存上限（字节）
+    size_t totalBytes = 64 << 20;    ///< 所有房间的内存上限（字节）
+    std::string snapshotPath;        ///< 快照文件路径，为空时不使用快照
+    const SearchIndex* roomIndex = nullptr;  ///< 以 roomIndexKeys 建立的房间索引，为空时从日志扫描
+};
+
+/**
+ * @brief 带日志序号的历史消息
+ */
+struct HistoryEntry {
+    uint64_t sequence;   ///< 历史日志序号
+    Message message;     ///< 消息
+};
+
+/**
+ * @brief 历史记录分页查询结果
+ */
+struct HistoryPage {
+    std::vector<HistoryEntry> entries;   ///< 本页消息，按序号从旧到新
+    uint64_t nextBefore = 0;             ///< 下一页（更早的消息）的 before 参数
+    uint64_t nextFrom = 0;               ///< 下一页（更新的消息）的 from 参数，仅 range 使用
+    size_t diskRecords = 0;              ///< 本次从磁盘扫描的记录数
+};
+
+/**
+ * @brief 内存历史统计
+ */
+struct HistoryStoreStats {
+    size_t bytes = 0;          ///< 内存中消息占用的字节数（估算）
+    size_t messages = 0;       ///< 内存中的消息数
+    size_t rooms = 0;          ///< 房间数
+    size_t users = 0;          ///< 驻留的不同用户名数
+    uint64_t evicted = 0;      ///< 因超出上限被移出内存的消息数
+    uint64_t memoryHits = 0;   ///< 完全由内存满足的查询数
+    uint64_t diskReads = 0;    ///< 需要读取磁盘的查询数
+    SlabStats payloads;        ///< 消息内容分配器的统计
+};
+
+/**
+ * @brief 启动恢复统计
+ */
+struct HistoryRecoveryStats {
+    bool fromSnapshot = false;       ///< 是否从快照恢复
+    uint64_t snapshotSequence = 0;   ///< 快照覆盖到的日志序号（不含）
+    size_t snapshotMessages = 0;     ///< 从快照载入的消息数
+    size_t replayedRecords = 0;      ///< 从日志重放的记录数
+    uint64_t truncatedBytes = 0;     ///< 打开日志时截断的损坏字节数
+    double seconds = 0;              ///< 恢复耗时（秒）
+};
+
+/**
+ * @brief 分层聊天历史：每个房间最近的消息在内存环形队列中，更早的在历史日志中
+ *
+ * 每个房间的队列按日志序号递增排列，并记录从哪个序号起队列包含该房间的全部消息；
+ * 查询先取队列中的部分，不足时再从历史日志读取：配置了房间索引且其补齐已完成时
+ * 按索引给出的序号逐条读取，耗时与所取条数成正比；否则从日志向前扫描。队列中的消息是紧凑记录：
+ * 用户名驻留在 SymbolTable 中只保存 32 位编号，房间由所在队列隐含，查询时
+ * 再还原为 Message。消息内容从 SlabPool 分配，内存用量稳定后插入和移出消息
+ * 不再调用 malloc。内存按消息实际占用的字节数计算：单个房间超过 roomBytes 时
+ * 移出该房间最旧的消息，总量超过 totalBytes 时移出所有房间中最旧的消息。
+ * 被移出的消息已经在日志中，无需另行写盘。
+ *
+ * startWarmup 在后台恢复内存状态，服务器无需等待即可接受连接：有有效快照时
+ * 载入快照并只重放快照之后的日志记录，否则读入日志末尾约 totalBytes 的记录。
+ * 预热期间的查询直接读日志，新消息暂存并在预热完成后接到队列末尾。
+ *
+ * 快照格式：magic "CHSS" | version(u8) | body | crc32c(body)(u32)，
+ * body = 覆盖序号 | 默认完整起点 | 用户名数 | 用户名 | 房间数 |
+ * 每个房间的名称、完整起点、消息数和消息，消息为
+ * 序号 | 编号 | zigzag(时间戳) | 用户名在快照中的下标 | 内容，
+ * 整数均为变长整数，字符串带长度前缀。快照先写临时文件再原子改名。
+ *
+ * 所有成员函数都是线程安全的。
+ */
+class HistoryStore {
+public:
+    /// 查询最新消息时使用的 before 参数
+    static constexpr uint64_t kLatest = std::numeric_limits<uint64_t>::max();
+
+    /**
+     * @brief 构造函数
+     * @param log 历史日志，生命周期需长于本对象
+     * @param options 内存配置
+     */
+    explicit HistoryStore(const HistoryLog& log, const HistoryStoreOptions& options = {});
+
+    /**
+     * @brief 析构函数，取消尚未完成的预热
+     */
+    ~HistoryStore();
+
+    // 禁止拷贝和赋值
+    HistoryStore(const HistoryStore&) = delete;
+    HistoryStore& operator=(const HistoryStore&) = delete;
+
+    /**
+     * @brief 启动后台预热，只能调用一次
+     *
+     * 必须在有新消息写入日志之前调用，以便区分已持久化的记录和新消息
+     */
+    void startWarmup();
+
+    /**
+     * @brief 追加一条已写入日志的消息
+     *
+     * 同一房间的消息需按序号递增追加（HistoryWriter 的写入回调满足这一点）
+     *
+     * @param sequence 日志序号
+     * @param message 消息
+     */
+    void append(uint64_t sequence, const Message& message);
+
+    /**
+     * @brief 预热是否已完成
+     */
+    bool isReady() const;
+
+    /**
+     * @brief 等待预热完成
+     * @param timeout 最长等待时间
+     * @return 预热已完成时返回true
+     */
+    bool waitUntilReady(std::chrono::milliseconds timeout) const;
+
+    /**
+     * @brief 读取房间中序号小于 before 的最近 limit 条消息
+     *
+     * 从 kLatest 开始，每次以上一页的 nextBefore 继续即可向前翻页；
+     * 返回空页表示已没有更早的消息
+     *
+     * @param room 房间名
+     * @param before 序号上界（不含）
+     * @param limit 最多返回的消息数
+     * @return 分页结果
+     */
+    HistoryPage page(const std::string& room, uint64_t before, size_t limit) const;
+
+    /**
+     * @brief 读取房间中序号在 [from, end) 内最早的 limit 条消息
+     *
+     * 与 page 方向相反，用于按时间范围向后翻页：每次以上一页的 nextFrom
+     * 继续，返回空页表示范围内已没有更多消息
+     *
+     * @param room 房间名
+     * @param from 序号下界（包含）
+     * @param end 序号上界（不含）
+     * @param limit 最多返回的消息数
+     * @return 分页结果
+     */
+    HistoryPage range(const std::string& room, uint64_t from, uint64_t end, size_t limit) const;
+
+    /**
+     * @brief 查找时间戳不早于指定时间的第一条消息的序号
+     *
+     * 在历史日志的段列表和稀疏时间索引上二分查找，再顺序扫描至多一个索引间隔，
+     * 耗时与历史总量成对数关系，与日志文件长度无关
+     *
+     * @param timestamp 时间
+     * @return 日志序号，所有消息都早于该时间时为日志末尾序号
+     */
+    uint64_t sequenceAt(time_t timestamp) const;
+
+    /**
+     * @brief 日志中最早一条记录的序号
+     */
+    uint64_t firstSequence() const;
+
+    /**
+     * @brief 日志的末尾序号，即下一条记录的序号
+     */
+    uint64_t nextSequence() const;
+
+    /**
+     * @brief 读取房间最近的消息
+     * @param room 房间名
+     * @param limit 最多返回的消息数
+     * @return 按时间顺序排列的消息
+     */
+    std::vector<HistoryEntry> recent(const std::string& room, size_t limit) const;
+
+    /**
+     * @brief 获取内存历史统计
+     */
+    HistoryStoreStats getStats() const;
+
+    /**
+     * @brief 将当前内存状态写入快照文件
+     *
+     * 只包含已写入日志的消息；调用前应先让写入器 flush，保证快照不超前于磁盘上的日志
+     *
+     * @return 写入成功时返回true；未配置快照路径或预热未完成时返回false
+     */
+    bool saveSnapshot() const;
+
+    /**
+     * @brief 获取启动恢复统计，预热完成后有效
+     */
+    HistoryRecoveryStats getRecoveryStats() const;
+
+private:
+    /**
+     * @brief 内存队列中的紧凑消息记录，房间由所在队列隐含
+     */
+    struct StoredEntry {
+        uint64_t sequence;      ///< 历史日志序号
+        uint64_t id;            ///< 消息编号
+        time_t timestamp;       ///< 时间戳
+        uint32_t user;          ///< 用户名在 usernames 中的编号
+        SlabString content;     ///< 消息内容，从 payloads 分配
+    };
+
+    /**
+     * @brief 单个房间的内存消息队列
+     */
+    struct RoomHistory {
+        std::deque<StoredEntry> entries;    ///< 按序号递增排列的消息
+        size_t bytes = 0;                   ///< 队列占用的字节数
+        uint64_t coveredFrom = 0;           ///< 队列包含该房间序号不小于此值的全部消息
+    };
+
+    /**
+     * @brief 预热线程主函数
+     */
+    void warmup(uint64_t endSequence);
+
+    /**
+     * @brief 读取并校验快照，成功时载入内存（调用方需持有锁）
+     * @param endSequence 日志当前的末尾序号，快照超前于日志时视为无效
+     * @return 载入成功时返回true
+     */
+    bool loadSnapshotLocked(const std::string& data, uint64_t endSequence);
+
+    /**
+     * @brief 将消息放入房间队列并按上限移出旧消息（调用方需持有锁）
+     */
+    void insertLocked(uint64_t sequence, const Message& message);
+
+    /**
+     * @brief 将紧凑记录放入指定房间的队列并按上限移出旧消息（调用方需持有锁）
+     */
+    void insertLocked(const std::string& roomName, StoredEntry entry);
+
+    /**
+     * @brief 移出房间最旧的一条消息（调用方需持有锁）
+     */
+    void evictFrontLocked(RoomHistory& room);
+
+    /**
+     * @brief 按房间索引给出的序号从日志批量读取消息
+     * @param sequences 房间索引给出的序号，顺序不限
+     * @param scanned 累加读取的记录数
+     */
+    std::vector<HistoryEntry> readIndexed(const std::vector<uint64_t>& sequences, size_t& scanned) const;
+
+    /**
+     * @brief 从日志读取房间中序号小于 before 的最近 limit 条消息
+     */
+    std::vector<HistoryEntry> readFromLog(const std::string& room, uint64_t before, size_t limit,
+                                          size_t& scanned) const;
+
+    /**
+     * @brief 从日志读取房间中序号在 [from, end) 内最早的 limit 条消息
+     */
+    std::vector<HistoryEntry> readRangeFromLog(const std::string& room, uint64_t from, uint64_t end, size_t limit,
+                                               size_t& scanned) const;
+
+    /**
+     * @brief 将紧凑记录还原为带序号的消息
+     */
+    HistoryEntry expand(const StoredEntry& entry, const std::string& room) const;
+
+    /**
+     * @brief 在 payloads 中复制一份消息内容（调用方需持有锁）
+     */
+    SlabString makePayload(std::string_view content);
+
+    /**
+     * @brief 估算一条消息占用的内存
+     */
+    static size_t entryBytes(const StoredEntry& entry);
+
+    const HistoryLog& log;                    ///< 历史日志
+    HistoryStoreOptions options;              ///< 内存配置
+
+    SymbolTable usernames;                    ///< 用户名驻留表（自身线程安全）
+    mutable std::mutex mutex;                 ///< 保护以下数据
+    mutable std::condition_variable readyCondition;  ///< 预热完成通知
+    SlabPool payloads;                        ///< 消息内容的分配器，需在 rooms 之前构造、之后销毁
+    std::unordered_map<std::string, RoomHistory> rooms;  ///< 各房间的消息队列
+    std::set<std::pair<uint64_t, RoomHistory*>> oldest;  ///< 各非空房间最旧消息的序号，用于全局移出
+    std::vector<HistoryEntry> live;           ///< 预热期间追加的新消息
+    uint64_t coveredFrom = 0;                 ///< 新建房间的队列从该序号起完整
+    uint64_t appliedSequence = 0;             ///< 内存状态已包含序号小于此值的全部记录
+    HistoryRecoveryStats recovery;            ///< 启动恢复统计
+    size_t totalBytes = 0;                    ///< 所有队列占用的字节数
+    bool ready = true;                        ///< 预热是否已完成（未启动预热时视为完成）
+    uint64_t evicted = 0;                     ///< 移出的消息数
+    mutable uint64_t memoryHits = 0;          ///< 完全由内存满足的查询数
+    mutable uint64_t diskReads = 0;           ///< 需要读取磁盘的查询数
+
+    std::thread worker;                       ///< 预热线程
+    std::atomic<bool> cancelled{false};       ///< 是否取消预热
+};
+
+} // namespace chat
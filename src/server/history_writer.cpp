@@ -0,0 +1,217 @@
+#include "history_writer.hpp"
+#include "../common/logger.hpp"
+
+namespace chat {
+
+namespace {
+
+/// 写入线程空闲时的最长等待时间，用于兜底检查 Interval 策略的 fsync
+constexpr std::chrono::milliseconds kIdleWait{100};
+
+} // namespace
+
+/**
+ * @brief 构造函数
+ *
+ * @param log 历史日志
+ * @param options 写入器配置
+ */
+HistoryWriter::HistoryWriter(HistoryLog& log, const HistoryWriterOptions& options)
+    : options(options), queue(options.queueCapacity), log(log), lastSync(std::chrono::steady_clock::now()) {
+    worker = std::thread([this]() { run(); });
+}
+
+/**
+ * @brief 析构函数
+ *
+ * 写完队列中剩余的消息后停止
+ */
+HistoryWriter::~HistoryWriter() {
+    stop();
+}
+
+/**
+ * @brief 将消息放入待写入队列
+ *
+ * 只在写入线程休眠时才加锁唤醒，忙碌时入队没有系统调用
+ *
+ * @param message 要保存的消息
+ * @return 队列已满时返回false
+ */
+bool HistoryWriter::enqueue(const Message& message) {
+    if (!queue.tryPush(message)) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    enqueued.fetch_add(1, std::memory_order_relaxed);
+    if (sleeping.load()) {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        wakeCondition.notify_one();
+    }
+    return true;
+}
+
+/**
+ * @brief 设置写入回调
+ *
+ * @param callback 回调函数，参数为日志序号和消息
+ */
+void HistoryWriter::setPersistedCallback(std::function<void(uint64_t sequence, const Message& message)> callback) {
+    // 写入线程只在取出消息后读取回调，入队与出队之间的同步保证其可见性
+    persistedCallback = std::move(callback);
+}
+
+/**
+ * @brief 等待此前入队的消息全部写入日志并 fsync
+ */
+void HistoryWriter::flush() {
+    std::unique_lock<std::mutex> lock(wakeMutex);
+    uint64_t ticket = ++flushRequested;
+    wakeCondition.notify_one();
+    flushCondition.wait(lock, [this, ticket]() {
+        return flushCompleted >= ticket || exited;
+    });
+}
+
+/**
+ * @brief 停止写入线程
+ *
+ * 写入线程退出前会写完队列中剩余的消息
+ */
+void HistoryWriter::stop() {
+    if (stopping.exchange(true)) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        wakeCondition.notify_one();
+    }
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+/**
+ * @brief 获取写入器统计
+ *
+ * @return 当前统计
+ */
+HistoryWriterStats HistoryWriter::getStats() const {
+    HistoryWriterStats stats;
+    stats.enqueued = enqueued.load(std::memory_order_relaxed);
+    stats.dropped = dropped.load(std::memory_order_relaxed);
+    stats.written = written.load(std::memory_order_relaxed);
+    stats.batches = batches.load(std::memory_order_relaxed);
+    stats.fsyncs = fsyncs.load(std::memory_order_relaxed);
+    stats.errors = errors.load(std::memory_order_relaxed);
+    stats.queueDepth = queue.sizeApprox();
+    return stats;
+}
+
+/**
+ * @brief 写入线程主循环
+ *
+ * 有消息时持续组提交；队列为空时处理 flush 请求和到期的 fsync，然后休眠等待唤醒
+ */
+void HistoryWriter::run() {
+    for (;;) {
+        if (writeBatch() > 0) {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        if (flushCompleted < flushRequested) {
+            uint64_t ticket = flushRequested;
+            lock.unlock();
+            // 取得票号后再排空一次，保证 flush 之前入队的消息都已写入
+            while (writeBatch() > 0) {
+            }
+            sync();
+            lock.lock();
+            flushCompleted = ticket;
+            flushCondition.notify_all();
+            continue;
+        }
+        if (stopping.load()) {
+            break;
+        }
+        if (dirty && options.fsyncPolicy == FsyncPolicy::Interval &&
+            std::chrono::steady_clock::now() - lastSync >= options.fsyncInterval) {
+            lock.unlock();
+            sync();
+            continue;
+        }
+
+        sleeping.store(true);
+        wakeCondition.wait_for(lock, kIdleWait, [this]() {
+            return stopping.load() || flushCompleted < flushRequested || queue.sizeApprox() > 0;
+        });
+        sleeping.store(false);
+    }
+
+    // 写完剩余消息后退出
+    while (writeBatch() > 0) {
+    }
+    if (options.fsyncPolicy != FsyncPolicy::Never) {
+        sync();
+    }
+    std::lock_guard<std::mutex> lock(wakeMutex);
+    exited = true;
+    flushCondition.notify_all();
+}
+
+/**
+ * @brief 取出一批消息并以一次 write 写入日志
+ *
+ * @return 本批写入的消息数
+ */
+size_t HistoryWriter::writeBatch() {
+    Message message("", "");
+    size_t count = 0;
+    batch.clear();
+    while (count < options.maxBatch && queue.tryPop(message)) {
+        uint64_t sequence = log.append(message);
+        if (persistedCallback) {
+            batch.emplace_back(sequence, std::move(message));
+        }
+        ++count;
+    }
+    if (count == 0) {
+        return 0;
+    }
+
+    if (log.flush()) {
+        written.fetch_add(count, std::memory_order_relaxed);
+        dirty = true;
+        for (const auto& [sequence, persisted] : batch) {
+            persistedCallback(sequence, persisted);
+        }
+    } else {
+        errors.fetch_add(1, std::memory_order_relaxed);
+    }
+    batches.fetch_add(1, std::memory_order_relaxed);
+
+    if (options.fsyncPolicy == FsyncPolicy::EveryBatch ||
+        (options.fsyncPolicy == FsyncPolicy::Interval &&
+         std::chrono::steady_clock::now() - lastSync >= options.fsyncInterval)) {
+        sync();
+    }
+    return count;
+}
+
+/**
+ * @brief 对日志执行 fsync
+ */
+void HistoryWriter::sync() {
+    lastSync = std::chrono::steady_clock::now();
+    if (!dirty) {
+        return;
+    }
+    if (!log.sync()) {
+        errors.fetch_add(1, std::memory_order_relaxed);
+    }
+    fsyncs.fetch_add(1, std::memory_order_relaxed);
+    dirty = false;
+}
+
+} // namespace chat
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "../common/message.hpp"
+#include "../common/mpsc_queue.hpp"
+#include "history_log.hpp"
+
+namespace chat {
+
+/**
+ * @brief 历史记录落盘策略
+ */
+enum class FsyncPolicy {
+    Never,      ///< 只写入页缓存，由操作系统决定何时落盘
+    Interval,   ///< 距上次 fsync 超过 fsyncInterval 后在批次写入后 fsync
+    EveryBatch  ///< 每个批次写入后立即 fsync
+};
+
+/**
+ * @brief 历史记录写入器配置
+ */
+struct HistoryWriterOptions {
+    size_t queueCapacity = 65536;                      ///< 待写入队列容量
+    size_t maxBatch = 1024;                            ///< 每次组提交的最大消息数
+    FsyncPolicy fsyncPolicy = FsyncPolicy::Interval;   ///< 落盘策略
+    std::chrono::milliseconds fsyncInterval{1000};     ///< Interval 策略的 fsync 间隔
+};
+
+/**
+ * @brief 历史记录写入器统计
+ */
+struct HistoryWriterStats {
+    uint64_t enqueued = 0;   ///< 成功入队的消息数
+    uint64_t dropped = 0;    ///< 队列已满而丢弃的消息数
+    uint64_t written = 0;    ///< 已写入日志的消息数
+    uint64_t batches = 0;    ///< 组提交次数
+    uint64_t fsyncs = 0;     ///< fsync 次数
+    uint64_t errors = 0;     ///< 写入失败次数
+    size_t queueDepth = 0;   ///< 当前队列中的消息数（近似值）
+};
+
+/**
+ * @brief 异步历史记录写入器
+ *
+ * I/O 线程调用 enqueue 只把消息放入有界无锁队列；独立的写入线程批量取出
+ * 消息追加到 HistoryLog 的写缓冲区后一次写出（组提交），再按 FsyncPolicy
+ * 决定是否 fsync。写入器运行期间由它独占 HistoryLog 的写入端。
+ */
+class HistoryWriter {
+public:
+    /**
+     * @brief 构造函数，启动写入线程
+     * @param log 历史日志，生命周期需长于写入器
+     * @param options 写入器配置
+     */
+    explicit HistoryWriter(HistoryLog& log, const HistoryWriterOptions& options = {});
+
+    /**
+     * @brief 析构函数，写完队列中剩余的消息后停止
+     */
+    ~HistoryWriter();
+
+    // 禁止拷贝和赋值
+    HistoryWriter(const HistoryWriter&) = delete;
+    HistoryWriter& operator=(const HistoryWriter&) = delete;
+
+    /**
+     * @brief 将消息放入待写入队列，不阻塞
+     * @param message 要保存的消息
+     * @return 队列已满时返回false，消息被丢弃
+     */
+    bool enqueue(const Message& message);
+
+    /**
+     * @brief 设置写入回调，每条消息写入日志后在写入线程中调用
+     *
+     * 需在第一次 enqueue 之前设置
+     *
+     * @param callback 回调函数，参数为日志序号和消息
+     */
+    void setPersistedCallback(std::function<void(uint64_t sequence, const Message& message)> callback);
+
+    /**
+     * @brief 等待此前入队的消息全部写入日志并 fsync
+     */
+    void flush();
+
+    /**
+     * @brief 写完队列中剩余的消息并停止写入线程
+     */
+    void stop();
+
+    /**
+     * @brief 获取写入器统计
+     * @return 当前统计
+     */
+    HistoryWriterStats getStats() const;
+
+private:
+    /**
+     * @brief 写入线程主循环
+     */
+    void run();
+
+    /**
+     * @brief 取出一批消息并写入日志
+     * @return 本批写入的消息数
+     */
+    size_t writeBatch();
+
+    /**
+     * @brief 对日志执行 fsync
+     */
+    void sync();
+
+    HistoryWriterOptions options;               ///< 写入器配置
+    MpscQueue<Message> queue;                   ///< 待写入消息队列
+    HistoryLog& log;                            ///< 历史日志
+    std::function<void(uint64_t, const Message&)> persistedCallback;  ///< 写入回调
+    std::vector<std::pair<uint64_t, Message>> batch;  ///< 当前批次（仅写入线程使用）
+    std::chrono::steady_clock::time_point lastSync;  ///< 上次 fsync 的时刻
+    bool dirty = false;                         ///< 是否有尚未 fsync 的写入（仅写入线程使用）
+
+    std::thread worker;                         ///< 写入线程
+    std::mutex wakeMutex;                       ///< 配合条件变量使用
+    std::condition_variable wakeCondition;      ///< 唤醒写入线程
+    std::condition_variable flushCondition;     ///< 通知 flush 调用方
+    std::atomic<bool> sleeping{false};          ///< 写入线程是否在等待新消息
+    std::atomic<bool> stopping{false};          ///< 是否正在停止
+    // 以下三项受 wakeMutex 保护
+    uint64_t flushRequested = 0;                ///< 已发出的 flush 请求票号
+    uint64_t flushCompleted = 0;                ///< 已完成的 flush 请求票号
+    bool exited = false;                        ///< 写入线程是否已退出
+
+    std::atomic<uint64_t> enqueued{0};          ///< 成功入队的消息数
+    std::atomic<uint64_t> dropped{0};           ///< 丢弃的消息数
+    std::atomic<uint64_t> written{0};           ///< 已写入的消息数
+    std::atomic<uint64_t> batches{0};           ///< 组提交次数
+    std::atomic<uint64_t> fsyncs{0};            ///< fsync 次数
+    std::atomic<uint64_t> errors{0};            ///< 写入失败次数
+};
+
+} // namespace chat
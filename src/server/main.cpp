@@ -1,7 +1,15 @@
 #include "websocket_server.hpp"
+#include "history_loader.hpp"
+#include "history_log.hpp"
+#include "history_query.hpp"
+#include "history_store.hpp"
+#include "history_writer.hpp"
+#include "search_index.hpp"
 #include "../common/logger.hpp"
+#include "../common/binary_log.hpp"
+#include "../common/log_throttle.hpp"
+#include <algorithm>
 #include <iostream>
-#include <fstream>
 #include <vector>
 #include <string>
 
@@ -10,37 +18,68 @@ using namespace chat;
 /**
  * @brief 从文件加载聊天历史记录
  * 
+ * 以 mmap 分块并行解析，完成后记录吞吐量和无法解析的行数
+ * 
  * @param filename 历史记录文件名
  * @param history 用于存储加载的历史记录的向量
  */
 void loadHistory(const std::string& filename, std::vector<Message>& history) {
-    std::ifstream file(filename);
-    if (!file.is_open()) return;
-    
-    std::string line;
-    while (std::getline(file, line)) {
-        try {
-            history.push_back(Message::fromString(line));
-        } catch (const std::exception& e) {
-            Logger::getInstance().log("Error loading history: " + std::string(e.what()));
-        }
+    HistoryLoadStats stats = loadHistoryFile(filename, history);
+    if (stats.bytes == 0) {
+        return;
+    }
+    CHAT_LOG_INFO("Loaded " + std::to_string(history.size()) + " messages from " + filename +
+                  " in " + std::to_string(stats.seconds) + "s (" +
+                  std::to_string(static_cast<uint64_t>(stats.linesPerSecond())) + " lines/s, " +
+                  std::to_string(stats.threads) + " threads)");
+    if (stats.badRecords > 0) {
+        CHAT_LOG_ERROR("Error loading history: " + std::to_string(stats.badRecords) +
+                       " invalid records, first at line " + std::to_string(stats.firstBadLine));
     }
 }
 
 /**
- * @brief 保存消息到历史记录文件
- * 
- * @param filename 历史记录文件名
- * @param message 要保存的消息
+ * @brief 读取历史日志末尾消息中的最大编号
+ *
+ * 多个 I/O 线程分配编号后入队的顺序不一定与编号一致，因此取末尾一批记录中的最大值
+ *
+ * @param log 历史日志
+ * @return 最大的消息编号，日志为空时为 0
  */
-void saveHistory(const std::string& filename, const Message& message) {
-    std::ofstream file(filename, std::ios::app);
-    if (!file.is_open()) {
-        Logger::getInstance().log("Error saving history: Cannot open file");
+uint64_t lastMessageId(const HistoryLog& log) {
+    constexpr uint64_t kTailRecords = 4096;
+    uint64_t first = log.firstSequence();
+    uint64_t end = log.nextSequence();
+    uint64_t maxId = 0;
+    log.read(end - first > kTailRecords ? end - kTailRecords : first, [&maxId](uint64_t, const Message& message) {
+        maxId = std::max(maxId, message.id);
+        return true;
+    });
+    return maxId;
+}
+
+/**
+ * @brief 将旧版文本历史记录导入历史日志
+ *
+ * 只在历史日志为空时执行一次，导入后旧文件保留不动
+ *
+ * @param filename 旧版历史记录文件名
+ * @param log 历史日志
+ */
+void importLegacyHistory(const std::string& filename, HistoryLog& log) {
+    if (log.nextSequence() != log.firstSequence()) {
         return;
     }
-    
-    file << message.toString() << std::endl;
+    std::vector<Message> legacy;
+    loadHistory(filename, legacy);
+    if (legacy.empty()) {
+        return;
+    }
+    for (const Message& message : legacy) {
+        log.append(message);
+    }
+    log.sync();
+    CHAT_LOG_INFO("Imported " + std::to_string(legacy.size()) + " messages from " + filename);
 }
 
 /**
@@ -49,8 +88,8 @@ void saveHistory(const std::string& filename, const Message& message) {
  * 程序入口点，负责：
  * 1. 解析命令行参数
  * 2. 初始化日志系统
- * 3. 加载历史记录
- * 4. 创建和启动聊天服务器
+ * 3. 打开历史日志并在后台预热历史记录
+ * 4. 创建和启动聊天服务器（不等待历史加载完成）
  * 5. 处理服务器生命周期
  */
 int main(int argc, char* argv[]) {
@@ -59,22 +98,97 @@ int main(int argc, char* argv[]) {
     if (argc > 1) {
         port = static_cast<uint16_t>(std::stoi(argv[1]));
     }
+    // I/O 线程数，默认使用硬件并发数
+    size_t ioThreads = 0;
+    if (argc > 2) {
+        ioThreads = static_cast<size_t>(std::stoul(argv[2]));
+    }
+    // 监听分片数，大于 1 时以 SO_REUSEPORT 开启多个监听套接字
+    size_t listenerShards = 1;
+    if (argc > 3) {
+        listenerShards = static_cast<size_t>(std::stoul(argv[3]));
+    }
     
-    // 初始化日志系统
+    // 初始化日志系统：I/O 线程只把日志放入队列，由后台线程批量写入；
+    // 每天零点或超过 64 MiB 时轮转，保留最近 14 个压缩后的文件
     Logger::getInstance().setLogFile("chat_server.log");
-    Logger::getInstance().log("Server starting...");
+    LoggerOptions logOptions;
+    logOptions.mode = LogMode::Async;
+    logOptions.rotateBytes = 64 << 20;
+    logOptions.rotateInterval = std::chrono::hours(24);
+    logOptions.keepFiles = 14;
+    logOptions.compressRotated = true;
+    Logger::getInstance().configure(logOptions);
+    // 消息和广播路径的日志以二进制格式记录，用 log_decode 解码
+    BinaryLogger::getInstance().open("chat_server.blog");
+    // 过载时逐连接、逐消息出现的错误按调用点限速，被抑制的记录由主循环定期汇总
+    LogThrottle::setLimit("broadcast", LogRateLimit{1.0, 10});
+    LogThrottle::setLimit("message", LogRateLimit{5.0, 20});
+    LogThrottle::setLimit("backpressure", LogRateLimit{1.0, 10});
+    LogThrottle::setLimit("history", LogRateLimit{1.0, 5});
+    LogThrottle::setLimit("query", LogRateLimit{1.0, 10});
+    CHAT_LOG_INFO("Server starting...");
+    
+    // 打开分段历史日志，首次运行时导入旧版文本历史
+    HistoryLog historyLog("history");
+    importLegacyHistory("chat_history.txt", historyLog);
+    
+    // 房间索引以房间名为键，内存之外的历史按索引给出的序号读取，不必扫描日志
+    SearchIndexOptions roomIndexOptions;
+    roomIndexOptions.keys = roomIndexKeys;
+    SearchIndex roomIndex("history/rooms", historyLog, roomIndexOptions);
+    roomIndex.startCatchUp();
+    
+    // 内存中只保留各房间最近的消息（按字节数限额），更早的从历史日志读取；
+    // 预热在后台进行（载入快照并重放其后的日志），服务器不必等待加载完成
+    HistoryStoreOptions historyOptions;
+    historyOptions.snapshotPath = "history/snapshot.bin";
+    historyOptions.roomIndex = &roomIndex;
+    HistoryStore history(historyLog, historyOptions);
+    history.startWarmup();
+    
+    // 全文索引存放在日志目录下，后台从日志补齐上次写段之后的消息
+    SearchIndex searchIndex("history/search", historyLog);
+    searchIndex.startCatchUp();
     
-    // 加载历史记录
-    std::vector<Message> history;
-    loadHistory("chat_history.txt", history);
+    // 用户索引与全文索引共用段格式，以用户名为键，供按用户查询和审核使用
+    SearchIndexOptions userIndexOptions;
+    userIndexOptions.keys = userIndexKeys;
+    SearchIndex userIndex("history/users", historyLog, userIndexOptions);
+    userIndex.startCatchUp();
     
-    // 创建聊天服务器
-    ChatServer server(port);
+    // 历史记录由独立线程组提交写入，I/O 线程只负责入队；写入日志后再放入内存历史并建立索引。
+    // 两个索引的 add 都只修改内存倒排表，写段与合并在各自的后台线程中进行，不会拖慢组提交
+    HistoryWriter historyWriter(historyLog);
+    // 房间索引先于内存历史更新，预热期间从日志读取的查询不会漏掉刚写入的消息
+    historyWriter.setPersistedCallback([&history, &roomIndex, &searchIndex, &userIndex](uint64_t sequence,
+                                                                                        const Message& msg) {
+        roomIndex.add(sequence, msg);
+        history.append(sequence, msg);
+        searchIndex.add(sequence, msg);
+        userIndex.add(sequence, msg);
+    });
+    
+    // 创建聊天服务器，消息编号接着已持久化的历史继续
+    ChatServer server(port, ioThreads, listenerShards);
+    server.setNextMessageId(lastMessageId(historyLog) + 1);
     
-    // 设置消息处理回调
-    server.setMessageCallback([&history](const Message& msg) {
-        saveHistory("chat_history.txt", msg);
-        history.push_back(msg);
+    // 设置消息处理回调，多个 I/O 线程可能并发调用
+    server.setMessageCallback([&historyWriter](const Message& msg) {
+        if (!historyWriter.enqueue(msg)) {
+            CHAT_LOG_THROTTLED(LogLevel::Error, "history", "Error saving history: queue full, message dropped");
+        }
+    });
+    
+    // 历史查询：时间经日志的时间索引换算为序号，再从内存或日志分页读取
+    server.setHistoryHandler([&history](const HistoryQuery& query) {
+        return executeHistoryQuery(history, query);
+    });
+    server.setSearchHandler([&searchIndex, &historyLog](const SearchQuery& query) {
+        return executeSearchQuery(searchIndex, historyLog, query);
+    });
+    server.setUserHandler([&userIndex, &historyLog](const UserQuery& query) {
+        return executeUserQuery(userIndex, historyLog, query);
     });
     
     // 启动服务器
@@ -84,13 +198,29 @@ int main(int argc, char* argv[]) {
     std::cout << "Chat server running on port " << port << std::endl;
     std::cout << "Press Ctrl+C to stop" << std::endl;
     
-    // 主循环
+    // 主循环，每秒汇总被限速的日志；定期保存内存历史快照并写出各索引，以缩短下次启动的日志重放
+    constexpr auto kSnapshotInterval = std::chrono::minutes(5);
+    auto lastSnapshot = std::chrono::steady_clock::now();
+    uint64_t snapshotSequence = historyLog.nextSequence();
     try {
         while (true) {
             std::this_thread::sleep_for(std::chrono::seconds(1));
+            LogThrottle::reportSuppressed();
+            if (std::chrono::steady_clock::now() - lastSnapshot < kSnapshotInterval ||
+                historyLog.nextSequence() == snapshotSequence || !history.isReady()) {
+                continue;
+            }
+            // 先让日志落盘，快照不应超前于磁盘上的日志
+            historyWriter.flush();
+            snapshotSequence = historyLog.nextSequence();
+            lastSnapshot = std::chrono::steady_clock::now();
+            history.saveSnapshot();
+            roomIndex.flush();
+            searchIndex.flush();
+            userIndex.flush();
         }
     } catch (const std::exception& e) {
-        Logger::getInstance().log("Server error: " + std::string(e.what()));
+        CHAT_LOG_ERROR("Server error: " + std::string(e.what()));
     }
     
     // 停止服务器
@@ -0,0 +1,1188 @@
+#include "search_index.hpp"
+#include "../common/crc32c.hpp"
+#include "../common/file_util.hpp"
+#include "../common/logger.hpp"
+#include "../common/wire_format.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace chat {
+
+namespace {
+
+/// 段文件头
+constexpr char kSegmentMagic[4] = {'C', 'H', 'S', 'I'};
+
+/// 段格式版本
+constexpr uint8_t kSegmentVersion = 1;
+
+/// 段文件头大小
+constexpr size_t kHeaderSize = 32;
+
+/// 补齐线程每读入这么多条记录合并一次，减少锁竞争
+constexpr size_t kCatchUpBatch = 4096;
+
+/// 内存倒排表中每个词的固定开销（键、哈希表节点）的估算
+constexpr size_t kMemoryTermOverhead = 64;
+
+/**
+ * @brief 解码一个 UTF-8 字符
+ *
+ * @param text 以该字符开头的文本（非空）
+ * @param codePoint 字符的码位
+ * @return 字节序列合法时返回字符的字节数，否则返回 0
+ */
+size_t decodeUtf8(std::string_view text, uint32_t& codePoint) {
+    uint8_t lead = static_cast<uint8_t>(text[0]);
+    size_t length;
+    if (lead < 0x80) {
+        codePoint = lead;
+        return 1;
+    } else if (lead >= 0xC2 && lead < 0xE0) {
+        length = 2;
+        codePoint = lead & 0x1F;
+    } else if (lead >= 0xE0 && lead < 0xF0) {
+        length = 3;
+        codePoint = lead & 0x0F;
+    } else if (lead >= 0xF0 && lead < 0xF5) {
+        length = 4;
+        codePoint = lead & 0x07;
+    } else {
+        return 0;
+    }
+    if (text.size() < length) {
+        return 0;
+    }
+    for (size_t i = 1; i < length; ++i) {
+        uint8_t byte = static_cast<uint8_t>(text[i]);
+        if ((byte & 0xC0) != 0x80) {
+            return 0;
+        }
+        codePoint = (codePoint << 6) | (byte & 0x3F);
+    }
+    // 拒绝超长编码和代理项
+    static constexpr uint32_t kMinCodePoint[5] = {0, 0, 0x80, 0x800, 0x10000};
+    if (codePoint < kMinCodePoint[length] || (codePoint >= 0xD800 && codePoint < 0xE000)) {
+        return 0;
+    }
+    return length;
+}
+
+/**
+ * @brief 是否为每个字符单独成词的文字（汉字和假名）
+ */
+bool isIdeographic(uint32_t c) {
+    return (c >= 0x3040 && c <= 0x30FF) ||     // 平假名、片假名
+           (c >= 0x3400 && c <= 0x4DBF) ||     // CJK 扩展 A
+           (c >= 0x4E00 && c <= 0x9FFF) ||     // CJK 统一汉字
+           (c >= 0xF900 && c <= 0xFAFF) ||     // CJK 兼容汉字
+           (c >= 0x20000 && c <= 0x3FFFF);     // CJK 扩展 B 及以后
+}
+
+/**
+ * @brief 是否为分隔符性质的非 ASCII 字符（空白和常用标点）
+ */
+bool isSeparator(uint32_t c) {
+    return c == 0x00A0 ||                      // 不换行空格
+           (c >= 0x2000 && c <= 0x206F) ||     // 通用标点
+           (c >= 0x3000 && c <= 0x303F) ||     // CJK 符号和标点
+           (c >= 0xFE30 && c <= 0xFE4F) ||     // CJK 兼容形式
+           (c >= 0xFF01 && c <= 0xFF0F) ||     // 全角标点
+           (c >= 0xFF1A && c <= 0xFF20) || (c >= 0xFF3B && c <= 0xFF40) || (c >= 0xFF5B && c <= 0xFF65);
+}
+
+/**
+ * @brief 倒排表中的一条消息
+ */
+struct PostingDocument {
+    uint64_t sequence;             ///< 消息序号
+    uint32_t positionCount;        ///< 位置数
+    std::string_view positions;    ///< 位置差的编码
+};
+
+/**
+ * @brief 解码倒排表中的消息序号，位置只记录编码范围
+ * @return 编码完整时返回true
+ */
+bool decodePostings(std::string_view data, std::vector<PostingDocument>& documents) {
+    uint64_t sequence = 0;
+    while (!data.empty()) {
+        uint64_t delta, count;
+        if (!readVarint(data, delta) || !readVarint(data, count) || count > data.size()) {
+            return false;
+        }
+        sequence += delta;
+        const char* start = data.data();
+        for (uint64_t i = 0; i < count; ++i) {
+            uint64_t ignored;
+            if (!readVarint(data, ignored)) {
+                return false;
+            }
+        }
+        documents.push_back({sequence, static_cast<uint32_t>(count),
+                             std::string_view(start, static_cast<size_t>(data.data() - start))});
+    }
+    return true;
+}
+
+/**
+ * @brief 解码一条消息中词的位置
+ */
+std::vector<uint32_t> decodePositions(const PostingDocument& document) {
+    std::vector<uint32_t> positions;
+    positions.reserve(document.positionCount);
+    std::string_view data = document.positions;
+    uint64_t position = 0, delta;
+    while (readVarint(data, delta)) {
+        position += delta;
+        positions.push_back(static_cast<uint32_t>(position));
+    }
+    return positions;
+}
+
+/**
+ * @brief 倒排表中最后一条消息的序号
+ */
+uint64_t lastSequenceOf(std::string_view data) {
+    std::vector<PostingDocument> documents;
+    decodePostings(data, documents);
+    return documents.empty() ? 0 : documents.back().sequence;
+}
+
+/**
+ * @brief 把较新的倒排表接在较旧的倒排表之后
+ *
+ * 较新倒排表第一条消息的序号差从 0 起算，需改为相对 last 的差，其余字节原样复制
+ *
+ * @param out 输出的倒排表
+ * @param last 输出中最后一条消息的序号
+ * @param data 较新的倒排表
+ */
+void appendPostings(std::string& out, uint64_t last, std::string_view data) {
+    uint64_t first;
+    if (!readVarint(data, first)) {
+        return;
+    }
+    appendVarint(out, first - last);
+    out.append(data.data(), data.size());
+}
+
+/**
+ * @brief 段中的一个词条
+ */
+struct TermRecord {
+    std::string_view key;        ///< 键
+    uint64_t documents = 0;      ///< 消息数
+    std::string_view postings;   ///< 倒排表
+};
+
+/**
+ * @brief 编码段文件
+ *
+ * @param fromSequence 段覆盖的首个序号
+ * @param endSequence 段覆盖的序号上界（不含）
+ * @param records 按键排序的词条
+ * @param postings 各词条的倒排表（合并时使用），为空时使用 records 中的倒排表
+ * @return 段文件内容
+ */
+std::string encodeSegment(uint64_t fromSequence, uint64_t endSequence, const std::vector<TermRecord>& records,
+                          const std::vector<std::string>& postings) {
+    std::string data(kSegmentMagic, sizeof(kSegmentMagic));
+    data.push_back(static_cast<char>(kSegmentVersion));
+    data.append(3, '\0');
+    appendFixed64(data, fromSequence);
+    appendFixed64(data, endSequence);
+    appendFixed32(data, static_cast<uint32_t>(records.size()));
+    appendFixed32(data, 0);  // 校验和，最后填入
+
+    size_t tableOffset = data.size();
+    data.append(records.size() * 8, '\0');
+    for (size_t i = 0; i < records.size(); ++i) {
+        uint64_t offset = data.size();
+        for (int b = 0; b < 8; ++b) {
+            data[tableOffset + i * 8 + b] = static_cast<char>(offset >> (8 * b));
+        }
+        std::string_view body = postings.empty() ? records[i].postings : std::string_view(postings[i]);
+        appendVarint(data, records[i].key.size());
+        data.append(records[i].key);
+        appendVarint(data, records[i].documents);
+        appendVarint(data, body.size());
+        data.append(body);
+    }
+    uint32_t crc = crc32c(data.data() + kHeaderSize, data.size() - kHeaderSize);
+    for (int b = 0; b < 4; ++b) {
+        data[kHeaderSize - 4 + b] = static_cast<char>(crc >> (8 * b));
+    }
+    return data;
+}
+
+/**
+ * @brief 消息所属的房间，旧记录没有房间时归入默认房间
+ */
+const std::string& roomOf(const Message& message) {
+    static const std::string defaultRoom = kDefaultRoom;
+    return message.room.empty() ? defaultRoom : message.room;
+}
+
+/**
+ * @brief 倒排索引的键
+ */
+std::string termKey(const std::string& room, std::string_view term) {
+    std::string key;
+    key.reserve(room.size() + 1 + term.size());
+    key.append(room);
+    key.push_back('\0');
+    key.append(term);
+    return key;
+}
+
+} // namespace
+
+/**
+ * @brief 将文本切分为检索词
+ *
+ * @param text 文本
+ * @return 按出现顺序排列的检索词
+ */
+std::vector<std::string> tokenizeText(std::string_view text) {
+    std::vector<std::string> tokens;
+    std::string word;
+    auto finishWord = [&tokens, &word]() {
+        if (!word.empty() && word.size() <= kMaxTokenBytes) {
+            tokens.push_back(word);
+        }
+        word.clear();
+    };
+
+    while (!text.empty()) {
+        uint32_t c;
+        size_t length = decodeUtf8(text, c);
+        if (length == 0) {
+            finishWord();
+            text.remove_prefix(1);
+            continue;
+        }
+        if (c < 0x80) {
+            if ((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z')) {
+                word.push_back(static_cast<char>(c));
+            } else if (c >= 'A' && c <= 'Z') {
+                word.push_back(static_cast<char>(c - 'A' + 'a'));
+            } else {
+                finishWord();
+            }
+        } else if (isIdeographic(c)) {
+            finishWord();
+            tokens.emplace_back(text.substr(0, length));
+        } else if (isSeparator(c)) {
+            finishWord();
+        } else {
+            word.append(text.data(), length);
+        }
+        text.remove_prefix(length);
+    }
+    finishWord();
+    return tokens;
+}
+
+/**
+ * @brief 全文检索的索引键
+ *
+ * @param message 消息
+ * @param keys 追加 (房间\0检索词, 词的下标)
+ */
+void textIndexKeys(const Message& message, std::vector<std::pair<std::string, uint32_t>>& keys) {
+    const std::string& room = roomOf(message);
+    std::vector<std::string> tokens = tokenizeText(message.content);
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        keys.emplace_back(termKey(room, tokens[i]), static_cast<uint32_t>(i));
+    }
+}
+
+/**
+ * @brief 按用户查询的索引键
+ *
+ * @param message 消息
+ * @param keys 追加用户名和房间加用户名两个键
+ */
+void userIndexKeys(const Message& message, std::vector<std::pair<std::string, uint32_t>>& keys) {
+    keys.emplace_back(userIndexKey({}, message.username), 0);
+    keys.emplace_back(userIndexKey(roomOf(message), message.username), 0);
+}
+
+/**
+ * @brief 按房间分页的索引键
+ *
+ * @param message 消息
+ * @param keys 追加房间名
+ */
+void roomIndexKeys(const Message& message, std::vector<std::pair<std::string, uint32_t>>& keys) {
+    keys.emplace_back(roomOf(message), 0);
+}
+
+/**
+ * @brief 房间内某个用户的索引键
+ *
+ * @param room 房间名，为空时返回跨房间的键
+ * @param username 用户名
+ * @return 跨房间时为 "\0用户名"，否则为 "房间\0用户名"
+ */
+std::string userIndexKey(const std::string& room, const std::string& username) {
+    return termKey(room, username);
+}
+
+/**
+ * @brief 只读映射的磁盘段
+ *
+ * 查询方持有引用后，即使段被合并或删除也能安全读完
+ */
+class SearchIndex::Segment {
+public:
+    /**
+     * @brief 映射并校验段文件
+     * @return 文件损坏或无法映射时返回空指针
+     */
+    static std::shared_ptr<const Segment> open(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return nullptr;
+        }
+        struct stat st;
+        void* map = MAP_FAILED;
+        if (::fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= kHeaderSize) {
+            map = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        }
+        ::close(fd);
+        if (map == MAP_FAILED) {
+            return nullptr;
+        }
+        auto segment = std::shared_ptr<Segment>(new Segment(path, map, static_cast<size_t>(st.st_size)));
+        if (!segment->validate()) {
+            return nullptr;
+        }
+        return segment;
+    }
+
+    ~Segment() { ::munmap(const_cast<char*>(data.data()), data.size()); }
+
+    Segment(const Segment&) = delete;
+    Segment& operator=(const Segment&) = delete;
+
+    /**
+     * @brief 在键表上二分查找词条
+     * @return 找到时返回true
+     */
+    bool find(std::string_view key, TermRecord& record) const {
+        size_t low = 0, high = termCount;
+        while (low < high) {
+            size_t middle = low + (high - low) / 2;
+            TermRecord candidate;
+            if (!recordAt(middle, candidate)) {
+                return false;
+            }
+            int order = candidate.key.compare(key);
+            if (order == 0) {
+                record = candidate;
+                return true;
+            }
+            if (order < 0) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief 读取第 i 个词条
+     * @return 词条完整时返回true
+     */
+    bool recordAt(size_t i, TermRecord& record) const {
+        uint64_t offset = loadFixed64(data.data() + kHeaderSize + i * 8);
+        if (offset >= data.size()) {
+            return false;
+        }
+        std::string_view in = data.substr(static_cast<size_t>(offset));
+        uint64_t keyLength, postingsLength;
+        if (!readVarint(in, keyLength) || keyLength > in.size()) {
+            return false;
+        }
+        record.key = in.substr(0, keyLength);
+        in.remove_prefix(keyLength);
+        if (!readVarint(in, record.documents) || !readVarint(in, postingsLength) || postingsLength > in.size()) {
+            return false;
+        }
+        record.postings = in.substr(0, postingsLength);
+        return true;
+    }
+
+    std::string path;               ///< 文件路径
+    std::string_view data;          ///< 映射的文件内容
+    uint64_t fromSequence = 0;      ///< 段覆盖的首个序号
+    uint64_t endSequence = 0;       ///< 段覆盖的序号上界（不含）
+    size_t termCount = 0;           ///< 词条数
+
+private:
+    Segment(const std::string& path, void* map, size_t size)
+        : path(path), data(static_cast<const char*>(map), size) {}
+
+    /**
+     * @brief 校验文件头、键表范围和校验和
+     */
+    bool validate() {
+        const char* p = data.data();
+        if (std::memcmp(p, kSegmentMagic, sizeof(kSegmentMagic)) != 0 ||
+            static_cast<uint8_t>(p[sizeof(kSegmentMagic)]) != kSegmentVersion) {
+            return false;
+        }
+        fromSequence = loadFixed64(p + 8);
+        endSequence = loadFixed64(p + 16);
+        termCount = loadFixed32(p + 24);
+        return fromSequence <= endSequence && termCount <= (data.size() - kHeaderSize) / 8 &&
+               crc32c(p + kHeaderSize, data.size() - kHeaderSize) == loadFixed32(p + 28);
+    }
+};
+
+/**
+ * @brief 构造函数
+ *
+ * 载入目录中的段，只保留从最早一段起首尾相接且不超前于日志的部分，
+ * 其余的段删除后由补齐重建
+ *
+ * @param directory 索引目录
+ * @param log 历史日志
+ * @param options 索引配置
+ */
+SearchIndex::SearchIndex(const std::string& directory, const HistoryLog& log, const SearchIndexOptions& options)
+    : directory(directory), log(log), options(options) {
+    if (!this->options.keys) {
+        this->options.keys = textIndexKeys;
+    }
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+    if (ec) {
+        throw std::runtime_error("Cannot create search index directory " + directory + ": " + ec.message());
+    }
+
+    std::vector<std::shared_ptr<const Segment>> found;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, ec)) {
+        const std::filesystem::path& path = entry.path();
+        if (path.extension() != ".sidx") {
+            continue;
+        }
+        std::shared_ptr<const Segment> segment = Segment::open(path.string());
+        if (!segment) {
+            CHAT_LOG_WARN("Search index: removing corrupt segment " + path.string());
+            std::filesystem::remove(path, ec);
+            continue;
+        }
+        found.push_back(std::move(segment));
+    }
+    std::sort(found.begin(), found.end(), [](const auto& a, const auto& b) {
+        return a->fromSequence != b->fromSequence ? a->fromSequence < b->fromSequence
+                                                  : a->endSequence > b->endSequence;
+    });
+
+    uint64_t logEnd = log.nextSequence();
+    bool broken = false;
+    for (auto& segment : found) {
+        bool contained = !segments.empty() && segment->endSequence <= segments.back()->endSequence;
+        bool contiguous = segments.empty() || segment->fromSequence == segments.back()->endSequence;
+        broken = broken || segment->endSequence > logEnd || (!contained && !contiguous);
+        if (broken || contained) {
+            std::filesystem::remove(segment->path, ec);
+            continue;
+        }
+        segments.push_back(std::move(segment));
+    }
+    indexedSequence = segments.empty() ? log.firstSequence() : segments.back()->endSequence;
+    memoryFrom = indexedSequence;
+    flusher = std::thread([this]() { runFlusher(); });
+}
+
+/**
+ * @brief 析构函数
+ *
+ * 通知补齐线程尽快退出并等待其结束，再停止后台写段线程。
+ * 未写出的内存倒排表和冻结表被丢弃，下次打开时从日志补齐
+ */
+SearchIndex::~SearchIndex() {
+    cancelled.store(true);
+    if (worker.joinable()) {
+        worker.join();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    flushCondition.notify_all();
+    if (flusher.joinable()) {
+        flusher.join();
+    }
+}
+
+/**
+ * @brief 段文件路径
+ */
+std::string SearchIndex::segmentPath(uint64_t fromSequence) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%020" PRIu64 ".sidx", fromSequence);
+    return (std::filesystem::path(directory) / name).string();
+}
+
+/**
+ * @brief 启动后台补齐
+ *
+ * 在调用线程中记下日志末尾序号，之后写入的记录由 add 提供
+ */
+void SearchIndex::startCatchUp() {
+    uint64_t endSequence = log.nextSequence();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ready = false;
+    }
+    worker = std::thread([this, endSequence]() { catchUp(endSequence); });
+}
+
+/**
+ * @brief 补齐线程主函数
+ *
+ * 从已索引上界读到 endSequence，分批加入内存倒排表并按需写段，
+ * 最后索引补齐期间暂存的新消息
+ *
+ * @param endSequence 补齐的结束序号（不含）
+ */
+void SearchIndex::catchUp(uint64_t endSequence) {
+    uint64_t fromSequence;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        fromSequence = indexedSequence;
+    }
+    size_t indexed = 0;
+    std::vector<std::pair<uint64_t, Message>> batch;
+    auto mergeBatch = [this, &batch, &indexed]() {
+        bool full;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (const auto& [sequence, message] : batch) {
+                addLocked(sequence, message);
+            }
+            full = memoryBytes > options.memoryBytes;
+        }
+        indexed += batch.size();
+        batch.clear();
+        if (full) {
+            flush();
+        }
+    };
+
+    log.read(fromSequence, [&](uint64_t sequence, const Message& message) {
+        if (sequence >= endSequence || cancelled.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        batch.emplace_back(sequence, message);
+        if (batch.size() == kCatchUpBatch) {
+            mergeBatch();
+        }
+        return true;
+    });
+    mergeBatch();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& [sequence, message] : pending) {
+            addLocked(sequence, message);
+        }
+        pending.clear();
+        pending.shrink_to_fit();
+        ready = true;
+    }
+    readyCondition.notify_all();
+    if (indexed > 0) {
+        CHAT_LOG_INFO("Search index: indexed " + std::to_string(indexed) + " log records from #" +
+                      std::to_string(fromSequence));
+    }
+}
+
+/**
+ * @brief 补齐是否已完成
+ */
+bool SearchIndex::isReady() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return ready;
+}
+
+/**
+ * @brief 等待补齐完成
+ *
+ * @param timeout 最长等待时间
+ * @return 补齐已完成时返回true
+ */
+bool SearchIndex::waitUntilReady(std::chrono::milliseconds timeout) const {
+    std::unique_lock<std::mutex> lock(mutex);
+    return readyCondition.wait_for(lock, timeout, [this]() { return ready; });
+}
+
+/**
+ * @brief 索引一条已写入日志的消息
+ *
+ * 内存倒排表超过上限时只把它换下为冻结表并唤醒后台写段线程，
+ * 调用线程（HistoryWriter 的写线程）不等待写段与合并。上一张冻结表
+ * 尚未写出时暂不换下，内存倒排表继续增长
+ *
+ * @param sequence 日志序号
+ * @param message 消息
+ */
+void SearchIndex::add(uint64_t sequence, const Message& message) {
+    bool frozeTable = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!ready) {
+            pending.emplace_back(sequence, message);
+            return;
+        }
+        addLocked(sequence, message);
+        if (memoryBytes > options.memoryBytes && freezeLocked()) {
+            flushRequested = true;
+            frozeTable = true;
+        }
+    }
+    if (frozeTable) {
+        flushCondition.notify_one();
+    }
+}
+
+/**
+ * @brief 将消息加入内存倒排表
+ *
+ * 同一个键在消息中的所有位置合并为一条记录
+ *
+ * @param sequence 日志序号
+ * @param message 消息
+ */
+void SearchIndex::addLocked(uint64_t sequence, const Message& message) {
+    if (sequence < indexedSequence) {
+        return;
+    }
+    indexedSequence = sequence + 1;
+
+    std::vector<std::pair<std::string, uint32_t>> occurrences;
+    options.keys(message, occurrences);
+    std::sort(occurrences.begin(), occurrences.end());
+
+    for (size_t i = 0; i < occurrences.size();) {
+        size_t j = i;
+        while (j < occurrences.size() && occurrences[j].first == occurrences[i].first) {
+            ++j;
+        }
+        auto [it, inserted] = memory.try_emplace(occurrences[i].first);
+        MemoryPostings& postings = it->second;
+        size_t before = postings.data.size();
+        if (inserted) {
+            memoryBytes += it->first.size() + kMemoryTermOverhead;
+        }
+        appendVarint(postings.data, sequence - postings.lastSequence);
+        appendVarint(postings.data, j - i);
+        uint32_t previous = 0;
+        for (size_t k = i; k < j; ++k) {
+            appendVarint(postings.data, occurrences[k].second - previous);
+            previous = occurrences[k].second;
+        }
+        postings.lastSequence = sequence;
+        ++postings.documents;
+        memoryBytes += postings.data.size() - before;
+        i = j;
+    }
+}
+
+/**
+ * @brief 后台写段线程主函数
+ *
+ * 每当 add 换下一张冻结表时写段，然后合并相近的段并删除过期的段
+ */
+void SearchIndex::runFlusher() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        flushCondition.wait(lock, [this]() { return stopping || flushRequested; });
+        if (stopping) {
+            return;
+        }
+        flushRequested = false;
+        lock.unlock();
+        {
+            std::lock_guard<std::mutex> flushLock(flushMutex);
+            if (writeFrozen()) {
+                mergeTail();
+                dropExpired();
+            }
+        }
+        lock.lock();
+    }
+}
+
+/**
+ * @brief 将内存倒排表写成磁盘段，然后合并相近的段并删除过期的段
+ *
+ * 先写出尚未写出的冻结表，再换下当前的内存倒排表写段
+ *
+ * @return 写入成功或内存倒排表为空时返回true
+ */
+bool SearchIndex::flush() {
+    std::lock_guard<std::mutex> flushLock(flushMutex);
+    bool ok = writeFrozen();
+    if (ok) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            freezeLocked();
+        }
+        ok = writeFrozen();
+    }
+    if (ok) {
+        mergeTail();
+        dropExpired();
+    }
+    return ok;
+}
+
+/**
+ * @brief 把内存倒排表换下为冻结表
+ *
+ * @return 换下了非空的表时返回true；已有冻结表尚未写出时返回false
+ */
+bool SearchIndex::freezeLocked() {
+    if (frozen || indexedSequence == memoryFrom) {
+        return false;
+    }
+    auto table = std::make_shared<FrozenTable>();
+    table->postings.swap(memory);
+    table->fromSequence = memoryFrom;
+    table->endSequence = indexedSequence;
+    table->bytes = memoryBytes;
+    frozen = std::move(table);
+    memoryBytes = 0;
+    memoryFrom = indexedSequence;
+    return true;
+}
+
+/**
+ * @brief 将冻结表写成磁盘段
+ *
+ * 冻结表不再修改，编码和写文件在锁外进行，新消息的索引和查询不必等待；
+ * 写入失败时保留冻结表，由下一次 flush 重试
+ *
+ * @return 写入成功或没有冻结表时返回true
+ */
+bool SearchIndex::writeFrozen() {
+    std::shared_ptr<const FrozenTable> table;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        table = frozen;
+    }
+    if (!table) {
+        return true;
+    }
+    std::vector<TermRecord> records;
+    records.reserve(table->postings.size());
+    for (const auto& [key, postings] : table->postings) {
+        records.push_back({key, postings.documents, postings.data});
+    }
+    std::sort(records.begin(), records.end(),
+              [](const TermRecord& a, const TermRecord& b) { return a.key < b.key; });
+
+    std::string path = segmentPath(table->fromSequence);
+    std::shared_ptr<const Segment> segment;
+    if (writeFileAtomic(path, encodeSegment(table->fromSequence, table->endSequence, records, {}))) {
+        segment = Segment::open(path);
+    }
+    if (!segment) {
+        CHAT_LOG_ERROR("Error writing search index segment " + path + ": " + std::strerror(errno));
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    segments.push_back(std::move(segment));
+    frozen.reset();
+    return true;
+}
+
+/**
+ * @brief 合并末尾大小相近的段
+ *
+ * 较新的段不小于较旧一段的一半时合并两者，如同二进制计数器的进位，
+ * 每条记录被重写的次数与段数一样是对数级。合并在锁外进行，段本身不可变；
+ * 合并结果以较旧一段的文件名原子替换，之后再删除较新一段的文件
+ */
+void SearchIndex::mergeTail() {
+    for (;;) {
+        std::shared_ptr<const Segment> older, newer;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (segments.size() < 2) {
+                return;
+            }
+            older = segments[segments.size() - 2];
+            newer = segments.back();
+        }
+        if (newer->data.size() * 2 < older->data.size()) {
+            return;
+        }
+
+        // 按键归并两个段的键表
+        std::vector<TermRecord> records;
+        std::vector<std::string> postings;
+        records.reserve(older->termCount + newer->termCount);
+        size_t i = 0, j = 0;
+        TermRecord a, b;
+        bool valid = true;
+        while (i < older->termCount || j < newer->termCount) {
+            bool hasA = i < older->termCount;
+            bool hasB = j < newer->termCount;
+            if ((hasA && !older->recordAt(i, a)) || (hasB && !newer->recordAt(j, b))) {
+                valid = false;
+                break;
+            }
+            std::string merged;
+            if (hasA && (!hasB || a.key < b.key)) {
+                records.push_back(a);
+                merged.assign(a.postings);
+                ++i;
+            } else if (hasB && (!hasA || b.key < a.key)) {
+                records.push_back(b);
+                merged.assign(b.postings);
+                ++j;
+            } else {
+                records.push_back({a.key, a.documents + b.documents, {}});
+                merged.assign(a.postings);
+                appendPostings(merged, lastSequenceOf(a.postings), b.postings);
+                ++i;
+                ++j;
+            }
+            postings.push_back(std::move(merged));
+        }
+        if (!valid) {
+            CHAT_LOG_WARN("Search index: cannot merge corrupt segment " + older->path);
+            return;
+        }
+
+        std::string path = older->path;
+        std::shared_ptr<const Segment> segment;
+        if (writeFileAtomic(path, encodeSegment(older->fromSequence, newer->endSequence, records, postings))) {
+            segment = Segment::open(path);
+        }
+        if (!segment) {
+            CHAT_LOG_ERROR("Error merging search index segments into " + path + ": " +
+                           std::strerror(errno));
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            segments.pop_back();
+            segments.back() = std::move(segment);
+            ++merges;
+        }
+        std::error_code ec;
+        std::filesystem::remove(newer->path, ec);
+    }
+}
+
+/**
+ * @brief 删除完全早于日志最早序号的段
+ *
+ * 日志的保留策略删除旧段后，这些段中的序号已无法读取
+ */
+void SearchIndex::dropExpired() {
+    uint64_t first = log.firstSequence();
+    std::vector<std::shared_ptr<const Segment>> expired;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto end = std::find_if(segments.begin(), segments.end(), [first](const auto& segment) {
+            return segment->endSequence > first;
+        });
+        expired.assign(segments.begin(), end);
+        segments.erase(segments.begin(), end);
+    }
+    std::error_code ec;
+    for (const auto& segment : expired) {
+        std::filesystem::remove(segment->path, ec);
+    }
+}
+
+/**
+ * @brief 查找房间中同时包含所有短语的消息
+ *
+ * 按从新到旧的顺序逐段查询（先内存倒排表，再磁盘段），凑够 limit 条即停止
+ *
+ * @param room 房间名
+ * @param phrases 短语列表
+ * @param before 序号上界（不含）
+ * @param limit 最多返回的序号数
+ * @return 匹配的消息序号，从新到旧排列
+ */
+std::vector<uint64_t> SearchIndex::search(const std::string& room,
+                                          const std::vector<std::vector<std::string>>& phrases, uint64_t before,
+                                          size_t limit) const {
+    std::vector<uint64_t> result;
+    std::vector<std::string> keys;
+    std::vector<std::vector<size_t>> phraseTerms;
+    for (const auto& phrase : phrases) {
+        std::vector<size_t> terms;
+        for (const std::string& term : phrase) {
+            std::string key = termKey(room, term);
+            auto it = std::find(keys.begin(), keys.end(), key);
+            terms.push_back(static_cast<size_t>(it - keys.begin()));
+            if (it == keys.end()) {
+                keys.push_back(std::move(key));
+            }
+        }
+        if (!terms.empty()) {
+            phraseTerms.push_back(std::move(terms));
+        }
+    }
+    if (keys.empty() || limit == 0) {
+        return result;
+    }
+
+    std::vector<std::string> copies;
+    std::shared_ptr<const FrozenTable> heldFrozen;
+    std::vector<std::shared_ptr<const Segment>> held;
+    auto sources = collectPostings(keys, copies, heldFrozen, held);
+
+    for (const auto& [fromSequence, postings] : sources) {
+        if (fromSequence >= before) {
+            continue;
+        }
+        std::vector<std::vector<PostingDocument>> lists(keys.size());
+        for (size_t t = 0; t < keys.size(); ++t) {
+            decodePostings(postings[t], lists[t]);
+        }
+        // 以最短的倒排表为候选，在其余倒排表中二分查找
+        size_t shortest = 0;
+        for (size_t t = 1; t < lists.size(); ++t) {
+            if (lists[t].size() < lists[shortest].size()) {
+                shortest = t;
+            }
+        }
+        auto findDocument = [&lists](size_t term, uint64_t sequence) -> const PostingDocument* {
+            const std::vector<PostingDocument>& list = lists[term];
+            auto it = std::lower_bound(list.begin(), list.end(), sequence,
+                                       [](const PostingDocument& d, uint64_t s) { return d.sequence < s; });
+            return it != list.end() && it->sequence == sequence ? &*it : nullptr;
+        };
+
+        const std::vector<PostingDocument>& candidates = lists[shortest];
+        for (auto it = candidates.rbegin(); it != candidates.rend() && result.size() < limit; ++it) {
+            uint64_t sequence = it->sequence;
+            if (sequence >= before) {
+                continue;
+            }
+            std::vector<const PostingDocument*> documents(keys.size());
+            bool all = true;
+            for (size_t t = 0; t < keys.size() && all; ++t) {
+                documents[t] = findDocument(t, sequence);
+                all = documents[t] != nullptr;
+            }
+            if (!all) {
+                continue;
+            }
+            // 短语中的第 k 个词需出现在首词位置加 k 处
+            bool matched = true;
+            for (const std::vector<size_t>& terms : phraseTerms) {
+                if (terms.size() < 2) {
+                    continue;
+                }
+                std::vector<std::vector<uint32_t>> positions;
+                for (size_t term : terms) {
+                    positions.push_back(decodePositions(*documents[term]));
+                }
+                bool found = false;
+                for (uint32_t start : positions[0]) {
+                    bool adjacent = true;
+                    for (size_t k = 1; k < terms.size() && adjacent; ++k) {
+                        adjacent = std::binary_search(positions[k].begin(), positions[k].end(),
+                                                      start + static_cast<uint32_t>(k));
+                    }
+                    if (adjacent) {
+                        found = true;
+                        break;
+                    }
+                }
+                if (!found) {
+                    matched = false;
+                    break;
+                }
+            }
+            if (matched) {
+                result.push_back(sequence);
+            }
+        }
+        if (result.size() >= limit) {
+            break;
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief 读取一个键的倒排表
+ *
+ * @param key 索引键
+ * @param before 序号上界（不含）
+ * @param limit 最多返回的序号数
+ * @return 含有该键的消息序号，从新到旧排列
+ */
+std::vector<uint64_t> SearchIndex::lookup(const std::string& key, uint64_t before, size_t limit) const {
+    std::vector<uint64_t> result;
+    std::vector<std::string> copies;
+    std::shared_ptr<const FrozenTable> heldFrozen;
+    std::vector<std::shared_ptr<const Segment>> held;
+    std::vector<PostingDocument> documents;
+    for (const auto& [fromSequence, postings] : collectPostings({key}, copies, heldFrozen, held)) {
+        if (result.size() >= limit) {
+            break;
+        }
+        if (fromSequence >= before) {
+            continue;
+        }
+        documents.clear();
+        decodePostings(postings[0], documents);
+        for (auto it = documents.rbegin(); it != documents.rend() && result.size() < limit; ++it) {
+            if (it->sequence < before) {
+                result.push_back(it->sequence);
+            }
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief 按序号递增读取一个键在 [from, end) 内最早的 limit 条消息
+ *
+ * 来源从新到旧排列，较新一个来源的首个序号不小于较旧来源覆盖的上界，
+ * 据此跳过完全早于 from 的来源
+ *
+ * @param key 索引键
+ * @param from 序号下界（包含）
+ * @param end 序号上界（不含）
+ * @param limit 最多返回的序号数
+ * @return 含有该键的消息序号，从旧到新排列
+ */
+std::vector<uint64_t> SearchIndex::lookupRange(const std::string& key, uint64_t from, uint64_t end,
+                                               size_t limit) const {
+    std::vector<uint64_t> result;
+    std::vector<std::string> copies;
+    std::shared_ptr<const FrozenTable> heldFrozen;
+    std::vector<std::shared_ptr<const Segment>> held;
+    std::vector<PostingDocument> documents;
+    auto sources = collectPostings({key}, copies, heldFrozen, held);
+    for (size_t i = sources.size(); i-- > 0 && result.size() < limit;) {
+        if (sources[i].first >= end) {
+            break;
+        }
+        if (i > 0 && sources[i - 1].first <= from) {
+            continue;
+        }
+        documents.clear();
+        decodePostings(sources[i].second[0], documents);
+        auto it = std::lower_bound(documents.begin(), documents.end(), from,
+                                   [](const PostingDocument& d, uint64_t s) { return d.sequence < s; });
+        for (; it != documents.end() && it->sequence < end && result.size() < limit; ++it) {
+            result.push_back(it->sequence);
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief 收集各个键在每个来源中的倒排表
+ *
+ * 内存中相关的倒排表在锁内复制，冻结表和磁盘段持有引用后在锁外查找
+ *
+ * @param keys 索引键
+ * @param copies 保存内存倒排表的副本
+ * @param heldFrozen 保存冻结表的引用
+ * @param held 保存磁盘段的引用
+ * @return 各来源的首个序号和各键的倒排表，从新到旧排列
+ */
+std::vector<std::pair<uint64_t, std::vector<std::string_view>>> SearchIndex::collectPostings(
+    const std::vector<std::string>& keys, std::vector<std::string>& copies,
+    std::shared_ptr<const FrozenTable>& heldFrozen,
+    std::vector<std::shared_ptr<const Segment>>& held) const {
+    std::vector<std::pair<uint64_t, std::vector<std::string_view>>> sources;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        copies.reserve(keys.size());
+        for (const std::string& key : keys) {
+            auto it = memory.find(key);
+            if (it == memory.end()) {
+                copies.clear();
+                break;
+            }
+            copies.push_back(it->second.data);
+        }
+        heldFrozen = frozen;
+        held = segments;
+        if (!copies.empty()) {
+            sources.emplace_back(memoryFrom, std::vector<std::string_view>(copies.begin(), copies.end()));
+        }
+    }
+    if (heldFrozen) {
+        std::vector<std::string_view> postings;
+        for (const std::string& key : keys) {
+            auto it = heldFrozen->postings.find(key);
+            if (it == heldFrozen->postings.end()) {
+                postings.clear();
+                break;
+            }
+            postings.push_back(it->second.data);
+        }
+        if (!postings.empty()) {
+            sources.emplace_back(heldFrozen->fromSequence, std::move(postings));
+        }
+    }
+    for (auto it = held.rbegin(); it != held.rend(); ++it) {
+        std::vector<std::string_view> postings;
+        for (const std::string& key : keys) {
+            TermRecord record;
+            if (!(*it)->find(key, record)) {
+                postings.clear();
+                break;
+            }
+            postings.push_back(record.postings);
+        }
+        if (!postings.empty()) {
+            sources.emplace_back((*it)->fromSequence, std::move(postings));
+        }
+    }
+    return sources;
+}
+
+/**
+ * @brief 获取索引统计
+ */
+SearchIndexStats SearchIndex::getStats() const {
+    SearchIndexStats stats;
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.segments = segments.size();
+    for (const auto& segment : segments) {
+        stats.diskBytes += segment->data.size();
+    }
+    stats.memoryBytes = memoryBytes;
+    stats.memoryTerms = memory.size();
+    if (frozen) {
+        stats.memoryBytes += frozen->bytes;
+        stats.memoryTerms += frozen->postings.size();
+    }
+    stats.indexedSequence = indexedSequence;
+    stats.merges = merges;
+    return stats;
+}
+
+} // namespace chat
@@ -0,0 +1,319 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "../common/message.hpp"
+#include "history_log.hpp"
+
+namespace chat {
+
+/**
+ * @brief 将文本切分为检索词
+ *
+ * 按 UTF-8 解码：ASCII 字母和数字组成的词转为小写；汉字和假名每个字符
+ * 单独成词（中文和日文不以空格分词，短语查询依靠位置相邻匹配）；其他
+ * 非 ASCII 字符（如带重音的拉丁字母、韩文）视为词的一部分；ASCII 标点、
+ * 空白、常用全角标点和非法的 UTF-8 字节视为分隔符。超过 kMaxTokenBytes
+ * 的词被丢弃。
+ *
+ * @param text 文本
+ * @return 按出现顺序排列的检索词，下标即词的位置
+ */
+std::vector<std::string> tokenizeText(std::string_view text);
+
+/// 检索词的最大字节数
+constexpr size_t kMaxTokenBytes = 64;
+
+/**
+ * @brief 索引键函数：为一条消息生成 (键, 位置) 列表
+ *
+ * 同一个键可出现多次，位置用于短语匹配，不需要时填 0
+ */
+using IndexKeyFunction = std::function<void(const Message& message,
+                                            std::vector<std::pair<std::string, uint32_t>>& keys)>;
+
+/**
+ * @brief 全文检索的索引键：房间加检索词，位置为词在消息中的下标
+ */
+void textIndexKeys(const Message& message, std::vector<std::pair<std::string, uint32_t>>& keys);
+
+/**
+ * @brief 按用户查询的索引键：用户名，以及房间加用户名
+ *
+ * 前者用于跨房间列出某个用户的全部消息（如审核），后者用于房间内的查询
+ */
+void userIndexKeys(const Message& message, std::vector<std::pair<std::string, uint32_t>>& keys);
+
+/**
+ * @brief 按房间分页的索引键：房间名
+ *
+ * 供 HistoryStore 在内存队列之外按序号分页，不必顺序扫描日志
+ */
+void roomIndexKeys(const Message& message, std::vector<std::pair<std::string, uint32_t>>& keys);
+
+/**
+ * @brief 房间内某个用户的索引键
+ * @param room 房间名，为空时返回跨房间的键
+ * @param username 用户名
+ */
+std::string userIndexKey(const std::string& room, const std::string& username);
+
+/**
+ * @brief 全文索引配置
+ */
+struct SearchIndexOptions {
+    size_t memoryBytes = 16 << 20;   ///< 内存中的倒排表超过该大小后写成磁盘段
+    IndexKeyFunction keys;           ///< 索引键函数，为空时使用 textIndexKeys
+};
+
+/**
+ * @brief 全文索引统计
+ */
+struct SearchIndexStats {
+    size_t segments = 0;            ///< 磁盘段数
+    uint64_t diskBytes = 0;         ///< 磁盘段总字节数
+    size_t memoryBytes = 0;         ///< 内存倒排表（含等待写段的冻结表）占用的字节数（估算）
+    size_t memoryTerms = 0;         ///< 内存倒排表中的词数
+    uint64_t indexedSequence = 0;   ///< 已索引的日志序号上界（不含）
+    uint64_t merges = 0;            ///< 段合并次数
+};
+
+/**
+ * @brief 聊天历史的增量倒排索引
+ *
+ * 键由 SearchIndexOptions::keys 从消息生成，倒排表记录含有该键的消息序号及
+ * 位置。全文检索以 "房间\0检索词" 为键，位置为词在消息中的下标，查询天然
+ * 限定在一个房间内；按用户查询以用户名为键（见 userIndexKeys）。
+ *
+ * 新消息先进入内存倒排表，超过 memoryBytes 时 add 只把整张表换下冻结，
+ * 由后台写段线程按键排序写成一个不可变的磁盘段，调用 add 的线程不做磁盘 I/O；
+ * 调用 flush 时在调用线程中写段。相邻两段中较新的一段
+ * 不小于较旧一段的一半时合并，段数与索引总量成对数关系。
+ *
+ * 磁盘段文件名为段覆盖的首个序号（20 位十进制）加 .sidx，格式为：
+ * - 头部 32 字节：magic "CHSI" | version(u8) | 保留(3) | fromSequence(u64) |
+ *   endSequence(u64) | termCount(u32) | crc32c(头部之后的全部数据)(u32)
+ * - 键表：termCount 个 offset(u64)，按键的字节序排列，指向各词条
+ * - 词条：len(varint) key | documentCount(varint) | len(varint) postings
+ * - postings：每条消息为 序号差(varint) | 位置数(varint) | 位置差(varint)...，
+ *   序号差和位置差都从 0 起算
+ * 整数均为小端序。段以只读方式 mmap，打开时只校验头部和校验和，
+ * 查询时在键表上二分查找，无需把索引读入内存。
+ *
+ * 打开时丢弃损坏的段及其之后的段，被合并段包含的旧段（合并后崩溃留下）
+ * 直接删除；startCatchUp 在后台从日志补齐最后一段之后的消息。
+ * 完全早于日志最早序号的段在 flush 时删除。
+ *
+ * 所有成员函数都是线程安全的；add 需按序号递增调用。
+ */
+class SearchIndex {
+public:
+    /**
+     * @brief 打开（必要时创建）索引目录并载入已有的段
+     * @param directory 索引目录
+     * @param log 历史日志，生命周期需长于本对象
+     * @param options 索引配置
+     * @throw std::runtime_error 无法创建目录时抛出
+     */
+    SearchIndex(const std::string& directory, const HistoryLog& log, const SearchIndexOptions& options = {});
+
+    /**
+     * @brief 析构函数，取消尚未完成的补齐并停止后台写段线程
+     */
+    ~SearchIndex();
+
+    // 禁止拷贝和赋值
+    SearchIndex(const SearchIndex&) = delete;
+    SearchIndex& operator=(const SearchIndex&) = delete;
+
+    /**
+     * @brief 启动后台补齐，只能调用一次
+     *
+     * 必须在有新消息写入日志之前调用；补齐期间 add 的消息暂存，完成后再索引
+     */
+    void startCatchUp();
+
+    /**
+     * @brief 补齐是否已完成（未启动补齐时视为完成）
+     */
+    bool isReady() const;
+
+    /**
+     * @brief 等待补齐完成
+     * @param timeout 最长等待时间
+     * @return 补齐已完成时返回true
+     */
+    bool waitUntilReady(std::chrono::milliseconds timeout) const;
+
+    /**
+     * @brief 索引一条已写入日志的消息，序号小于已索引上界的消息被忽略
+     *
+     * 只修改内存倒排表，不做磁盘 I/O
+     *
+     * @param sequence 日志序号
+     * @param message 消息
+     */
+    void add(uint64_t sequence, const Message& message);
+
+    /**
+     * @brief 将内存倒排表（及尚未写出的冻结表）写成磁盘段
+     * @return 写入成功或内存倒排表为空时返回true
+     */
+    bool flush();
+
+    /**
+     * @brief 查找房间中同时包含所有短语的消息
+     *
+     * 每个短语是一组检索词，要求在消息中按顺序相邻出现；单个词即长度为 1 的短语。
+     * 从最短的倒排表开始求交集，再用位置校验短语，耗时与所查词的倒排表长度成正比
+     *
+     * @param room 房间名
+     * @param phrases 短语列表
+     * @param before 序号上界（不含）
+     * @param limit 最多返回的序号数
+     * @return 匹配的消息序号，从新到旧排列
+     */
+    std::vector<uint64_t> search(const std::string& room, const std::vector<std::vector<std::string>>& phrases,
+                                 uint64_t before, size_t limit) const;
+
+    /**
+     * @brief 读取一个键的倒排表
+     *
+     * 只解码该键在各段中的倒排表，耗时与含有该键的消息数成正比
+     *
+     * @param key 索引键
+     * @param before 序号上界（不含）
+     * @param limit 最多返回的序号数
+     * @return 含有该键的消息序号，从新到旧排列
+     */
+    std::vector<uint64_t> lookup(const std::string& key, uint64_t before, size_t limit) const;
+
+    /**
+     * @brief 按序号递增读取一个键在 [from, end) 内最早的 limit 条消息
+     *
+     * 与 lookup 方向相反，完全早于 from 的段不解码
+     *
+     * @param key 索引键
+     * @param from 序号下界（包含）
+     * @param end 序号上界（不含）
+     * @param limit 最多返回的序号数
+     * @return 含有该键的消息序号，从旧到新排列
+     */
+    std::vector<uint64_t> lookupRange(const std::string& key, uint64_t from, uint64_t end, size_t limit) const;
+
+    /**
+     * @brief 获取索引统计
+     */
+    SearchIndexStats getStats() const;
+
+private:
+    class Segment;
+
+    /**
+     * @brief 内存中一个词的倒排表，编码与磁盘段相同
+     */
+    struct MemoryPostings {
+        std::string data;                ///< 编码后的倒排表
+        uint64_t lastSequence = 0;       ///< 最后一条消息的序号
+        uint32_t documents = 0;          ///< 消息数
+    };
+
+    /**
+     * @brief 已换下、等待写段的内存倒排表，冻结后不再修改
+     */
+    struct FrozenTable {
+        std::unordered_map<std::string, MemoryPostings> postings;  ///< 倒排表
+        uint64_t fromSequence = 0;       ///< 覆盖的首个序号
+        uint64_t endSequence = 0;        ///< 覆盖的序号上界（不含）
+        size_t bytes = 0;                ///< 占用的字节数
+    };
+
+    /**
+     * @brief 补齐线程主函数
+     */
+    void catchUp(uint64_t endSequence);
+
+    /**
+     * @brief 将消息加入内存倒排表（调用方需持有锁）
+     */
+    void addLocked(uint64_t sequence, const Message& message);
+
+    /**
+     * @brief 后台写段线程主函数
+     */
+    void runFlusher();
+
+    /**
+     * @brief 把内存倒排表换下为冻结表（调用方需持有锁）
+     * @return 换下了非空的表时返回true；已有冻结表尚未写出时返回false
+     */
+    bool freezeLocked();
+
+    /**
+     * @brief 将冻结表写成磁盘段（调用方需持有 flushMutex）
+     * @return 写入成功或没有冻结表时返回true
+     */
+    bool writeFrozen();
+
+    /**
+     * @brief 合并末尾大小相近的段（调用方需持有 flushMutex）
+     */
+    void mergeTail();
+
+    /**
+     * @brief 删除完全早于日志最早序号的段（调用方需持有 flushMutex）
+     */
+    void dropExpired();
+
+    /**
+     * @brief 收集各个键在每个来源（内存倒排表和磁盘段）中的倒排表
+     *
+     * 来源按从新到旧排列；缺少任一键的来源被跳过。内存倒排表复制到 copies 中，
+     * 冻结表和磁盘段的引用保存在 heldFrozen 和 held 中，返回的倒排表在三者销毁前有效
+     */
+    std::vector<std::pair<uint64_t, std::vector<std::string_view>>> collectPostings(
+        const std::vector<std::string>& keys, std::vector<std::string>& copies,
+        std::shared_ptr<const FrozenTable>& heldFrozen,
+        std::vector<std::shared_ptr<const Segment>>& held) const;
+
+    /**
+     * @brief 段文件路径
+     */
+    std::string segmentPath(uint64_t fromSequence) const;
+
+    std::string directory;                    ///< 索引目录
+    const HistoryLog& log;                    ///< 历史日志
+    SearchIndexOptions options;               ///< 索引配置
+
+    std::mutex flushMutex;                    ///< 串行化写段与合并
+    mutable std::mutex mutex;                 ///< 保护以下数据
+    mutable std::condition_variable readyCondition;  ///< 补齐完成通知
+    std::condition_variable flushCondition;   ///< 唤醒后台写段线程
+    std::vector<std::shared_ptr<const Segment>> segments;  ///< 磁盘段，按序号递增排列
+    std::unordered_map<std::string, MemoryPostings> memory;  ///< 内存倒排表
+    size_t memoryBytes = 0;                   ///< 内存倒排表占用的字节数
+    uint64_t memoryFrom = 0;                  ///< 内存倒排表覆盖的首个序号
+    std::shared_ptr<const FrozenTable> frozen;  ///< 等待写段的冻结表
+    bool flushRequested = false;              ///< 有新的冻结表等待后台写段
+    bool stopping = false;                    ///< 后台写段线程是否应退出
+    uint64_t indexedSequence = 0;             ///< 已索引的序号上界（不含）
+    std::vector<std::pair<uint64_t, Message>> pending;  ///< 补齐期间暂存的新消息
+    bool ready = true;                        ///< 补齐是否已完成
+    uint64_t merges = 0;                      ///< 段合并次数
+
+    std::thread worker;                       ///< 补齐线程
+    std::thread flusher;                      ///< 后台写段与合并线程
+    std::atomic<bool> cancelled{false};       ///< 是否取消补齐
+};
+
+} // namespace chat
@@ -1,29 +1,42 @@
 #include "websocket_server.hpp"
 #include "../common/logger.hpp"
+#include "../common/binary_log.hpp"
+#include "../common/log_throttle.hpp"
 #include <iostream>
+#include <algorithm>
 #include <thread>
+#include <cerrno>
+#include <sys/socket.h>
 
 namespace chat {
 
 /**
  * @brief 构造函数
  * 
- * 初始化WebSocket服务器，设置事件处理器
+ * 创建监听分片并设置事件处理器
  * 
  * @param port 服务器监听端口
+ * @param ioThreads 运行事件循环的线程总数，0 表示使用硬件并发数
+ * @param listenerShards 监听分片数，大于 1 时使用 SO_REUSEPORT
  */
-ChatServer::ChatServer(uint16_t port) : port(port), running(false) {
-    // 设置日志级别
-    server.set_access_channels(websocketpp::log::alevel::none);
-    server.set_error_channels(websocketpp::log::elevel::fatal);
-    
-    // 初始化ASIO
-    server.init_asio();
-    
-    // 设置事件处理器
-    server.set_open_handler(std::bind(&ChatServer::onOpen, this, std::placeholders::_1));
-    server.set_close_handler(std::bind(&ChatServer::onClose, this, std::placeholders::_1));
-    server.set_message_handler(std::bind(&ChatServer::onMessage, this, std::placeholders::_1, std::placeholders::_2));
+ChatServer::ChatServer(uint16_t port, size_t ioThreads, size_t listenerShards)
+    : ioThreadCount(ioThreads), running(false), port(port) {
+    if (ioThreadCount == 0) {
+        ioThreadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    listenerShards = std::max<size_t>(1, listenerShards);
+#ifndef SO_REUSEPORT
+    if (listenerShards > 1) {
+        CHAT_LOG_WARN("SO_REUSEPORT not supported, falling back to a single listener");
+        listenerShards = 1;
+    }
+#endif
+    // 每个分片至少需要一个线程运行其事件循环
+    ioThreadCount = std::max(ioThreadCount, listenerShards);
+
+    for (size_t i = 0; i < listenerShards; ++i) {
+        shards.push_back(createShard(listenerShards > 1));
+    }
 }
 
 /**
@@ -35,60 +48,487 @@ ChatServer::~ChatServer() {
     stop();
 }
 
+/**
+ * @brief 创建并初始化一个分片端点
+ * 
+ * @param reusePort 是否在监听套接字上设置 SO_REUSEPORT
+ * @return 已设置事件处理器的端点
+ */
+std::unique_ptr<WebSocketServer> ChatServer::createShard(bool reusePort) {
+    auto shard = std::make_unique<WebSocketServer>();
+
+    // 设置日志级别
+    shard->set_access_channels(websocketpp::log::alevel::none);
+    shard->set_error_channels(websocketpp::log::elevel::fatal);
+    
+    // 初始化ASIO，每个分片拥有独立的 io_service
+    shard->init_asio();
+
+#ifdef SO_REUSEPORT
+    if (reusePort) {
+        // 在 bind 之前设置 SO_REUSEPORT，使多个分片可以监听同一端口
+        shard->set_tcp_pre_bind_handler([](WebSocketServer::acceptor_ptr acceptor) {
+            int enable = 1;
+            websocketpp::lib::error_code ec;
+            if (::setsockopt(acceptor->native_handle(), SOL_SOCKET, SO_REUSEPORT,
+                             &enable, sizeof(enable)) != 0) {
+                ec = websocketpp::lib::error_code(errno, websocketpp::lib::system_category());
+            }
+            return ec;
+        });
+    }
+#else
+    (void)reusePort;
+#endif
+    
+    // 设置事件处理器
+    shard->set_validate_handler(std::bind(&ChatServer::onValidate, this, std::placeholders::_1));
+    shard->set_open_handler(std::bind(&ChatServer::onOpen, this, std::placeholders::_1));
+    shard->set_close_handler(std::bind(&ChatServer::onClose, this, std::placeholders::_1));
+    shard->set_message_handler(std::bind(&ChatServer::onMessage, this, std::placeholders::_1, std::placeholders::_2));
+    return shard;
+}
+
 /**
  * @brief 启动服务器
  * 
- * 在新线程中运行服务器事件循环
+ * 各分片分别监听同一端口，ioThreadCount 个线程按轮转方式分配给各分片
  */
 void ChatServer::start() {
-    if (running) return;
+    if (running.exchange(true)) return;
+    
+    for (auto& shard : shards) {
+        shard->reset();
+        shard->listen(port);
+        shard->start_accept();
+    }
     
-    running = true;
-    server.listen(port);
-    server.start_accept();
+    {
+        std::lock_guard<std::mutex> lock(queryMutex);
+        queryStopping = false;
+    }
+    for (size_t i = 0; i < std::max<size_t>(1, queryOptions.threads); ++i) {
+        queryThreads.emplace_back([this]() { runQueries(); });
+    }
     
-    // 在新线程中运行服务器
-    std::thread([this]() { run(); }).detach();
+    for (size_t i = 0; i < ioThreadCount; ++i) {
+        WebSocketServer& shard = *shards[i % shards.size()];
+        ioThreads.emplace_back([this, &shard]() { run(shard); });
+    }
     
-    Logger::getInstance().log("Server started on port " + std::to_string(port));
+    CHAT_LOG_INFO("Server started on port " + std::to_string(port) +
+                  " with " + std::to_string(ioThreadCount) + " I/O threads across " +
+                  std::to_string(shards.size()) + " listener shards");
 }
 
 /**
  * @brief 停止服务器
  * 
- * 关闭所有连接并停止服务器
+ * 停止监听并关闭所有连接，丢弃尚未执行的查询并等待查询线程退出，然后停止各分片的
+ * 事件循环、等待 I/O 线程退出，最后释放连接状态
  */
 void ChatServer::stop() {
-    if (!running) return;
+    if (!running.exchange(false)) return;
     
-    running = false;
-    server.stop();
-    server.stop_listening();
+    websocketpp::lib::error_code ec;
+    for (auto& shard : shards) {
+        shard->stop_listening(ec);
+    }
     
     // 关闭所有连接
-    for (auto& hdl : connections) {
-        server.close(hdl, websocketpp::close::status::normal, "Server shutting down");
+    {
+        std::shared_lock<std::shared_mutex> lock(connectionsMutex);
+        for (auto& entry : connections) {
+            ConnectionPtr con = getConnection(entry.first);
+            if (con) {
+                con->close(websocketpp::close::status::normal, "Server shutting down", ec);
+            }
+        }
+    }
+    
+    // 查询线程会在锁外向连接发送结果，先于 I/O 线程停止
+    {
+        std::lock_guard<std::mutex> lock(queryMutex);
+        queryStopping = true;
+        queryTasks.clear();
+    }
+    queryCondition.notify_all();
+    for (auto& thread : queryThreads) {
+        thread.join();
+    }
+    queryThreads.clear();
+    
+    for (auto& shard : shards) {
+        shard->stop();
+    }
+    bool calledFromIoThread = false;
+    for (auto& thread : ioThreads) {
+        if (thread.get_id() == std::this_thread::get_id()) {
+            // 在 I/O 线程内调用 stop 时无法等待自身退出
+            thread.detach();
+            calledFromIoThread = true;
+        } else if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    ioThreads.clear();
+    
+    // 处理函数会在锁外使用连接状态，必须等所有 I/O 线程退出后才能释放；
+    // 在 I/O 线程内调用时当前处理函数仍可能持有状态，留到析构时释放
+    if (!calledFromIoThread) {
+        std::unique_lock<std::shared_mutex> lock(connectionsMutex);
+        connections.clear();
+        rooms.clear();
     }
-    connections.clear();
     
-    Logger::getInstance().log("Server stopped");
+    CHAT_LOG_INFO("Server stopped");
 }
 
 /**
  * @brief 广播消息给所有连接的客户端
  * 
+ * 负载只分帧一次，所有连接共享同一个消息缓冲区
+ * 
  * @param message 要广播的消息
  */
 void ChatServer::broadcast(const std::string& message) {
-    for (auto& hdl : connections) {
+    MessagePtr frame = prepareFrame(message, websocketpp::frame::opcode::text);
+    std::shared_lock<std::shared_mutex> lock(connectionsMutex);
+    for (auto& entry : connections) {
+        sendFrame(entry.first, entry.second, frame);
+    }
+}
+
+/**
+ * @brief 将消息广播给其所在房间的订阅者
+ *
+ * 两种编码都在第一次需要时生成并分帧，之后所有同格式的连接共享同一个消息缓冲区。
+ *
+ * @param message 要广播的消息
+ */
+void ChatServer::broadcast(const Message& message) {
+    MessagePtr textFrame;
+    MessagePtr binaryFrame;
+    std::shared_lock<std::shared_mutex> lock(connectionsMutex);
+    auto room = rooms.find(message.room.empty() ? std::string(kDefaultRoom) : message.room);
+    if (room == rooms.end()) {
+        return;
+    }
+    for (auto& entry : room->second) {
+        ConnectionState& state = *entry.second;
+        if (state.format == WireFormat::Binary) {
+            if (!binaryFrame) {
+                binaryFrame = prepareFrame(message.toBinary(), websocketpp::frame::opcode::binary);
+            }
+            sendFrame(entry.first, state, binaryFrame);
+        } else {
+            if (!textFrame) {
+                textFrame = prepareFrame(message.toString(), websocketpp::frame::opcode::text);
+            }
+            sendFrame(entry.first, state, textFrame);
+        }
+    }
+    CHAT_BLOG_INFO("broadcast #{} room={} recipients={}", message.id, room->first, room->second.size());
+}
+
+/**
+ * @brief 获取房间的订阅者数量
+ * 
+ * @param room 房间名
+ * @return 订阅者数量
+ */
+size_t ChatServer::getRoomSize(const std::string& room) const {
+    std::shared_lock<std::shared_mutex> lock(connectionsMutex);
+    auto it = rooms.find(room);
+    return (it == rooms.end()) ? 0 : it->second.size();
+}
+
+/**
+ * @brief 将连接加入房间
+ * 
+ * 加入的房间同时成为该连接的当前房间
+ * 
+ * @param hdl 连接句柄
+ * @param state 连接状态
+ * @param room 房间名
+ */
+void ChatServer::joinRoom(ConnectionHdl hdl, ConnectionState& state, const std::string& room) {
+    state.rooms.insert(room);
+    state.currentRoom = room;
+    rooms[room][hdl] = &state;
+}
+
+/**
+ * @brief 将连接移出房间
+ * 
+ * 房间没有订阅者后即被删除；离开当前房间时改用任一仍在的房间
+ * 
+ * @param hdl 连接句柄
+ * @param state 连接状态
+ * @param room 房间名
+ */
+void ChatServer::leaveRoom(ConnectionHdl hdl, ConnectionState& state, const std::string& room) {
+    state.rooms.erase(room);
+    if (state.currentRoom == room) {
+        state.currentRoom = state.rooms.empty() ? std::string() : *state.rooms.begin();
+    }
+    auto it = rooms.find(room);
+    if (it != rooms.end()) {
+        it->second.erase(hdl);
+        if (it->second.empty()) {
+            rooms.erase(it);
+        }
+    }
+}
+
+/**
+ * @brief 处理房间命令
+ * 
+ * 支持 "/join 房间" 和 "/leave 房间"，非法房间名的命令被忽略并记录日志
+ * 
+ * @param hdl 连接句柄
+ * @param content 消息内容
+ * @return 内容是房间命令时返回true
+ */
+bool ChatServer::handleRoomCommand(ConnectionHdl hdl, const std::string& content) {
+    constexpr std::string_view kJoin = "/join ";
+    constexpr std::string_view kLeave = "/leave ";
+
+    std::string_view view(content);
+    bool join = view.compare(0, kJoin.size(), kJoin) == 0;
+    bool leave = !join && view.compare(0, kLeave.size(), kLeave) == 0;
+    if (!join && !leave) {
+        return false;
+    }
+
+    std::string room(view.substr(join ? kJoin.size() : kLeave.size()));
+    if (!isValidRoomName(room)) {
+        CHAT_LOG_THROTTLED(LogLevel::Warn, "query", "Ignoring room command: invalid room name");
+        return true;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(connectionsMutex);
+    auto it = connections.find(hdl);
+    if (it == connections.end()) {
+        return true;
+    }
+    if (join) {
+        joinRoom(hdl, it->second, room);
+    } else {
+        leaveRoom(hdl, it->second, room);
+    }
+    return true;
+}
+
+/**
+ * @brief 处理历史查询命令
+ * 
+ * 只能查询本连接已加入的房间。查询交给查询线程执行（可能读取磁盘），结果逐条
+ * 发给请求的连接，最后发送一条结束标记消息，其中带有下一页的游标
+ * 
+ * @param hdl 连接句柄
+ * @param content 消息内容
+ * @return 内容是历史查询命令时返回true
+ */
+bool ChatServer::handleHistoryCommand(ConnectionHdl hdl, const std::string& content) {
+    if (std::string_view(content).compare(0, kHistoryCommand.size(), kHistoryCommand) != 0) {
+        return false;
+    }
+    HistoryQuery query;
+    if (!historyHandler || !parseHistoryQuery(content, query)) {
+        CHAT_LOG_THROTTLED(LogLevel::Warn, "query", "Ignoring history command: malformed query");
+        return true;
+    }
+    if (!isInRoom(hdl, query.room)) {
+        CHAT_LOG_THROTTLED(LogLevel::Warn, "query", "Ignoring history command: requester is not in room " + query.room);
+        return true;
+    }
+
+    submitQuery([this, hdl, query]() {
+        HistoryQueryResult result = historyHandler(query);
+        sendReply(hdl, result.entries, makeHistoryEndMessage(query, result));
+    });
+    return true;
+}
+
+/**
+ * @brief 处理全文检索命令
+ * 
+ * 与历史查询相同，只能检索本连接已加入的房间，在查询线程中执行，结果只发给请求的连接
+ * 
+ * @param hdl 连接句柄
+ * @param content 消息内容
+ * @return 内容是全文检索命令时返回true
+ */
+bool ChatServer::handleSearchCommand(ConnectionHdl hdl, const std::string& content) {
+    if (std::string_view(content).compare(0, kSearchCommand.size(), kSearchCommand) != 0) {
+        return false;
+    }
+    SearchQuery query;
+    if (!searchHandler || !parseSearchQuery(content, query)) {
+        CHAT_LOG_THROTTLED(LogLevel::Warn, "query", "Ignoring search command: malformed query");
+        return true;
+    }
+    if (!isInRoom(hdl, query.room)) {
+        CHAT_LOG_THROTTLED(LogLevel::Warn, "query", "Ignoring search command: requester is not in room " + query.room);
+        return true;
+    }
+
+    submitQuery([this, hdl, query]() {
+        HistoryQueryResult result = searchHandler(query);
+        sendReply(hdl, result.entries, makeSearchEndMessage(query, result));
+    });
+    return true;
+}
+
+/**
+ * @brief 处理按用户查询命令
+ * 
+ * 只能查询本连接已加入的房间，在查询线程中执行，结果只发给请求的连接
+ * 
+ * @param hdl 连接句柄
+ * @param content 消息内容
+ * @return 内容是按用户查询命令时返回true
+ */
+bool ChatServer::handleUserCommand(ConnectionHdl hdl, const std::string& content) {
+    if (std::string_view(content).compare(0, kUserCommand.size(), kUserCommand) != 0) {
+        return false;
+    }
+    UserQuery query;
+    if (!userHandler || !parseUserQuery(content, query)) {
+        CHAT_LOG_THROTTLED(LogLevel::Warn, "query", "Ignoring user query: malformed query");
+        return true;
+    }
+    if (!isInRoom(hdl, query.room)) {
+        CHAT_LOG_THROTTLED(LogLevel::Warn, "query", "Ignoring user query: requester is not in room " + query.room);
+        return true;
+    }
+
+    submitQuery([this, hdl, query]() {
+        HistoryQueryResult result = userHandler(query);
+        sendReply(hdl, result.entries, makeUserEndMessage(query, result));
+    });
+    return true;
+}
+
+/**
+ * @brief 将查询放入查询线程池的队列
+ * 
+ * 队列已满时丢弃查询，请求的连接收不到回复
+ * 
+ * @param task 执行查询并发送结果的任务
+ * @return 已入队时返回true
+ */
+bool ChatServer::submitQuery(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(queryMutex);
+        if (queryStopping) {
+            return false;
+        }
+        if (queryTasks.size() >= queryOptions.queueCapacity) {
+            CHAT_LOG_THROTTLED(LogLevel::Warn, "query", "Dropping query: query queue full");
+            return false;
+        }
+        queryTasks.push_back(std::move(task));
+    }
+    queryCondition.notify_one();
+    return true;
+}
+
+/**
+ * @brief 查询线程主循环
+ * 
+ * 逐个取出查询在锁外执行，直到 stop 要求退出
+ */
+void ChatServer::runQueries() {
+    std::unique_lock<std::mutex> lock(queryMutex);
+    while (true) {
+        queryCondition.wait(lock, [this] { return queryStopping || !queryTasks.empty(); });
+        if (queryStopping) {
+            return;
+        }
+        std::function<void()> task = std::move(queryTasks.front());
+        queryTasks.pop_front();
+        lock.unlock();
         try {
-            server.send(hdl, message, websocketpp::frame::opcode::text);
+            task();
         } catch (const std::exception& e) {
-            Logger::getInstance().log("Error broadcasting message: " + std::string(e.what()));
+            CHAT_LOG_THROTTLED(LogLevel::Error, "query", "Error executing query: " + std::string(e.what()));
         }
+        lock.lock();
     }
 }
 
+/**
+ * @brief 连接是否已加入房间
+ * 
+ * @param hdl 连接句柄
+ * @param room 房间名
+ * @return 已加入时返回true
+ */
+bool ChatServer::isInRoom(ConnectionHdl hdl, const std::string& room) const {
+    std::shared_lock<std::shared_mutex> lock(connectionsMutex);
+    auto it = connections.find(hdl);
+    return it != connections.end() && it->second.rooms.count(room) > 0;
+}
+
+/**
+ * @brief 将查询结果逐条发给请求的连接，最后发送结束标记
+ * 
+ * @param hdl 连接句柄
+ * @param entries 查询结果
+ * @param end 结束标记消息
+ */
+void ChatServer::sendReply(ConnectionHdl hdl, const std::vector<HistoryEntry>& entries, const Message& end) {
+    std::shared_lock<std::shared_mutex> lock(connectionsMutex);
+    auto it = connections.find(hdl);
+    if (it == connections.end()) {
+        return;
+    }
+    for (const HistoryEntry& entry : entries) {
+        sendTo(hdl, it->second, entry.message);
+    }
+    sendTo(hdl, it->second, end);
+}
+
+/**
+ * @brief 将一条消息单独发给一个连接
+ * 
+ * 查询结果只有一个接收者，不经过共享帧，直接交给 websocketpp 分帧发送
+ * 
+ * @param hdl 连接句柄
+ * @param state 连接状态
+ * @param message 消息
+ */
+void ChatServer::sendTo(ConnectionHdl hdl, ConnectionState& state, const Message& message) {
+    ConnectionPtr con = getConnection(hdl);
+    if (!con || !admitSend(con, state)) {
+        return;
+    }
+    websocketpp::lib::error_code ec;
+    if (state.format == WireFormat::Binary) {
+        ec = con->send(message.toBinary(), websocketpp::frame::opcode::binary);
+    } else {
+        ec = con->send(message.toString(), websocketpp::frame::opcode::text);
+    }
+    if (ec) {
+        CHAT_LOG_THROTTLED(LogLevel::Error, "query", "Error sending query result: " + ec.message());
+    }
+}
+
+/**
+ * @brief 获取广播统计
+ * 
+ * @return 自服务器创建以来的广播统计
+ */
+BroadcastStats ChatServer::getBroadcastStats() const {
+    BroadcastStats stats;
+    stats.framesBuilt = framesBuilt.load(std::memory_order_relaxed);
+    stats.sharedSends = sharedSends.load(std::memory_order_relaxed);
+    stats.payloadCopies = payloadCopies.load(std::memory_order_relaxed);
+    return stats;
+}
+
 /**
  * @brief 设置消息处理回调函数
  * 
@@ -98,14 +538,85 @@ void ChatServer::setMessageCallback(std::function<void(const Message&)> callback
     messageCallback = callback;
 }
 
+/**
+ * @brief 设置下一个分配的消息编号
+ * 
+ * @param id 下一个消息编号
+ */
+void ChatServer::setNextMessageId(uint64_t id) {
+    nextMessageId.store(id);
+}
+
+/**
+ * @brief 设置历史查询处理函数
+ * 
+ * @param handler 执行查询并返回一页结果的函数
+ */
+void ChatServer::setHistoryHandler(std::function<HistoryQueryResult(const HistoryQuery&)> handler) {
+    historyHandler = handler;
+}
+
+/**
+ * @brief 设置全文检索处理函数
+ * 
+ * @param handler 执行检索并返回一页结果的函数
+ */
+void ChatServer::setSearchHandler(std::function<HistoryQueryResult(const SearchQuery&)> handler) {
+    searchHandler = handler;
+}
+
+/**
+ * @brief 设置按用户查询处理函数
+ * 
+ * @param handler 执行查询并返回一页结果的函数
+ */
+void ChatServer::setUserHandler(std::function<HistoryQueryResult(const UserQuery&)> handler) {
+    userHandler = handler;
+}
+
+/**
+ * @brief 设置查询线程池配置
+ * 
+ * @param options 查询线程池配置
+ */
+void ChatServer::setQueryOptions(const QueryOptions& options) {
+    queryOptions = options;
+}
+
+/**
+ * @brief 握手校验
+ * 
+ * 客户端请求了二进制子协议时选用之，否则不选择子协议，使用文本格式
+ * 
+ * @param hdl 连接句柄
+ * @return 始终接受连接
+ */
+bool ChatServer::onValidate(ConnectionHdl hdl) {
+    ConnectionPtr con = getConnection(hdl);
+    for (const auto& protocol : con->get_requested_subprotocols()) {
+        if (protocol == kBinarySubprotocol) {
+            con->select_subprotocol(protocol);
+            break;
+        }
+    }
+    return true;
+}
+
 /**
  * @brief 处理新的客户端连接
  * 
  * @param hdl 连接句柄
  */
 void ChatServer::onOpen(ConnectionHdl hdl) {
-    connections.insert(hdl);
-    Logger::getInstance().log("New connection established");
+    ConnectionPtr con = getConnection(hdl);
+    WireFormat format = (con->get_subprotocol() == kBinarySubprotocol) ? WireFormat::Binary : WireFormat::Text;
+    {
+        std::unique_lock<std::shared_mutex> lock(connectionsMutex);
+        ConnectionState& state = connections[hdl];
+        state.format = format;
+        joinRoom(hdl, state, kDefaultRoom);
+    }
+    CHAT_LOG_DEBUG("New connection established");
 }
 
 /**
@@ -114,45 +625,264 @@ void ChatServer::onOpen(ConnectionHdl hdl) {
  * @param hdl 连接句柄
  */
 void ChatServer::onClose(ConnectionHdl hdl) {
-    connections.erase(hdl);
-    Logger::getInstance().log("Connection closed");
+    {
+        std::unique_lock<std::shared_mutex> lock(connectionsMutex);
+        auto it = connections.find(hdl);
+        if (it != connections.end()) {
+            // 拷贝房间列表，leaveRoom 会修改 state.rooms
+            std::set<std::string> joined = it->second.rooms;
+            for (const auto& room : joined) {
+                leaveRoom(hdl, it->second, room);
+            }
+            connections.erase(it);
+        }
+    }
+    CHAT_LOG_DEBUG("Connection closed");
 }
 
 /**
  * @brief 处理接收到的消息
  * 
- * 解析消息并调用回调函数
+ * 按帧的操作码选择二进制或文本解析；房间命令直接处理，
+ * 普通消息确定房间、打上服务器接收时间并分配消息编号后调用回调函数，再广播给房间订阅者
  * 
  * @param hdl 连接句柄
  * @param msg 消息内容
  */
 void ChatServer::onMessage(ConnectionHdl hdl, WebSocketServer::message_ptr msg) {
+    // 同一连接的处理函数串行执行，连接状态只会被该连接自己的关闭回调移除，
+    // 或由 stop() 在所有 I/O 线程退出后清空，因此本函数返回前状态一直有效，
+    // 可以在锁外把消息解析进该连接的复用缓冲，稳定后解析不再分配内存
+    ConnectionState* state;
+    {
+        std::shared_lock<std::shared_mutex> lock(connectionsMutex);
+        auto it = connections.find(hdl);
+        if (it == connections.end()) {
+            return;
+        }
+        state = &it->second;
+    }
+    Message& message = state->scratch;
+    ParseError error = (msg->get_opcode() == websocketpp::frame::opcode::binary)
+        ? Message::parseBinary(msg->get_payload(), message)
+        : Message::parse(msg->get_payload(), message);
+    if (error != ParseError::None) {
+        CHAT_LOG_THROTTLED(LogLevel::Error, "message",
+                           "Error processing message: Invalid message format: " +
+                           std::string(parseErrorMessage(error)));
+        return;
+    }
+
     try {
-        Message message = Message::fromString(msg->get_payload());
-        
+        if (handleRoomCommand(hdl, message.content) || handleHistoryCommand(hdl, message.content) ||
+            handleSearchCommand(hdl, message.content) || handleUserCommand(hdl, message.content)) {
+            return;
+        }
+
+        // 确定消息所属房间：未指定时使用连接的当前房间，且发送者必须已加入该房间
+        {
+            std::shared_lock<std::shared_mutex> lock(connectionsMutex);
+            if (message.room.empty()) {
+                message.room = state->currentRoom;
+            }
+            if (state->rooms.count(message.room) == 0) {
+                CHAT_LOG_THROTTLED(LogLevel::Error, "message",
+                                   "Error processing message: sender is not in room " + message.room);
+                return;
+            }
+        }
+
         // 打印接收到的消息
-        std::cout << "\n[新消息] " << message.username << ": " << message.content << std::endl;
+        std::cout << "\n[新消息] [" << message.room << "] " << message.username << ": "
+                  << message.content << std::endl;
         
+        // 以服务器收到消息的时间为准：日志的滚动和时间索引都依赖它大致递增，
+        // 客户端时钟不可信
+        message.timestamp = std::time(nullptr);
+        message.id = nextMessageId++;
+        CHAT_BLOG_INFO("message #{} room={} user={} bytes={}", message.id, message.room, message.username,
+                       message.content.size());
         if (messageCallback) {
             messageCallback(message);
         }
-        broadcast(message.toString());
+        broadcast(message);
     } catch (const std::exception& e) {
-        Logger::getInstance().log("Error processing message: " + std::string(e.what()));
+        CHAT_LOG_THROTTLED(LogLevel::Error, "message", "Error processing message: " + std::string(e.what()));
     }
 }
 
 /**
- * @brief 运行服务器事件循环
+ * @brief 将负载一次性分帧
+ * 
+ * 服务器发往客户端的帧不加掩码，因此同一负载在所有 RFC 6455 连接上的
+ * 帧头完全相同。这里直接写好帧头并标记为 prepared，websocketpp 发送时
+ * 会跳过逐连接的分帧和负载拷贝，只把缓冲区的引用放入各连接的写队列。
+ * 
+ * @param payload 消息负载
+ * @param opcode 帧类型
+ * @return 已完成分帧的消息
+ */
+MessagePtr ChatServer::prepareFrame(const std::string& payload, websocketpp::frame::opcode::value opcode) {
+    using MessageType = MessagePtr::element_type;
+    MessagePtr frame = std::make_shared<MessageType>(MessageType::con_msg_man_ptr(), opcode, 0);
+    frame->set_payload(payload);
+
+    websocketpp::frame::basic_header header(opcode, payload.size(), true, false);
+    websocketpp::frame::extended_header extended(payload.size());
+    frame->set_header(websocketpp::frame::prepare_header(header, extended));
+    frame->set_prepared(true);
+
+    framesBuilt.fetch_add(1, std::memory_order_relaxed);
+    return frame;
+}
+
+/**
+ * @brief 将共享帧发送给一个连接
+ * 
+ * @param hdl 连接句柄
+ * @param state 连接状态
+ * @param frame 共享帧
+ */
+void ChatServer::sendFrame(ConnectionHdl hdl, ConnectionState& state, const MessagePtr& frame) {
+    // RFC 6455 之前的协议版本分帧方式不同，无法复用预先分好的帧
+    constexpr int kRfc6455Version = 13;
+    try {
+        ConnectionPtr con = getConnection(hdl);
+        if (!con) {
+            // 连接已释放，关闭回调随后会将其移出连接表
+            return;
+        }
+        if (!admitSend(con, state)) {
+            droppedMessages.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        websocketpp::lib::error_code ec;
+        if (con->get_version() >= kRfc6455Version) {
+            ec = con->send(frame);
+            sharedSends.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            ec = con->send(frame->get_payload(), frame->get_opcode());
+            payloadCopies.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (ec) {
+            CHAT_LOG_THROTTLED(LogLevel::Error, "broadcast", "Error broadcasting message: " + ec.message());
+        }
+    } catch (const std::exception& e) {
+        CHAT_LOG_THROTTLED(LogLevel::Error, "broadcast", "Error broadcasting message: " + std::string(e.what()));
+    }
+}
+
+/**
+ * @brief 根据积压更新拥塞状态
+ * 
+ * 高低水位之间保持原状态，避免在阈值附近反复切换。
+ * 需要断开的连接以 try_again_later 关闭：关闭帧排在积压数据之后，
+ * 若客户端始终不读取，websocketpp 会在关闭握手超时后直接断开套接字。
+ * 
+ * @param con 连接对象
+ * @param state 连接状态
+ * @return 可以继续发送时返回true
+ */
+bool ChatServer::admitSend(const ConnectionPtr& con, ConnectionState& state) {
+    if (state.evicting.load(std::memory_order_relaxed)) {
+        return false;
+    }
+
+    size_t buffered = con->get_buffered_amount();
+    int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+
+    bool congested = state.congested.load(std::memory_order_relaxed);
+    if (!congested && buffered >= backpressure.highWatermark) {
+        state.congestedSince.store(now, std::memory_order_relaxed);
+        state.congested.store(true, std::memory_order_relaxed);
+        congested = true;
+    } else if (congested && buffered < backpressure.lowWatermark) {
+        state.congested.store(false, std::memory_order_relaxed);
+        return true;
+    }
+    if (!congested) {
+        return true;
+    }
+
+    bool overLimit = buffered >= backpressure.hardLimit;
+    bool stalled = now - state.congestedSince.load(std::memory_order_relaxed) >= backpressure.evictAfter.count();
+    if ((overLimit || stalled) && !state.evicting.exchange(true)) {
+        evictedConnections.fetch_add(1, std::memory_order_relaxed);
+        CHAT_LOG_THROTTLED(LogLevel::Warn, "backpressure",
+                           "Evicting slow consumer with " + std::to_string(buffered) + " bytes buffered");
+        websocketpp::lib::error_code ec;
+        con->close(websocketpp::close::status::try_again_later, "Slow consumer", ec);
+    }
+    return false;
+}
+
+/**
+ * @brief 设置慢消费者背压配置
+ * 
+ * @param options 背压配置
+ */
+void ChatServer::setBackpressureOptions(const BackpressureOptions& options) {
+    // 广播在读锁下读取配置，这里持有写锁
+    std::unique_lock<std::shared_mutex> lock(connectionsMutex);
+    backpressure = options;
+}
+
+/**
+ * @brief 获取出站队列统计
+ * 
+ * @return 出站队列统计
+ */
+OutboundStats ChatServer::getOutboundStats() const {
+    OutboundStats stats;
+    stats.droppedMessages = droppedMessages.load(std::memory_order_relaxed);
+    stats.evictedConnections = evictedConnections.load(std::memory_order_relaxed);
+
+    std::shared_lock<std::shared_mutex> lock(connectionsMutex);
+    stats.connections = connections.size();
+    for (const auto& entry : connections) {
+        websocketpp::lib::error_code ec;
+        ConnectionPtr con = shards.front()->get_con_from_hdl(entry.first, ec);
+        if (!con) {
+            continue;
+        }
+        size_t buffered = con->get_buffered_amount();
+        stats.bufferedBytes += buffered;
+        stats.maxBufferedBytes = std::max(stats.maxBufferedBytes, buffered);
+        if (entry.second.congested.load(std::memory_order_relaxed)) {
+            stats.congestedConnections++;
+        }
+    }
+    return stats;
+}
+
+/**
+ * @brief 由连接句柄获取连接对象
+ * 
+ * websocketpp 的 get_con_from_hdl 只做句柄到连接类型的转换，与端点无关，
+ * 因此可以用任一分片取得其他分片的连接
+ * 
+ * @param hdl 连接句柄
+ * @return 连接对象，连接已释放时为空
+ */
+ConnectionPtr ChatServer::getConnection(ConnectionHdl hdl) {
+    websocketpp::lib::error_code ec;
+    return shards.front()->get_con_from_hdl(hdl, ec);
+}
+
+/**
+ * @brief 运行一个分片的事件循环
  * 
  * 处理WebSocket事件
+ * 
+ * @param shard 要运行的分片端点
  */
-void ChatServer::run() {
+void ChatServer::run(WebSocketServer& shard) {
     try {
-        server.run();
+        shard.run();
     } catch (const std::exception& e) {
-        Logger::getInstance().log("Server error: " + std::string(e.what()));
+        CHAT_LOG_ERROR("Server error: " + std::string(e.what()));
     }
 }
 
-} // namespace chat 
\ No newline at end of file
+} // namespace chat
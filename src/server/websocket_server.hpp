@@ -2,11 +2,23 @@
 
 #include <websocketpp/server.hpp>
 #include <websocketpp/config/asio_no_tls.hpp>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
 #include <set>
+#include <unordered_map>
 #include <memory>
 #include <functional>
 #include <string>
+#include <atomic>
+#include <vector>
+#include <thread>
+#include <shared_mutex>
+#include <chrono>
 #include "../common/message.hpp"
+#include "../common/wire_format.hpp"
+#include "history_query.hpp"
 
 namespace chat {
 
@@ -14,6 +26,57 @@ namespace chat {
 using WebSocketServer = websocketpp::server<websocketpp::config::asio>;
 using ConnectionPtr = WebSocketServer::connection_ptr;
 using ConnectionHdl = websocketpp::connection_hdl;
+using MessagePtr = WebSocketServer::message_ptr;
+
+/**
+ * @brief 广播统计
+ *
+ * sharedSends 与 payloadCopies 之和为广播涉及的接收者总数；
+ * 所有连接都使用 RFC 6455 协议时 payloadCopies 应始终为 0。
+ */
+struct BroadcastStats {
+    uint64_t framesBuilt = 0;     ///< 分帧的次数（每次广播每种编码至多一次）
+    uint64_t sharedSends = 0;     ///< 直接复用共享帧发送的次数
+    uint64_t payloadCopies = 0;   ///< 退回逐连接拷贝负载发送的次数
+};
+
+/**
+ * @brief 慢消费者背压配置
+ *
+ * 按连接统计 websocketpp 尚未写出的字节数：
+ * - 超过 highWatermark 后该连接进入拥塞状态，新的广播消息被丢弃，
+ *   直到积压回落到 lowWatermark 以下
+ * - 积压超过 hardLimit，或持续拥塞超过 evictAfter 时断开该连接
+ */
+struct BackpressureOptions {
+    size_t highWatermark = 1 << 20;                    ///< 进入拥塞状态的积压字节数
+    size_t lowWatermark = 256 << 10;                   ///< 解除拥塞状态的积压字节数
+    size_t hardLimit = 8 << 20;                        ///< 立即断开连接的积压字节数
+    std::chrono::milliseconds evictAfter{10000};       ///< 持续拥塞多久后断开连接
+};
+
+/**
+ * @brief 出站队列统计
+ */
+struct OutboundStats {
+    size_t connections = 0;            ///< 当前连接数
+    size_t bufferedBytes = 0;          ///< 所有连接积压的字节总数
+    size_t maxBufferedBytes = 0;       ///< 单个连接的最大积压字节数
+    size_t congestedConnections = 0;   ///< 处于拥塞状态的连接数
+    uint64_t droppedMessages = 0;      ///< 因拥塞丢弃的消息数
+    uint64_t evictedConnections = 0;   ///< 被断开的慢消费者数
+};
+
+/**
+ * @brief 查询线程池配置
+ *
+ * 历史查询、全文检索和按用户查询可能读取磁盘，在独立的查询线程中执行，
+ * 不占用 I/O 线程；等待执行的查询达到 queueCapacity 后新查询被丢弃
+ */
+struct QueryOptions {
+    size_t threads = 2;             ///< 查询线程数
+    size_t queueCapacity = 256;     ///< 等待执行的查询数上限
+};
 
 /**
  * @brief WebSocket聊天服务器类
@@ -23,14 +86,37 @@ using ConnectionHdl = websocketpp::connection_hdl;
  * - 广播消息给所有连接的客户端
  * - 处理客户端消息
  * - 管理连接生命周期
+ * - 通过 WebSocket 子协议协商二进制帧格式，未协商时回退到文本格式
+ * - 按房间维护订阅者集合，消息只广播给所在房间的连接
+ *
+ * 连接建立后自动加入 kDefaultRoom。客户端发送内容为 "/join 房间" 或
+ * "/leave 房间" 的消息来加入或离开房间；普通消息发往消息自带的房间，
+ * 未指定时发往该连接最近加入的房间。内容以 "/history "、"/search " 或 "/from "
+ * 开头的消息是历史查询、全文检索和按用户查询，结果只发给请求的连接，
+ * 详见 HistoryQuery、SearchQuery 和 UserQuery。查询交给查询线程池执行，
+ * 磁盘读取不会阻塞同一 I/O 线程上的其他连接。
+ *
+ * 多个 I/O 线程共同运行同一个 io_service；websocketpp 的多线程 ASIO 配置
+ * 为每个连接使用独立的 strand，同一连接的处理函数始终串行执行。
+ * 连接表和房间表由同一个读写锁保护，广播持有读锁，连接建立/断开和
+ * 加入/离开房间持有写锁。
+ *
+ * 广播前检查每个连接的出站积压，按 BackpressureOptions 丢弃消息或断开慢消费者，
+ * 单个卡住的客户端不会让服务器内存无限增长。
+ *
+ * 分片监听模式下，服务器创建多个 websocketpp 端点，每个端点拥有独立的
+ * io_service 和线程，并以 SO_REUSEPORT 监听同一端口，由内核在各监听套接字间
+ * 分配新连接。所有分片共享同一个连接表，广播覆盖全部分片的连接。
  */
 class ChatServer {
 public:
     /**
      * @brief 构造函数
      * @param port 服务器监听端口
+     * @param ioThreads 运行事件循环的线程总数，0 表示使用硬件并发数
+     * @param listenerShards 监听分片数，大于 1 时使用 SO_REUSEPORT
      */
-    ChatServer(uint16_t port = 10808);
+    ChatServer(uint16_t port = 10808, size_t ioThreads = 1, size_t listenerShards = 1);
 
     /**
      * @brief 析构函数
@@ -53,19 +139,214 @@ public:
      */
     void broadcast(const std::string& message);
 
+    /**
+     * @brief 将消息广播给其所在房间的订阅者
+     *
+     * 按各连接协商的格式发送，文本和二进制编码各至多生成一次，
+     * 开销与房间大小成正比，与服务器总连接数无关
+     *
+     * @param message 要广播的消息，room 为空时发往 kDefaultRoom
+     */
+    void broadcast(const Message& message);
+
+    /**
+     * @brief 获取房间的订阅者数量
+     * @param room 房间名
+     * @return 订阅者数量，房间不存在时为 0
+     */
+    size_t getRoomSize(const std::string& room) const;
+
     /**
      * @brief 设置消息处理回调函数
      * @param callback 消息处理函数
      */
     void setMessageCallback(std::function<void(const Message&)> callback);
 
+    /**
+     * @brief 设置下一个分配的消息编号，需在 start 之前调用
+     *
+     * 启动时以持久化历史中的最大编号加一设置，重启后编号不会重复
+     *
+     * @param id 下一个消息编号
+     */
+    void setNextMessageId(uint64_t id);
+
+    /**
+     * @brief 设置历史查询处理函数
+     *
+     * 未设置时历史查询命令被忽略。处理函数在查询线程中调用，可能并发执行
+     *
+     * @param handler 执行查询并返回一页结果的函数
+     */
+    void setHistoryHandler(std::function<HistoryQueryResult(const HistoryQuery&)> handler);
+
+    /**
+     * @brief 设置全文检索处理函数
+     *
+     * 未设置时全文检索命令被忽略。处理函数在查询线程中调用，可能并发执行
+     *
+     * @param handler 执行检索并返回一页结果的函数
+     */
+    void setSearchHandler(std::function<HistoryQueryResult(const SearchQuery&)> handler);
+
+    /**
+     * @brief 设置按用户查询处理函数
+     *
+     * 未设置时按用户查询命令被忽略。处理函数在查询线程中调用，可能并发执行
+     *
+     * @param handler 执行查询并返回一页结果的函数
+     */
+    void setUserHandler(std::function<HistoryQueryResult(const UserQuery&)> handler);
+
+    /**
+     * @brief 设置查询线程池配置，需在 start 之前调用
+     * @param options 查询线程池配置
+     */
+    void setQueryOptions(const QueryOptions& options);
+
     /**
      * @brief 检查服务器是否正在运行
      * @return 如果服务器正在运行返回true，否则返回false
      */
     bool isRunning() const { return running; }
 
+    /**
+     * @brief 获取监听分片数
+     * @return 实际使用的分片数（系统不支持 SO_REUSEPORT 时为 1）
+     */
+    size_t getShardCount() const { return shards.size(); }
+
+    /**
+     * @brief 获取广播统计
+     * @return 自服务器创建以来的广播统计
+     */
+    BroadcastStats getBroadcastStats() const;
+
+    /**
+     * @brief 设置慢消费者背压配置
+     * @param options 背压配置
+     */
+    void setBackpressureOptions(const BackpressureOptions& options);
+
+    /**
+     * @brief 获取出站队列统计
+     *
+     * 遍历所有连接读取当前积压，用于监控和调整水位
+     *
+     * @return 出站队列统计
+     */
+    OutboundStats getOutboundStats() const;
+
 private:
+    /**
+     * @brief 每个连接的状态
+     */
+    struct ConnectionState {
+        WireFormat format = WireFormat::Text;  ///< 协商出的编码格式
+        std::set<std::string> rooms;           ///< 已加入的房间
+        std::string currentRoom;               ///< 未指定房间的消息发往的房间
+        // 背压状态在持有读锁的广播中更新，因此使用原子变量
+        std::atomic<bool> congested{false};    ///< 是否处于拥塞状态
+        std::atomic<int64_t> congestedSince{0};  ///< 进入拥塞状态的时刻（steady_clock 毫秒）
+        std::atomic<bool> evicting{false};     ///< 是否已发起断开
+        // 只在该连接的 strand 上使用，字符串的容量在消息之间保留
+        Message scratch{"", ""};               ///< 解析收到的消息的复用缓冲
+    };
+
+    /// 房间订阅者集合：连接句柄到其状态（指向 connections 中的节点）
+    using Subscribers = std::map<ConnectionHdl, ConnectionState*, std::owner_less<ConnectionHdl>>;
+
+    /**
+     * @brief 将连接加入房间（调用方需持有写锁）
+     * @param hdl 连接句柄
+     * @param state 连接状态
+     * @param room 房间名
+     */
+    void joinRoom(ConnectionHdl hdl, ConnectionState& state, const std::string& room);
+
+    /**
+     * @brief 将连接移出房间（调用方需持有写锁）
+     * @param hdl 连接句柄
+     * @param state 连接状态
+     * @param room 房间名
+     */
+    void leaveRoom(ConnectionHdl hdl, ConnectionState& state, const std::string& room);
+
+    /**
+     * @brief 处理 /join 和 /leave 房间命令
+     * @param hdl 连接句柄
+     * @param content 消息内容
+     * @return 内容是房间命令时返回true
+     */
+    bool handleRoomCommand(ConnectionHdl hdl, const std::string& content);
+
+    /**
+     * @brief 处理 /history 历史查询命令
+     * @param hdl 连接句柄
+     * @param content 消息内容
+     * @return 内容是历史查询命令时返回true
+     */
+    bool handleHistoryCommand(ConnectionHdl hdl, const std::string& content);
+
+    /**
+     * @brief 处理 /search 全文检索命令
+     * @param hdl 连接句柄
+     * @param content 消息内容
+     * @return 内容是全文检索命令时返回true
+     */
+    bool handleSearchCommand(ConnectionHdl hdl, const std::string& content);
+
+    /**
+     * @brief 处理 /from 按用户查询命令
+     * @param hdl 连接句柄
+     * @param content 消息内容
+     * @return 内容是按用户查询命令时返回true
+     */
+    bool handleUserCommand(ConnectionHdl hdl, const std::string& content);
+
+    /**
+     * @brief 将查询放入查询线程池的队列
+     * @param task 执行查询并发送结果的任务
+     * @return 队列已满或服务器正在停止时返回false，任务被丢弃
+     */
+    bool submitQuery(std::function<void()> task);
+
+    /**
+     * @brief 查询线程主循环
+     */
+    void runQueries();
+
+    /**
+     * @brief 连接是否已加入房间
+     * @param hdl 连接句柄
+     * @param room 房间名
+     * @return 已加入时返回true
+     */
+    bool isInRoom(ConnectionHdl hdl, const std::string& room) const;
+
+    /**
+     * @brief 将查询结果逐条发给请求的连接，最后发送结束标记
+     * @param hdl 连接句柄
+     * @param entries 查询结果
+     * @param end 结束标记消息
+     */
+    void sendReply(ConnectionHdl hdl, const std::vector<HistoryEntry>& entries, const Message& end);
+
+    /**
+     * @brief 将一条消息按连接协商的格式单独发给该连接（调用方需持有读锁）
+     * @param hdl 连接句柄
+     * @param state 连接状态
+     * @param message 消息
+     */
+    void sendTo(ConnectionHdl hdl, ConnectionState& state, const Message& message);
+
+    /**
+     * @brief 握手校验，选择客户端请求的子协议
+     * @param hdl 连接句柄
+     * @return 始终接受连接
+     */
+    bool onValidate(ConnectionHdl hdl);
+
     /**
      * @brief 处理新的客户端连接
      * @param hdl 连接句柄
@@ -86,14 +367,80 @@ private:
     void onMessage(ConnectionHdl hdl, WebSocketServer::message_ptr msg);
 
     /**
-     * @brief 运行服务器事件循环
+     * @brief 运行一个分片的事件循环
+     * @param shard 要运行的分片端点
+     */
+    void run(WebSocketServer& shard);
+
+    /**
+     * @brief 创建并初始化一个分片端点
+     * @param reusePort 是否在监听套接字上设置 SO_REUSEPORT
+     * @return 已设置事件处理器的端点
+     */
+    std::unique_ptr<WebSocketServer> createShard(bool reusePort);
+
+    /**
+     * @brief 由连接句柄获取连接对象
+     *
+     * 连接句柄不依赖于所属端点，任意分片的连接都可通过本函数取得
+     *
+     * @param hdl 连接句柄
+     * @return 连接对象
+     */
+    ConnectionPtr getConnection(ConnectionHdl hdl);
+
+    /**
+     * @brief 将负载一次性分帧为可被所有连接共享的消息
+     * @param payload 消息负载
+     * @param opcode 帧类型
+     * @return 已完成分帧（prepared）的消息
+     */
+    MessagePtr prepareFrame(const std::string& payload, websocketpp::frame::opcode::value opcode);
+
+    /**
+     * @brief 将共享帧发送给一个连接
+     *
+     * 发送前按背压配置检查连接积压；不支持 RFC 6455 分帧的旧协议连接
+     * 退回到逐连接拷贝发送
+     *
+     * @param hdl 连接句柄
+     * @param state 连接状态
+     * @param frame 共享帧
+     */
+    void sendFrame(ConnectionHdl hdl, ConnectionState& state, const MessagePtr& frame);
+
+    /**
+     * @brief 根据积压更新拥塞状态
+     * @param con 连接对象
+     * @param state 连接状态
+     * @return 可以继续发送时返回true，需要丢弃消息时返回false
      */
-    void run();
+    bool admitSend(const ConnectionPtr& con, ConnectionState& state);
 
-    WebSocketServer server;                    ///< WebSocket服务器实例
-    std::set<ConnectionHdl, std::owner_less<ConnectionHdl>> connections;  ///< 当前连接的客户端集合
+    std::vector<std::unique_ptr<WebSocketServer>> shards;  ///< 监听分片，每个分片拥有独立的事件循环
+    std::map<ConnectionHdl, ConnectionState, std::owner_less<ConnectionHdl>> connections;  ///< 当前连接的客户端及其状态
+    std::unordered_map<std::string, Subscribers> rooms;  ///< 房间名到订阅者集合
+    mutable std::shared_mutex connectionsMutex;  ///< 保护 connections 和 rooms 的读写锁
+    std::vector<std::thread> ioThreads;       ///< 运行事件循环的线程池
+    size_t ioThreadCount;                     ///< 线程池大小（所有分片合计）
+    std::atomic<uint64_t> nextMessageId{1};   ///< 下一个分配的消息编号
+    std::atomic<uint64_t> framesBuilt{0};     ///< 分帧次数
+    std::atomic<uint64_t> sharedSends{0};     ///< 共享帧发送次数
+    std::atomic<uint64_t> payloadCopies{0};   ///< 逐连接拷贝发送次数
+    BackpressureOptions backpressure;         ///< 背压配置
+    std::atomic<uint64_t> droppedMessages{0};  ///< 因拥塞丢弃的消息数
+    std::atomic<uint64_t> evictedConnections{0};  ///< 被断开的慢消费者数
     std::function<void(const Message&)> messageCallback;  ///< 消息处理回调函数
-    bool running;                             ///< 服务器运行状态
+    std::function<HistoryQueryResult(const HistoryQuery&)> historyHandler;  ///< 历史查询处理函数
+    std::function<HistoryQueryResult(const SearchQuery&)> searchHandler;    ///< 全文检索处理函数
+    std::function<HistoryQueryResult(const UserQuery&)> userHandler;        ///< 按用户查询处理函数
+    QueryOptions queryOptions;                ///< 查询线程池配置
+    std::vector<std::thread> queryThreads;    ///< 执行查询的线程池
+    std::deque<std::function<void()>> queryTasks;  ///< 等待执行的查询
+    std::mutex queryMutex;                    ///< 保护 queryTasks 和 queryStopping
+    std::condition_variable queryCondition;   ///< 唤醒查询线程
+    bool queryStopping = false;               ///< 查询线程是否应退出
+    std::atomic<bool> running;                ///< 服务器运行状态
     uint16_t port;                           ///< 服务器监听端口
 };
 
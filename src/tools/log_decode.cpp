@@ -0,0 +1,31 @@
+#include "../common/binary_log.hpp"
+#include "../common/file_util.hpp"
+#include <iostream>
+#include <string>
+
+using namespace chat;
+
+/**
+ * @brief 将 BinaryLogger 写出的二进制日志解码为文本，输出到标准输出
+ *
+ * 用法：log_decode <binary_log_file>
+ *
+ * @return 成功返回0；文件无法读取或内容损坏时返回1（损坏之前的记录仍会输出）
+ */
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::cerr << "Usage: " << argv[0] << " <binary_log_file>" << std::endl;
+        return 1;
+    }
+    std::string data;
+    if (!readFile(argv[1], data)) {
+        std::cerr << "Failed to read " << argv[1] << std::endl;
+        return 1;
+    }
+    if (!decodeBinaryLog(data, std::cout)) {
+        std::cout.flush();
+        std::cerr << "Corrupt or truncated binary log: " << argv[1] << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,147 @@
+#include <gtest/gtest.h>
+#include "../src/common/binary_log.hpp"
+#include "../src/common/file_util.hpp"
+#include <cstdio>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+using namespace chat;
+
+class BinaryLogTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        std::remove(testLogFile.c_str());
+    }
+
+    void TearDown() override {
+        BinaryLogger::getInstance().close();
+        Logger::getInstance().setLevel(LogLevel::Info);
+        std::remove(testLogFile.c_str());
+    }
+
+    /**
+     * @brief 解码日志文件，返回各行
+     */
+    std::vector<std::string> decodeLines(bool* complete = nullptr) {
+        std::string data;
+        EXPECT_TRUE(readFile(testLogFile, data));
+        std::ostringstream out;
+        bool ok = decodeBinaryLog(data, out);
+        if (complete) {
+            *complete = ok;
+        }
+        std::vector<std::string> lines;
+        std::istringstream in(out.str());
+        for (std::string line; std::getline(in, line);) {
+            lines.push_back(line);
+        }
+        return lines;
+    }
+
+    std::string testLogFile = "test_binary_log.blog";
+};
+
+// 测试各类参数的记录与解码
+TEST_F(BinaryLogTest, EncodesAndDecodesArguments) {
+    ASSERT_TRUE(BinaryLogger::getInstance().open(testLogFile));
+    std::string room = "lobby";
+    auto when = std::chrono::system_clock::from_time_t(1700000000) + std::chrono::microseconds(250);
+    CHAT_BLOG_INFO("server ready");
+    CHAT_BLOG_INFO("message #{} room={} user={} bytes={}", uint64_t(42), room, "alice", size_t(17));
+    CHAT_BLOG_WARN("delta={} ratio={} ok={}", -5, 0.5, true);
+    CHAT_BLOG_ERROR("at {}", when);
+    CHAT_BLOG_DEBUG("debug is disabled {}", 1);
+    CHAT_BLOG_INFO("long {}", std::string(5000, 'x'));
+    BinaryLogger::getInstance().close();
+
+    bool complete = false;
+    std::vector<std::string> lines = decodeLines(&complete);
+    EXPECT_TRUE(complete);
+    ASSERT_EQ(lines.size(), 5u);
+    // [YYYY-MM-DD HH:MM:SS.ffffff] [LEVEL] message
+    EXPECT_EQ(lines[0].substr(28), " [INFO] server ready");
+    EXPECT_EQ(lines[1].substr(28), " [INFO] message #42 room=lobby user=alice bytes=17");
+    EXPECT_EQ(lines[2].substr(28), " [WARN] delta=-5 ratio=0.5 ok=1");
+    EXPECT_NE(lines[3].find(" [ERROR] at "), std::string::npos);
+    EXPECT_NE(lines[3].find(".000250"), std::string::npos);
+    EXPECT_EQ(lines[4].size(), 28u + std::string(" [INFO] long ").size() + BinaryLogger::kMaxStringBytes);
+
+    BinaryLogStats stats = BinaryLogger::getInstance().getStats();
+    EXPECT_EQ(stats.written, stats.logged);
+    EXPECT_EQ(stats.dropped, 0u);
+}
+
+// 测试多线程记录、退出线程的缓冲和 flush
+TEST_F(BinaryLogTest, MultiThreadedAndFlush) {
+    BinaryLogOptions options;
+    options.bufferBytes = 4096;
+    options.pollInterval = std::chrono::milliseconds(1);
+    ASSERT_TRUE(BinaryLogger::getInstance().open(testLogFile, options));
+    BinaryLogStats before = BinaryLogger::getInstance().getStats();
+
+    const int numThreads = 4;
+    const int messagesPerThread = 2000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < numThreads; ++t) {
+        threads.emplace_back([t]() {
+            for (int i = 0; i < messagesPerThread; ++i) {
+                CHAT_BLOG_INFO("thread {} message {} of {}", t, i, std::string("payload"));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    BinaryLogger::getInstance().flush();
+
+    BinaryLogStats stats = BinaryLogger::getInstance().getStats();
+    uint64_t logged = stats.logged - before.logged;
+    uint64_t dropped = stats.dropped - before.dropped;
+    EXPECT_EQ(logged + dropped, static_cast<uint64_t>(numThreads * messagesPerThread));
+    std::vector<std::string> lines = decodeLines();
+    EXPECT_EQ(lines.size(), logged);
+    EXPECT_EQ(stats.threads, before.threads);
+}
+
+// 测试不调用 flush 时记录也会按 flushInterval 写入文件
+TEST_F(BinaryLogTest, WritesPeriodically) {
+    BinaryLogOptions options;
+    options.pollInterval = std::chrono::milliseconds(1);
+    options.flushInterval = std::chrono::milliseconds(20);
+    ASSERT_TRUE(BinaryLogger::getInstance().open(testLogFile, options));
+    CHAT_BLOG_INFO("quiet server {}", 1);
+
+    std::vector<std::string> lines;
+    for (int i = 0; i < 500 && lines.empty(); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        lines = decodeLines();
+    }
+    ASSERT_EQ(lines.size(), 1u);
+    EXPECT_EQ(lines[0].substr(28), " [INFO] quiet server 1");
+}
+
+// 测试文件追加多个会话，以及损坏数据的检测
+TEST_F(BinaryLogTest, AppendsSessionsAndDetectsCorruption) {
+    ASSERT_TRUE(BinaryLogger::getInstance().open(testLogFile));
+    CHAT_BLOG_INFO("first session {}", 1);
+    ASSERT_TRUE(BinaryLogger::getInstance().open(testLogFile));
+    CHAT_BLOG_INFO("second session {}", 2);
+    Logger::getInstance().setLevel(LogLevel::Warn);
+    CHAT_BLOG_INFO("filtered by level {}", 3);
+    BinaryLogger::getInstance().close();
+    CHAT_BLOG_ERROR("logger closed {}", 4);
+
+    bool complete = false;
+    std::vector<std::string> lines = decodeLines(&complete);
+    EXPECT_TRUE(complete);
+    ASSERT_EQ(lines.size(), 2u);
+    EXPECT_EQ(lines[0].substr(28), " [INFO] first session 1");
+    EXPECT_EQ(lines[1].substr(28), " [INFO] second session 2");
+
+    std::string data;
+    ASSERT_TRUE(readFile(testLogFile, data));
+    std::ostringstream out;
+    EXPECT_FALSE(decodeBinaryLog(data.substr(0, data.size() - 1), out));
+    EXPECT_FALSE(decodeBinaryLog("garbage", out));
+}
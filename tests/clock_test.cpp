@@ -0,0 +1,84 @@
+#include <gtest/gtest.h>
+#include "../src/common/clock.hpp"
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace chat;
+
+namespace {
+
+// 使用 strftime/localtime_r 的参考实现
+std::string referenceFormat(time_t timestamp) {
+    char timeStr[20];
+    std::tm tm = {};
+    localtime_r(&timestamp, &tm);
+    std::strftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M:%S", &tm);
+    return timeStr;
+}
+
+} // namespace
+
+// 测试格式化结果与 strftime 一致
+TEST(ClockTest, MatchesStrftime) {
+    time_t now = std::time(nullptr);
+    EXPECT_EQ(std::string(Clock::format(now)), referenceFormat(now));
+    EXPECT_EQ(Clock::format(now).size(), Clock::kTimeStringLength);
+}
+
+// 测试跨越一整年（含闰年、月末和夏令时切换）的时间戳
+TEST(ClockTest, MatchesStrftimeAcrossYear) {
+    // 2024-01-01 00:00:00 UTC 起，以不规则步长覆盖一年
+    time_t start = 1704067200;
+    for (time_t t = start; t < start + 366 * 24 * 3600; t += 3599) {
+        ASSERT_EQ(std::string(Clock::format(t)), referenceFormat(t)) << "timestamp " << t;
+    }
+}
+
+// 测试 1970 年之前和远期的时间戳
+TEST(ClockTest, MatchesStrftimeOutsideCommonRange) {
+    std::vector<time_t> samples = {0, -1, -86400 * 365, 951782400, 4102444800};
+    for (time_t t : samples) {
+        EXPECT_EQ(std::string(Clock::format(t)), referenceFormat(t)) << "timestamp " << t;
+    }
+}
+
+// 测试同一秒内重复调用命中缓存
+TEST(ClockTest, SameSecondReturnsCachedBuffer) {
+    time_t now = std::time(nullptr);
+    std::string_view first = Clock::format(now);
+    std::string_view second = Clock::format(now);
+    EXPECT_EQ(first.data(), second.data());
+    EXPECT_EQ(first, second);
+}
+
+// 测试各线程拥有独立缓存
+TEST(ClockTest, ThreadLocalCache) {
+    time_t base = 1710945000;
+    std::vector<std::thread> threads;
+    std::vector<int> mismatches(4, 0);
+    for (int i = 0; i < 4; ++i) {
+        threads.emplace_back([i, base, &mismatches]() {
+            for (int j = 0; j < 1000; ++j) {
+                time_t t = base + i * 100000 + j;
+                if (std::string(Clock::format(t)) != referenceFormat(t)) {
+                    mismatches[i]++;
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (int count : mismatches) {
+        EXPECT_EQ(count, 0);
+    }
+}
+
+// 测试时区偏移与 localtime_r 一致
+TEST(ClockTest, UtcOffset) {
+    time_t now = std::time(nullptr);
+    std::tm tm = {};
+    localtime_r(&now, &tm);
+    EXPECT_EQ(Clock::utcOffset(now), tm.tm_gmtoff);
+}
@@ -0,0 +1,101 @@
+#include <gtest/gtest.h>
+#include "../src/server/history_loader.hpp"
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+using namespace chat;
+
+class HistoryLoaderTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        testHistoryFile = "test_history_loader.txt";
+        std::filesystem::remove(testHistoryFile);
+    }
+
+    void TearDown() override {
+        std::filesystem::remove(testHistoryFile);
+    }
+
+    // 将消息格式化为一行文本历史记录并追加到缓冲区
+    static void appendHistoryLine(const Message& message, std::string& out) {
+        out.append(message.room).push_back('\t');
+        out.append(message.toString()).push_back('\n');
+    }
+
+    std::string testHistoryFile;
+};
+
+// 测试历史记录行的格式化和解析
+TEST_F(HistoryLoaderTest, HistoryLineRoundTrip) {
+    Message msg("alice", "hello");
+    msg.room = "dev";
+    std::string line;
+    appendHistoryLine(msg, line);
+    ASSERT_EQ(line.back(), '\n');
+    line.pop_back();
+
+    Message parsed("", "");
+    ASSERT_EQ(parseHistoryLine(line, parsed), ParseError::None);
+    EXPECT_EQ(parsed.room, "dev");
+    EXPECT_EQ(parsed.username, "alice");
+    EXPECT_EQ(parsed.content, "hello");
+    EXPECT_EQ(parsed.timestamp, msg.timestamp);
+
+    // 没有房间前缀的旧记录归入默认房间
+    ASSERT_EQ(parseHistoryLine("bob @ hi | 2024-03-20 10:00:00", parsed), ParseError::None);
+    EXPECT_EQ(parsed.room, kDefaultRoom);
+    EXPECT_EQ(parsed.username, "bob");
+}
+
+// 测试不存在的文件和空文件
+TEST_F(HistoryLoaderTest, MissingOrEmptyFile) {
+    std::vector<Message> history;
+    HistoryLoadStats stats = loadHistoryFile(testHistoryFile, history);
+    EXPECT_EQ(stats.bytes, 0u);
+    EXPECT_TRUE(history.empty());
+
+    std::ofstream(testHistoryFile).close();
+    stats = loadHistoryFile(testHistoryFile, history);
+    EXPECT_EQ(stats.lines, 0u);
+    EXPECT_TRUE(history.empty());
+}
+
+// 测试多块并行解析的结果与文件顺序一致，并统计坏记录
+TEST_F(HistoryLoaderTest, ParallelChunksKeepOrder) {
+    constexpr int kMessages = 60000;
+    {
+        std::ofstream file(testHistoryFile, std::ios::binary);
+        std::string buffer;
+        for (int i = 0; i < kMessages; ++i) {
+            Message msg("user" + std::to_string(i % 13), "message number " + std::to_string(i));
+            msg.room = i % 3 ? kDefaultRoom : "dev";
+            appendHistoryLine(msg, buffer);
+            if (i == 100) {
+                buffer += "this line is not a message\n";
+            }
+            if (i == 200) {
+                buffer += "\r\n";
+            }
+        }
+        // 最后一行没有换行符
+        buffer += "bob @ tail | 2024-03-20 10:00:00";
+        file << buffer;
+    }
+
+    std::vector<Message> history;
+    HistoryLoadStats stats = loadHistoryFile(testHistoryFile, history, 4);
+    EXPECT_GT(stats.chunks, 1u);
+    EXPECT_EQ(stats.lines, kMessages + 2u);
+    EXPECT_EQ(stats.badRecords, 1u);
+    EXPECT_EQ(stats.firstBadLine, 102u);
+    EXPECT_GT(stats.linesPerSecond(), 0.0);
+
+    ASSERT_EQ(history.size(), kMessages + 1u);
+    for (int i = 0; i < kMessages; ++i) {
+        ASSERT_EQ(history[i].content, "message number " + std::to_string(i));
+    }
+    EXPECT_EQ(history[0].room, "dev");
+    EXPECT_EQ(history[1].room, kDefaultRoom);
+    EXPECT_EQ(history.back().username, "bob");
+}
@@ -0,0 +1,329 @@
+#include <gtest/gtest.h>
+#include "../src/server/history_log.hpp"
+#include "../src/common/crc32c.hpp"
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <vector>
+
+using namespace chat;
+
+class HistoryLogTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        testHistoryDir = "test_history_log";
+        std::filesystem::remove_all(testHistoryDir);
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(testHistoryDir);
+    }
+
+    // 创建指定时间戳的消息
+    static Message makeMessage(int i, time_t timestamp) {
+        Message msg("user" + std::to_string(i % 7), "message " + std::to_string(i));
+        msg.room = i % 2 ? "dev" : kDefaultRoom;
+        msg.timestamp = timestamp;
+        return msg;
+    }
+
+    // 读取从 fromSequence 开始的全部消息
+    static std::vector<std::pair<uint64_t, Message>> readAll(const HistoryLog& log, uint64_t fromSequence = 0) {
+        std::vector<std::pair<uint64_t, Message>> result;
+        log.read(fromSequence, [&result](uint64_t sequence, const Message& message) {
+            result.emplace_back(sequence, message);
+            return true;
+        });
+        return result;
+    }
+
+    // 列出目录中的段文件
+    std::vector<std::filesystem::path> segmentFiles() const {
+        std::vector<std::filesystem::path> files;
+        for (const auto& entry : std::filesystem::directory_iterator(testHistoryDir)) {
+            if (entry.path().extension() == ".log") {
+                files.push_back(entry.path());
+            }
+        }
+        std::sort(files.begin(), files.end());
+        return files;
+    }
+
+    std::string testHistoryDir;
+};
+
+// 测试 CRC32C 标准测试向量
+TEST_F(HistoryLogTest, Crc32cKnownValues) {
+    EXPECT_EQ(crc32c("", 0), 0u);
+    EXPECT_EQ(crc32c("123456789", 9), 0xE3069283u);
+    // 分段计算与一次计算结果一致
+    EXPECT_EQ(crc32c("56789", 5, crc32c("1234", 4)), 0xE3069283u);
+    EXPECT_EQ(crc32cPortable("123456789", 9), 0xE3069283u);
+}
+
+// 测试硬件实现与可移植实现在各种长度和对齐下结果一致
+TEST_F(HistoryLogTest, Crc32cImplementationsAgree) {
+    std::string data(1024, '\0');
+    uint32_t seed = 12345;
+    for (char& c : data) {
+        seed = seed * 1103515245 + 12345;
+        c = static_cast<char>(seed >> 16);
+    }
+    for (size_t offset = 0; offset < 8; ++offset) {
+        for (size_t length : {0, 1, 7, 8, 9, 15, 16, 63, 64, 100, 1000}) {
+            EXPECT_EQ(crc32c(data.data() + offset, length), crc32cPortable(data.data() + offset, length))
+                << "offset " << offset << " length " << length;
+        }
+    }
+}
+
+// 测试追加、刷新后读取，以及重新打开后继续分配序号
+TEST_F(HistoryLogTest, AppendAndReopen) {
+    {
+        HistoryLog log(testHistoryDir);
+        for (int i = 0; i < 100; ++i) {
+            EXPECT_EQ(log.append(makeMessage(i, 1700000000 + i)), static_cast<uint64_t>(i));
+        }
+        // 未 flush 的记录不可见
+        EXPECT_TRUE(readAll(log).empty());
+        ASSERT_TRUE(log.flush());
+        EXPECT_EQ(log.nextSequence(), 100u);
+    }
+
+    HistoryLog log(testHistoryDir);
+    EXPECT_EQ(log.truncatedBytes(), 0u);
+    EXPECT_EQ(log.nextSequence(), 100u);
+    auto records = readAll(log, 40);
+    ASSERT_EQ(records.size(), 60u);
+    EXPECT_EQ(records.front().first, 40u);
+    EXPECT_EQ(records.front().second.content, "message 40");
+    EXPECT_EQ(records.front().second.room, kDefaultRoom);
+    EXPECT_EQ(records[1].second.room, "dev");
+    EXPECT_EQ(records.back().second.timestamp, 1700000099);
+
+    EXPECT_EQ(log.append(makeMessage(100, 1700000100)), 100u);
+    log.flush();
+    EXPECT_EQ(readAll(log).size(), 101u);
+}
+
+// 测试按大小和时间滚动段，跨段读取和按时间定位
+TEST_F(HistoryLogTest, RollsSegmentsAndSeeks) {
+    HistoryLogOptions options;
+    options.segmentBytes = 1024;
+    options.indexIntervalBytes = 128;
+    HistoryLog log(testHistoryDir, options);
+    for (int i = 0; i < 200; ++i) {
+        log.append(makeMessage(i, 1700000000 + i));
+    }
+    log.flush();
+    EXPECT_GT(log.segmentCount(), 5u);
+    EXPECT_EQ(readAll(log).size(), 200u);
+
+    auto records = readAll(log, 123);
+    ASSERT_FALSE(records.empty());
+    EXPECT_EQ(records.front().first, 123u);
+    EXPECT_EQ(records.size(), 77u);
+
+    EXPECT_EQ(log.findSequenceAt(1700000150), 150u);
+    EXPECT_EQ(log.findSequenceAt(1600000000), 0u);
+    EXPECT_EQ(log.findSequenceAt(1800000000), log.nextSequence());
+    // 超出合理范围的时间按边界处理
+    EXPECT_EQ(log.findSequenceAt(std::numeric_limits<time_t>::max()), log.nextSequence());
+    EXPECT_EQ(log.findSequenceAt(std::numeric_limits<time_t>::min()), 0u);
+
+    std::vector<uint64_t> range;
+    log.readTimeRange(1700000010, 1700000019, [&range](uint64_t sequence, const Message&) {
+        range.push_back(sequence);
+        return true;
+    });
+    ASSERT_EQ(range.size(), 10u);
+    EXPECT_EQ(range.front(), 10u);
+    EXPECT_EQ(range.back(), 19u);
+
+    // 时间跨度超过 segmentMaxAge 时滚动
+    HistoryLogOptions ageOptions;
+    ageOptions.segmentMaxAge = std::chrono::seconds(60);
+    std::filesystem::remove_all(testHistoryDir);
+    HistoryLog aged(testHistoryDir, ageOptions);
+    aged.append(makeMessage(0, 1700000000));
+    aged.append(makeMessage(1, 1700000030));
+    aged.append(makeMessage(2, 1700000060));
+    aged.flush();
+    EXPECT_EQ(aged.segmentCount(), 2u);
+}
+
+// 测试按序号批量读取
+TEST_F(HistoryLogTest, ReadsSequences) {
+    HistoryLogOptions options;
+    options.segmentBytes = 1024;
+    options.indexIntervalBytes = 128;
+    HistoryLog log(testHistoryDir, options);
+    for (int i = 0; i < 200; ++i) {
+        log.append(makeMessage(i, 1700000000 + i));
+    }
+    log.flush();
+    ASSERT_GT(log.segmentCount(), 5u);
+
+    // 乱序、重复以及不存在的序号
+    std::vector<uint64_t> wanted = {150, 3, 77, 78, 79, 3, 199, 0, 200, 5000, 151};
+    std::vector<uint64_t> read;
+    size_t count = log.readSequences(wanted, [&read](uint64_t sequence, const Message& message) {
+        EXPECT_EQ(message.content, "message " + std::to_string(sequence));
+        read.push_back(sequence);
+        return true;
+    });
+    EXPECT_EQ(read, (std::vector<uint64_t>{0, 3, 77, 78, 79, 150, 151, 199}));
+    EXPECT_EQ(count, read.size());
+
+    // 回调返回false时停止
+    read.clear();
+    log.readSequences(wanted, [&read](uint64_t sequence, const Message&) {
+        read.push_back(sequence);
+        return read.size() < 2;
+    });
+    EXPECT_EQ(read, (std::vector<uint64_t>{0, 3}));
+
+    // 被删除的段中的序号跳过
+    log.removeSegmentsBefore(1700000100);
+    read.clear();
+    log.readSequences(wanted, [&read](uint64_t sequence, const Message&) {
+        read.push_back(sequence);
+        return true;
+    });
+    EXPECT_EQ(read, (std::vector<uint64_t>{150, 151, 199}));
+}
+
+// 测试按时间和按总字节数删除旧段
+TEST_F(HistoryLogTest, Retention) {
+    HistoryLogOptions options;
+    options.segmentBytes = 512;
+    HistoryLog log(testHistoryDir, options);
+    for (int i = 0; i < 100; ++i) {
+        log.append(makeMessage(i, 1700000000 + i));
+    }
+    log.flush();
+    size_t before = log.segmentCount();
+    ASSERT_GT(before, 2u);
+
+    size_t removed = log.removeSegmentsBefore(1700000050);
+    EXPECT_GT(removed, 0u);
+    EXPECT_EQ(log.segmentCount(), before - removed);
+    EXPECT_EQ(segmentFiles().size(), log.segmentCount());
+    // 保留的段包含截止时间之后的全部记录
+    auto records = readAll(log);
+    ASSERT_FALSE(records.empty());
+    EXPECT_LE(records.front().second.timestamp, 1700000050);
+    EXPECT_EQ(records.front().first, log.firstSequence());
+    EXPECT_EQ(records.back().first, 99u);
+
+    std::filesystem::remove_all(testHistoryDir);
+    options.retainBytes = 2048;
+    HistoryLog bounded(testHistoryDir, options);
+    for (int i = 0; i < 1000; ++i) {
+        bounded.append(makeMessage(i, 1700000000 + i));
+    }
+    bounded.flush();
+    uint64_t total = 0;
+    for (const auto& file : segmentFiles()) {
+        total += std::filesystem::file_size(file);
+    }
+    EXPECT_LE(total, 2048u + options.segmentBytes);
+    EXPECT_EQ(readAll(bounded).back().first, 999u);
+}
+
+// 测试打开时截断损坏的尾部记录
+TEST_F(HistoryLogTest, TruncatesTornTail) {
+    {
+        HistoryLog log(testHistoryDir);
+        for (int i = 0; i < 10; ++i) {
+            log.append(makeMessage(i, 1700000000 + i));
+        }
+        log.flush();
+    }
+    std::filesystem::path segment = segmentFiles().back();
+    uint64_t intactSize = std::filesystem::file_size(segment);
+    {
+        // 模拟写到一半崩溃：追加半条记录
+        std::ofstream file(segment, std::ios::binary | std::ios::app);
+        file.write("\x20\x00\x00\x00\x01\x02", 6);
+    }
+
+    {
+        HistoryLog log(testHistoryDir);
+        EXPECT_EQ(log.truncatedBytes(), 6u);
+        EXPECT_EQ(std::filesystem::file_size(segment), intactSize);
+        EXPECT_EQ(log.nextSequence(), 10u);
+        EXPECT_EQ(log.append(makeMessage(10, 1700000010)), 10u);
+        log.flush();
+        EXPECT_EQ(readAll(log).size(), 11u);
+    }
+
+    {
+        // 损坏最后一条记录的负载，校验和不再匹配
+        std::fstream file(segment, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(static_cast<std::streamoff>(std::filesystem::file_size(segment) - 1));
+        file.put('#');
+    }
+    HistoryLog log(testHistoryDir);
+    EXPECT_GT(log.truncatedBytes(), 0u);
+    EXPECT_EQ(log.nextSequence(), 10u);
+    EXPECT_EQ(readAll(log).size(), 10u);
+}
+
+// 测试索引文件丢失时从段文件重建
+TEST_F(HistoryLogTest, RebuildsMissingIndex) {
+    HistoryLogOptions options;
+    options.indexIntervalBytes = 64;
+    {
+        HistoryLog log(testHistoryDir, options);
+        for (int i = 0; i < 50; ++i) {
+            log.append(makeMessage(i, 1700000000 + i));
+        }
+        log.flush();
+    }
+    std::filesystem::path index = segmentFiles().back();
+    index.replace_extension(".idx");
+    std::filesystem::resize_file(index, 0);
+
+    HistoryLog log(testHistoryDir, options);
+    EXPECT_EQ(log.nextSequence(), 50u);
+    EXPECT_GT(std::filesystem::file_size(index), 0u);
+    EXPECT_EQ(log.findSequenceAt(1700000025), 25u);
+    EXPECT_EQ(readAll(log, 30).size(), 20u);
+}
+
+// 测试段中间的损坏记录被跳过，后续记录仍可读取
+TEST_F(HistoryLogTest, SkipsCorruptRecordInMiddle) {
+    HistoryLogOptions options;
+    options.indexIntervalBytes = 256;
+    {
+        HistoryLog log(testHistoryDir, options);
+        for (int i = 0; i < 200; ++i) {
+            log.append(makeMessage(i, 1700000000 + i));
+        }
+        log.flush();
+    }
+    {
+        // 破坏靠近段开头的一条记录
+        std::fstream file(segmentFiles().front(), std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(100);
+        file.put('#');
+    }
+
+    HistoryLog log(testHistoryDir, options);
+    EXPECT_EQ(log.truncatedBytes(), 0u);
+    auto records = readAll(log);
+    EXPECT_LT(records.size(), 200u);
+    EXPECT_GT(records.size(), 190u);
+    EXPECT_EQ(records.front().first, 0u);
+    EXPECT_EQ(records.back().first, 199u);
+    EXPECT_EQ(log.corruptRegions(), 1u);
+
+    // 批量读取跳过同样的损坏区间
+    std::vector<uint64_t> all(200);
+    for (uint64_t i = 0; i < all.size(); ++i) {
+        all[i] = i;
+    }
+    EXPECT_EQ(log.readSequences(all, [](uint64_t, const Message&) { return true; }), records.size());
+    EXPECT_EQ(log.corruptRegions(), 2u);
+}
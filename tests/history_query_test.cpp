@@ -0,0 +1,211 @@
+#include <gtest/gtest.h>
+#include "../src/server/history_query.hpp"
+#include <filesystem>
+#include <memory>
+
+using namespace chat;
+
+class HistoryQueryTest : public ::testing::Test {
+protected:
+    static constexpr time_t kStart = 1700000000;
+
+    void SetUp() override {
+        testHistoryDir = "test_history_query";
+        std::filesystem::remove_all(testHistoryDir);
+        HistoryLogOptions options;
+        options.segmentBytes = 4096;
+        options.indexIntervalBytes = 256;
+        log = std::make_unique<HistoryLog>(testHistoryDir, options);
+    }
+
+    void TearDown() override {
+        log.reset();
+        std::filesystem::remove_all(testHistoryDir);
+    }
+
+    // 写入 count 条消息，第 i 条的时间为 kStart + i，奇数条在 dev 房间
+    void fill(HistoryStore& store, int count, SearchIndex* roomIndex = nullptr) {
+        for (int i = 0; i < count; ++i) {
+            Message msg("user", "message " + std::to_string(i));
+            msg.room = i % 2 ? "dev" : kDefaultRoom;
+            msg.timestamp = kStart + i;
+            uint64_t sequence = log->append(msg);
+            log->flush();
+            if (roomIndex) {
+                roomIndex->add(sequence, msg);
+            }
+            store.append(sequence, msg);
+        }
+    }
+
+    // 解析命令，失败时测试失败
+    static HistoryQuery parse(const std::string& command) {
+        HistoryQuery query;
+        EXPECT_TRUE(parseHistoryQuery(command, query)) << command;
+        return query;
+    }
+
+    std::string testHistoryDir;
+    std::unique_ptr<HistoryLog> log;
+};
+
+// 测试命令解析
+TEST_F(HistoryQueryTest, ParsesCommands) {
+    HistoryQuery query = parse("/history dev");
+    EXPECT_EQ(query.room, "dev");
+    EXPECT_EQ(query.limit, kDefaultHistoryLimit);
+    EXPECT_EQ(query.kind, HistoryQueryKind::Latest);
+
+    query = parse("/history dev 20 before 1700000100");
+    EXPECT_EQ(query.limit, 20u);
+    EXPECT_EQ(query.kind, HistoryQueryKind::Before);
+    EXPECT_EQ(query.to, 1700000100);
+
+    query = parse("/history lobby between 10 20");
+    EXPECT_EQ(query.kind, HistoryQueryKind::Between);
+    EXPECT_EQ(query.from, 10);
+    EXPECT_EQ(query.to, 20);
+
+    query = parse("/history lobby 100000 next f5-9");
+    EXPECT_EQ(query.limit, kMaxHistoryLimit);
+    EXPECT_EQ(query.kind, HistoryQueryKind::Cursor);
+    EXPECT_EQ(query.cursor, "f5-9");
+
+    for (const char* bad : {"/history", "/history ", "/history dev 0", "/history dev before",
+                            "/history dev before x", "/history dev between 20 10", "/history dev next",
+                            "/history dev later", "/history dev 5 before 1 extra", "/historydev",
+                            "/history dev before 9223372036854775807", "/history dev between 0 100000000001"}) {
+        EXPECT_FALSE(parseHistoryQuery(bad, query)) << bad;
+    }
+}
+
+// 测试最近消息和指定时间之前的消息，以游标向前翻页
+TEST_F(HistoryQueryTest, PagesBackwardWithCursor) {
+    HistoryStoreOptions options;
+    options.roomBytes = 4096;
+    HistoryStore store(*log, options);
+    fill(store, 1000);
+
+    HistoryQueryResult latest = executeHistoryQuery(store, parse("/history dev 3"));
+    ASSERT_EQ(latest.entries.size(), 3u);
+    EXPECT_EQ(latest.entries.back().message.content, "message 999");
+    EXPECT_FALSE(latest.cursor.empty());
+
+    // 时间早于 kStart + 101 的最近 50 条 dev 消息：51, 53, ..., 99
+    HistoryQuery query = parse("/history dev 50 before " + std::to_string(kStart + 101));
+    HistoryQueryResult result = executeHistoryQuery(store, query);
+    ASSERT_EQ(result.entries.size(), 50u);
+    EXPECT_EQ(result.entries.front().message.content, "message 1");
+    EXPECT_EQ(result.entries.back().message.content, "message 99");
+
+    query = parse("/history dev 30 before " + std::to_string(kStart + 101));
+    std::vector<std::string> contents;
+    for (;;) {
+        result = executeHistoryQuery(store, query);
+        for (auto it = result.entries.rbegin(); it != result.entries.rend(); ++it) {
+            contents.push_back(it->message.content);
+        }
+        if (result.cursor.empty()) {
+            break;
+        }
+        query = parse("/history dev 30 next " + result.cursor);
+    }
+    ASSERT_EQ(contents.size(), 50u);
+    EXPECT_EQ(contents.front(), "message 99");
+    EXPECT_EQ(contents.back(), "message 1");
+}
+
+// 测试时间范围查询跨越日志和内存，以游标向后翻页
+TEST_F(HistoryQueryTest, PagesForwardThroughRange) {
+    HistoryStoreOptions options;
+    options.roomBytes = 4096;
+    HistoryStore store(*log, options);
+    fill(store, 1000);
+    ASSERT_GT(store.getStats().evicted, 0u);
+
+    HistoryQuery query = parse("/history lobby 64 between " + std::to_string(kStart + 100) + " " +
+                               std::to_string(kStart + 999));
+    std::vector<HistoryEntry> all;
+    size_t pages = 0;
+    for (;;) {
+        HistoryQueryResult result = executeHistoryQuery(store, query);
+        all.insert(all.end(), result.entries.begin(), result.entries.end());
+        ++pages;
+        if (result.cursor.empty()) {
+            break;
+        }
+        query = parse("/history lobby 64 next " + result.cursor);
+    }
+    ASSERT_EQ(all.size(), 450u);
+    EXPECT_EQ(pages, 8u);
+    for (size_t i = 0; i < all.size(); ++i) {
+        ASSERT_EQ(all[i].message.content, "message " + std::to_string(100 + i * 2));
+    }
+
+    // 范围两端都包含在内
+    HistoryQueryResult exact = executeHistoryQuery(
+        store, parse("/history dev between " + std::to_string(kStart + 11) + " " + std::to_string(kStart + 15)));
+    ASSERT_EQ(exact.entries.size(), 3u);
+    EXPECT_EQ(exact.entries.front().message.content, "message 11");
+    EXPECT_EQ(exact.entries.back().message.content, "message 15");
+    EXPECT_TRUE(exact.cursor.empty());
+
+    // 范围内没有消息
+    EXPECT_TRUE(executeHistoryQuery(store, parse("/history dev between 1 2")).entries.empty());
+    // 格式错误的游标
+    EXPECT_TRUE(executeHistoryQuery(store, parse("/history dev next x12")).entries.empty());
+    EXPECT_TRUE(executeHistoryQuery(store, parse("/history dev next f12")).entries.empty());
+}
+
+// 测试配置房间索引后只读取所需的记录，以及越界游标的截断
+TEST_F(HistoryQueryTest, PagesWithRoomIndex) {
+    SearchIndexOptions indexOptions;
+    indexOptions.keys = roomIndexKeys;
+    SearchIndex roomIndex(testHistoryDir + "/rooms", *log, indexOptions);
+    HistoryStoreOptions options;
+    options.roomBytes = 4096;
+    options.roomIndex = &roomIndex;
+    HistoryStore store(*log, options);
+    fill(store, 1000, &roomIndex);
+    ASSERT_GT(store.getStats().evicted, 0u);
+    // 一部分房间索引已写成磁盘段
+    ASSERT_TRUE(roomIndex.flush());
+    fill(store, 10, &roomIndex);
+
+    HistoryPage page = store.page("dev", 101, 20);
+    ASSERT_EQ(page.entries.size(), 20u);
+    EXPECT_EQ(page.entries.front().message.content, "message 61");
+    EXPECT_EQ(page.entries.back().message.content, "message 99");
+    EXPECT_EQ(page.diskRecords, 20u);
+
+    page = store.range(kDefaultRoom, 10, 500, 30);
+    ASSERT_EQ(page.entries.size(), 30u);
+    EXPECT_EQ(page.entries.front().message.content, "message 10");
+    EXPECT_EQ(page.entries.back().message.content, "message 68");
+    EXPECT_EQ(page.diskRecords, 30u);
+
+    // 越界的游标截断到日志的序号范围，下一页游标的上界为日志末尾
+    HistoryQueryResult result = executeHistoryQuery(store, parse("/history lobby 5 next f0-99999999999999"));
+    ASSERT_EQ(result.entries.size(), 5u);
+    EXPECT_EQ(result.entries.front().message.content, "message 0");
+    EXPECT_EQ(result.cursor, "f9-1010");
+    result = executeHistoryQuery(store, parse("/history dev 2 next b99999999999999"));
+    ASSERT_EQ(result.entries.size(), 2u);
+    EXPECT_EQ(result.entries.back().message.content, "message 9");
+    EXPECT_TRUE(executeHistoryQuery(store, parse("/history dev next f2000-3000")).entries.empty());
+    EXPECT_TRUE(executeHistoryQuery(store, parse("/history dev next f500-100")).entries.empty());
+}
+
+// 测试结束标记消息
+TEST_F(HistoryQueryTest, EndMessage) {
+    HistoryQuery query = parse("/history dev 2");
+    HistoryQueryResult result;
+    result.entries.push_back({7, Message("user", "a")});
+    result.cursor = "b7";
+    Message end = makeHistoryEndMessage(query, result);
+    EXPECT_EQ(end.room, "dev");
+    EXPECT_EQ(end.content, "/history-end dev 1 b7");
+
+    result.cursor.clear();
+    EXPECT_EQ(makeHistoryEndMessage(query, result).content, "/history-end dev 1");
+}
@@ -0,0 +1,284 @@
+#include <gtest/gtest.h>
+#include "../src/server/history_store.hpp"
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <thread>
+
+using namespace chat;
+
+class HistoryStoreTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        testHistoryDir = "test_history_store";
+        std::filesystem::remove_all(testHistoryDir);
+        log = std::make_unique<HistoryLog>(testHistoryDir);
+    }
+
+    void TearDown() override {
+        log.reset();
+        std::filesystem::remove_all(testHistoryDir);
+    }
+
+    // 创建指定房间的消息
+    static Message makeMessage(const std::string& room, const std::string& content) {
+        Message msg("user", content);
+        msg.room = room;
+        return msg;
+    }
+
+    // 向历史日志写入 count 条消息，奇数条在 dev 房间
+    void fillLog(int count) {
+        for (int i = 0; i < count; ++i) {
+            log->append(makeMessage(i % 2 ? "dev" : kDefaultRoom, "persisted " + std::to_string(i)));
+        }
+        log->flush();
+    }
+
+    // 模拟写入器：先写日志，再放入内存历史
+    void persist(HistoryStore& store, const Message& msg) {
+        uint64_t sequence = log->append(msg);
+        log->flush();
+        store.append(sequence, msg);
+    }
+
+    std::string testHistoryDir;
+    std::unique_ptr<HistoryLog> log;
+};
+
+// 测试未启动预热时新消息直接由内存提供
+TEST_F(HistoryStoreTest, ServesRecentFromMemory) {
+    HistoryStore store(*log);
+    EXPECT_TRUE(store.isReady());
+    persist(store, makeMessage(kDefaultRoom, "hello"));
+    persist(store, makeMessage("dev", "other room"));
+
+    std::vector<HistoryEntry> recent = store.recent(kDefaultRoom, 10);
+    ASSERT_EQ(recent.size(), 1u);
+    EXPECT_EQ(recent[0].message.content, "hello");
+    EXPECT_EQ(store.getStats().memoryHits, 1u);
+    EXPECT_EQ(store.getStats().diskReads, 0u);
+    EXPECT_TRUE(store.recent("unknown", 10).empty());
+}
+
+// 测试按字节数限额移出旧消息，更早的消息从日志读取
+TEST_F(HistoryStoreTest, EvictsByBytesAndReadsOlderFromLog) {
+    HistoryStoreOptions options;
+    options.roomBytes = 16 * 1024;
+    options.totalBytes = 24 * 1024;
+    HistoryStore store(*log, options);
+
+    const std::string padding(100, 'x');
+    for (int i = 0; i < 2000; ++i) {
+        persist(store, makeMessage(i % 2 ? "dev" : kDefaultRoom, padding + std::to_string(i)));
+    }
+
+    HistoryStoreStats stats = store.getStats();
+    EXPECT_LE(stats.bytes, options.totalBytes);
+    EXPECT_GT(stats.evicted, 0u);
+    EXPECT_LT(stats.messages, 2000u);
+
+    // 最近的消息在内存中
+    std::vector<HistoryEntry> recent = store.recent("dev", 5);
+    ASSERT_EQ(recent.size(), 5u);
+    EXPECT_EQ(recent.back().message.content, padding + "1999");
+    EXPECT_EQ(recent.front().message.content, padding + "1991");
+
+    // 向前翻页直到最早的消息，跨越内存和磁盘，顺序和数量都正确
+    std::vector<HistoryEntry> all;
+    uint64_t before = HistoryStore::kLatest;
+    size_t diskRecords = 0;
+    for (;;) {
+        HistoryPage page = store.page(kDefaultRoom, before, 128);
+        if (page.entries.empty()) {
+            break;
+        }
+        diskRecords += page.diskRecords;
+        all.insert(all.begin(), page.entries.begin(), page.entries.end());
+        before = page.nextBefore;
+    }
+    ASSERT_EQ(all.size(), 1000u);
+    for (size_t i = 0; i < all.size(); ++i) {
+        ASSERT_EQ(all[i].message.content, padding + std::to_string(i * 2));
+        ASSERT_EQ(all[i].message.room, kDefaultRoom);
+    }
+    EXPECT_GT(diskRecords, 0u);
+    EXPECT_GT(store.getStats().diskReads, 0u);
+
+    // 内存用量稳定后插入和移出消息复用已有的槽位
+    uint64_t systemAllocations = store.getStats().payloads.systemAllocations;
+    for (int i = 0; i < 200; ++i) {
+        persist(store, makeMessage("dev", padding + "steady"));
+    }
+    EXPECT_EQ(store.getStats().payloads.systemAllocations, systemAllocations);
+}
+
+// 测试预热只读取日志末尾，预热期间的新消息排在已持久化记录之后
+TEST_F(HistoryStoreTest, WarmupThenLiveMessages) {
+    constexpr int kPersisted = 20000;
+    fillLog(kPersisted);
+
+    HistoryStoreOptions options;
+    options.totalBytes = 256 * 1024;
+    HistoryStore store(*log, options);
+    store.startWarmup();
+    for (int i = 0; i < 10; ++i) {
+        persist(store, makeMessage("dev", "live " + std::to_string(i)));
+    }
+
+    // 预热期间的查询直接读日志，结果同样完整
+    std::vector<HistoryEntry> early = store.recent("dev", 3);
+    ASSERT_EQ(early.size(), 3u);
+    EXPECT_EQ(early.back().message.content, "live 9");
+
+    ASSERT_TRUE(store.waitUntilReady(std::chrono::seconds(30)));
+    HistoryStoreStats stats = store.getStats();
+    EXPECT_LE(stats.bytes, options.totalBytes);
+    EXPECT_LT(stats.messages, static_cast<size_t>(kPersisted));
+
+    std::vector<HistoryEntry> recent = store.recent("dev", 12);
+    ASSERT_EQ(recent.size(), 12u);
+    EXPECT_EQ(recent[0].message.content, "persisted " + std::to_string(kPersisted - 3));
+    EXPECT_EQ(recent[1].message.content, "persisted " + std::to_string(kPersisted - 1));
+    EXPECT_EQ(recent[2].message.content, "live 0");
+    EXPECT_EQ(recent.back().message.content, "live 9");
+
+    // 预热范围之前的消息从日志读取
+    HistoryPage oldest = store.page(kDefaultRoom, 10, 10);
+    ASSERT_EQ(oldest.entries.size(), 5u);
+    EXPECT_EQ(oldest.entries.front().message.content, "persisted 0");
+    EXPECT_EQ(oldest.nextBefore, 0u);
+    EXPECT_TRUE(store.page(kDefaultRoom, oldest.nextBefore, 10).entries.empty());
+}
+
+// 测试预热未完成时析构能及时退出
+TEST_F(HistoryStoreTest, CancelWarmup) {
+    fillLog(50000);
+    auto store = std::make_unique<HistoryStore>(*log);
+    store->startWarmup();
+    store.reset();
+    SUCCEED();
+}
+
+// 测试快照加日志尾部重放的恢复
+TEST_F(HistoryStoreTest, SnapshotRecovery) {
+    HistoryStoreOptions options;
+    options.snapshotPath = testHistoryDir + "/snapshot.bin";
+    {
+        HistoryStore store(*log, options);
+        for (int i = 0; i < 100; ++i) {
+            persist(store, makeMessage(i % 2 ? "dev" : kDefaultRoom, "before " + std::to_string(i)));
+        }
+        ASSERT_TRUE(store.saveSnapshot());
+        // 快照之后写入的消息只在日志中
+        for (int i = 0; i < 7; ++i) {
+            persist(store, makeMessage("dev", "after " + std::to_string(i)));
+        }
+    }
+
+    HistoryStore store(*log, options);
+    store.startWarmup();
+    ASSERT_TRUE(store.waitUntilReady(std::chrono::seconds(30)));
+    HistoryRecoveryStats recovery = store.getRecoveryStats();
+    EXPECT_TRUE(recovery.fromSnapshot);
+    EXPECT_EQ(recovery.snapshotSequence, 100u);
+    EXPECT_EQ(recovery.snapshotMessages, 100u);
+    EXPECT_EQ(recovery.replayedRecords, 7u);
+
+    std::vector<HistoryEntry> recent = store.recent("dev", 9);
+    ASSERT_EQ(recent.size(), 9u);
+    EXPECT_EQ(recent[0].message.content, "before 97");
+    EXPECT_EQ(recent[1].message.content, "before 99");
+    EXPECT_EQ(recent[2].message.content, "after 0");
+    EXPECT_EQ(recent.back().message.content, "after 6");
+    EXPECT_EQ(store.getStats().diskReads, 0u);
+}
+
+// 测试用户名驻留：内存记录只保存编号，读取和快照恢复后还原出原来的消息
+TEST_F(HistoryStoreTest, InternsUsernames) {
+    HistoryStoreOptions options;
+    options.snapshotPath = testHistoryDir + "/snapshot.bin";
+    const std::vector<std::string> users = {"alice", "bob", "a-rather-long-username-beyond-sso"};
+    {
+        HistoryStore store(*log, options);
+        for (int i = 0; i < 300; ++i) {
+            Message msg = makeMessage("dev", "message " + std::to_string(i));
+            msg.username = users[i % users.size()];
+            msg.timestamp = 1700000000 + i;
+            msg.id = 1000 + i;
+            persist(store, msg);
+        }
+        HistoryStoreStats stats = store.getStats();
+        EXPECT_EQ(stats.users, users.size());
+        EXPECT_EQ(stats.messages, 300u);
+        // 用户名和房间名不再随每条消息保存
+        EXPECT_LT(stats.bytes, 300 * sizeof(Message));
+        ASSERT_TRUE(store.saveSnapshot());
+    }
+
+    HistoryStore store(*log, options);
+    store.startWarmup();
+    ASSERT_TRUE(store.waitUntilReady(std::chrono::seconds(30)));
+    EXPECT_TRUE(store.getRecoveryStats().fromSnapshot);
+    EXPECT_EQ(store.getStats().users, users.size());
+    std::vector<HistoryEntry> recent = store.recent("dev", 300);
+    ASSERT_EQ(recent.size(), 300u);
+    for (size_t i = 0; i < recent.size(); ++i) {
+        const Message& msg = recent[i].message;
+        ASSERT_EQ(msg.username, users[i % users.size()]);
+        ASSERT_EQ(msg.content, "message " + std::to_string(i));
+        ASSERT_EQ(msg.room, "dev");
+        ASSERT_EQ(msg.timestamp, static_cast<time_t>(1700000000 + i));
+        ASSERT_EQ(msg.id, 1000 + i);
+    }
+}
+
+// 测试损坏或超前于日志的快照被忽略，回退到读取日志
+TEST_F(HistoryStoreTest, RejectsBadSnapshot) {
+    HistoryStoreOptions options;
+    options.snapshotPath = testHistoryDir + "/snapshot.bin";
+    {
+        HistoryStore store(*log, options);
+        for (int i = 0; i < 20; ++i) {
+            persist(store, makeMessage(kDefaultRoom, "message " + std::to_string(i)));
+        }
+        ASSERT_TRUE(store.saveSnapshot());
+    }
+    {
+        // 翻转快照中间的一个字节
+        std::fstream file(options.snapshotPath, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(20);
+        file.put('\xff');
+    }
+    {
+        HistoryStore store(*log, options);
+        store.startWarmup();
+        ASSERT_TRUE(store.waitUntilReady(std::chrono::seconds(30)));
+        EXPECT_FALSE(store.getRecoveryStats().fromSnapshot);
+        EXPECT_EQ(store.getRecoveryStats().replayedRecords, 20u);
+        EXPECT_EQ(store.recent(kDefaultRoom, 1).back().message.content, "message 19");
+    }
+
+    // 快照覆盖的序号超过日志末尾（日志尾部在崩溃中丢失）
+    std::string otherDir = testHistoryDir + "_short";
+    std::filesystem::remove_all(otherDir);
+    {
+        HistoryLog shortLog(otherDir);
+        shortLog.append(makeMessage(kDefaultRoom, "only"));
+        shortLog.flush();
+        {
+            HistoryStore store(*log, options);
+            store.startWarmup();
+            ASSERT_TRUE(store.waitUntilReady(std::chrono::seconds(30)));
+            ASSERT_TRUE(store.saveSnapshot());
+        }
+        HistoryStore store(shortLog, options);
+        store.startWarmup();
+        ASSERT_TRUE(store.waitUntilReady(std::chrono::seconds(30)));
+        EXPECT_FALSE(store.getRecoveryStats().fromSnapshot);
+        std::vector<HistoryEntry> recent = store.recent(kDefaultRoom, 10);
+        ASSERT_EQ(recent.size(), 1u);
+        EXPECT_EQ(recent[0].message.content, "only");
+    }
+    std::filesystem::remove_all(otherDir);
+}
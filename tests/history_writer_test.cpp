@@ -0,0 +1,125 @@
+#include <gtest/gtest.h>
+#include "../src/server/history_writer.hpp"
+#include <filesystem>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace chat;
+
+class HistoryWriterTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        testHistoryDir = "test_history_writer";
+        std::filesystem::remove_all(testHistoryDir);
+        log = std::make_unique<HistoryLog>(testHistoryDir);
+    }
+
+    void TearDown() override {
+        log.reset();
+        std::filesystem::remove_all(testHistoryDir);
+    }
+
+    // 读取历史日志中的全部消息
+    std::vector<Message> readHistory() {
+        std::vector<Message> history;
+        log->read(0, [&history](uint64_t, const Message& message) {
+            history.push_back(message);
+            return true;
+        });
+        return history;
+    }
+
+    std::string testHistoryDir;
+    std::unique_ptr<HistoryLog> log;
+};
+
+// 测试 flush 后所有入队的消息都已写入
+TEST_F(HistoryWriterTest, FlushWritesAllMessages) {
+    HistoryWriter writer(*log);
+    for (int i = 0; i < 100; ++i) {
+        Message msg("user", "message " + std::to_string(i));
+        msg.room = kDefaultRoom;
+        EXPECT_TRUE(writer.enqueue(msg));
+    }
+    writer.flush();
+
+    std::vector<Message> history = readHistory();
+    ASSERT_EQ(history.size(), 100u);
+    EXPECT_EQ(history.front().content, "message 0");
+    EXPECT_EQ(history.back().content, "message 99");
+
+    HistoryWriterStats stats = writer.getStats();
+    EXPECT_EQ(stats.enqueued, 100u);
+    EXPECT_EQ(stats.written, 100u);
+    EXPECT_EQ(stats.dropped, 0u);
+    EXPECT_GE(stats.fsyncs, 1u);
+    EXPECT_LE(stats.batches, 100u);
+}
+
+// 测试多线程并发入队与组提交
+TEST_F(HistoryWriterTest, ConcurrentProducers) {
+    constexpr int kThreads = 4;
+    constexpr int kPerThread = 1000;
+    HistoryWriterOptions options;
+    options.fsyncPolicy = FsyncPolicy::Never;
+    {
+        HistoryWriter writer(*log, options);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < kThreads; ++t) {
+            threads.emplace_back([&writer, t]() {
+                for (int i = 0; i < kPerThread; ++i) {
+                    Message msg("user" + std::to_string(t), "message " + std::to_string(i));
+                    while (!writer.enqueue(msg)) {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        // 析构时写完队列中剩余的消息
+    }
+    EXPECT_EQ(readHistory().size(), static_cast<size_t>(kThreads * kPerThread));
+}
+
+// 测试队列已满时入队失败而不阻塞
+TEST_F(HistoryWriterTest, FullQueueDrops) {
+    HistoryWriterOptions options;
+    options.queueCapacity = 2;
+    HistoryWriter writer(*log, options);
+
+    int accepted = 0;
+    for (int i = 0; i < 10000; ++i) {
+        if (writer.enqueue(Message("user", "burst"))) {
+            ++accepted;
+        }
+    }
+    writer.flush();
+
+    HistoryWriterStats stats = writer.getStats();
+    EXPECT_EQ(stats.enqueued + stats.dropped, 10000u);
+    EXPECT_EQ(stats.written, static_cast<uint64_t>(accepted));
+    EXPECT_EQ(readHistory().size(), static_cast<size_t>(accepted));
+}
+
+// 测试写入回调按日志序号顺序收到已写入的消息
+TEST_F(HistoryWriterTest, PersistedCallback) {
+    std::vector<uint64_t> sequences;
+    {
+        HistoryWriter writer(*log);
+        writer.setPersistedCallback([&sequences](uint64_t sequence, const Message& message) {
+            EXPECT_EQ(message.content, "message " + std::to_string(sequence));
+            sequences.push_back(sequence);
+        });
+        for (int i = 0; i < 50; ++i) {
+            EXPECT_TRUE(writer.enqueue(Message("user", "message " + std::to_string(i))));
+        }
+        writer.flush();
+    }
+    ASSERT_EQ(sequences.size(), 50u);
+    for (size_t i = 0; i < sequences.size(); ++i) {
+        EXPECT_EQ(sequences[i], i);
+    }
+}
@@ -0,0 +1,102 @@
+#include <gtest/gtest.h>
+#include "../src/common/log_throttle.hpp"
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace chat;
+
+class LogThrottleTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        Logger::getInstance().setLogFile(testLogFile);
+    }
+
+    void TearDown() override {
+        LogThrottle::resetLimits();
+        std::remove(testLogFile.c_str());
+    }
+
+    // 日志文件的各行
+    std::vector<std::string> readLines() {
+        std::ifstream file(testLogFile);
+        std::vector<std::string> lines;
+        for (std::string line; std::getline(file, line);) {
+            lines.push_back(line);
+        }
+        return lines;
+    }
+
+    std::string testLogFile = "test_throttle_log.txt";
+};
+
+// 测试令牌桶的突发、补充以及放行时输出的汇总
+TEST_F(LogThrottleTest, TokenBucketAndSummary) {
+    constexpr int64_t kSecond = 1000000000;
+    LogThrottle::setLimit("bucket", LogRateLimit{2.0, 3});
+    static LogThrottle throttle{LogLevel::Error, "bucket", "src/server/example.cpp", 42};
+
+    int64_t start = 100 * kSecond;
+    EXPECT_TRUE(throttle.admit(start));
+    EXPECT_TRUE(throttle.admit(start));
+    EXPECT_TRUE(throttle.admit(start));
+    for (int i = 0; i < 5; ++i) {
+        EXPECT_FALSE(throttle.admit(start + i));
+    }
+    EXPECT_EQ(throttle.pendingSuppressed(), 5u);
+    EXPECT_TRUE(readLines().empty());
+
+    // 每秒补充两个令牌
+    EXPECT_TRUE(throttle.admit(start + kSecond / 2));
+    EXPECT_FALSE(throttle.admit(start + kSecond / 2));
+    EXPECT_EQ(throttle.pendingSuppressed(), 1u);
+
+    std::vector<std::string> lines = readLines();
+    ASSERT_EQ(lines.size(), 1u);
+    EXPECT_NE(lines[0].find("[ERROR] [bucket] 5 similar messages suppressed in last 0.5s (example.cpp:42)"),
+              std::string::npos);
+
+    // 修改类别参数后立即生效，不大于 0 的速率表示不限速
+    LogThrottle::setLimit("bucket", LogRateLimit{0.0, 1});
+    for (int i = 0; i < 100; ++i) {
+        EXPECT_TRUE(throttle.admit(start + kSecond / 2));
+    }
+    EXPECT_EQ(throttle.pendingSuppressed(), 0u);
+}
+
+// 测试宏在被抑制时不对消息求值，以及定期汇总
+TEST_F(LogThrottleTest, MacroSkipsSuppressedMessages) {
+    LogThrottle::setLimit("storm", LogRateLimit{0.001, 2});
+    uint64_t suppressedBefore = LogThrottle::totalSuppressed();
+    int evaluated = 0;
+    auto message = [&evaluated](int i) {
+        ++evaluated;
+        return "Error broadcasting message: " + std::to_string(i);
+    };
+    for (int i = 0; i < 1000; ++i) {
+        CHAT_LOG_THROTTLED(LogLevel::Error, "storm", message(i));
+    }
+    EXPECT_EQ(evaluated, 2);
+    EXPECT_EQ(LogThrottle::totalSuppressed() - suppressedBefore, 998u);
+
+    EXPECT_EQ(LogThrottle::reportSuppressed(), 1u);
+    EXPECT_EQ(LogThrottle::reportSuppressed(), 0u);
+    std::vector<std::string> lines = readLines();
+    ASSERT_EQ(lines.size(), 3u);
+    EXPECT_NE(lines[0].find("Error broadcasting message: 0"), std::string::npos);
+    EXPECT_NE(lines[1].find("Error broadcasting message: 1"), std::string::npos);
+    EXPECT_NE(lines[2].find("[ERROR] [storm] 998 similar messages suppressed in last "), std::string::npos);
+    EXPECT_NE(lines[2].find("(log_throttle_test.cpp:"), std::string::npos);
+
+    // 未配置的类别使用默认参数，burst 为 0 时只输出汇总
+    LogThrottle::setDefaultLimit(LogRateLimit{1.0, 0});
+    for (int i = 0; i < 10; ++i) {
+        CHAT_LOG_THROTTLED(LogLevel::Warn, "unconfigured", message(i));
+    }
+    EXPECT_EQ(evaluated, 2);
+    EXPECT_EQ(LogThrottle::reportSuppressed(), 1u);
+    lines = readLines();
+    ASSERT_EQ(lines.size(), 4u);
+    EXPECT_NE(lines[3].find("[WARN] [unconfigured] 10 similar messages suppressed"), std::string::npos);
+}
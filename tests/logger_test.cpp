@@ -1,9 +1,14 @@
 #include <gtest/gtest.h>
 #include "../src/common/logger.hpp"
+#include <algorithm>
+#include <filesystem>
 #include <fstream>
 #include <sstream>
 #include <thread>
 #include <vector>
+#ifdef CHAT_HAVE_ZLIB
+#include <zlib.h>
+#endif
 
 using namespace chat;
 
@@ -16,11 +21,54 @@ protected:
     }
 
     void TearDown() override {
+        // 恢复同步模式和默认级别，单例在各测试之间共享
+        Logger::getInstance().configure(LoggerOptions());
+        Logger::getInstance().setLevel(LogLevel::Info);
         // 清理测试文件
         std::remove(testLogFile.c_str());
     }
 
+    // 日志文件的行数
+    static int countLines(const std::string& filename) {
+        std::ifstream file(filename);
+        std::string line;
+        int count = 0;
+        while (std::getline(file, line)) {
+            ++count;
+        }
+        return count;
+    }
+
+    // 目录中除 exclude 以外的文件
+    static std::vector<std::string> listFiles(const std::string& directory, const std::string& exclude) {
+        std::vector<std::string> files;
+        for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+            if (entry.path().filename() != exclude) {
+                files.push_back(entry.path().string());
+            }
+        }
+        return files;
+    }
+
+    // 等待目录中除 exclude 以外的文件数变为 count，且文件名都以 suffix 结尾
+    static bool waitForFiles(const std::string& directory, const std::string& exclude, size_t count,
+                             const std::string& suffix = "") {
+        for (int i = 0; i < 500; ++i) {
+            std::vector<std::string> files = listFiles(directory, exclude);
+            bool pending = std::any_of(files.begin(), files.end(), [&suffix](const std::string& file) {
+                return file.find(".tmp") != std::string::npos || file.size() < suffix.size() ||
+                       file.compare(file.size() - suffix.size(), suffix.size(), suffix) != 0;
+            });
+            if (files.size() == count && !pending) {
+                return true;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return false;
+    }
+
     std::string testLogFile;
+    std::string rotationDir = "logger_rotation_test";
 };
 
 // 测试单例模式
@@ -115,4 +163,208 @@ TEST_F(LoggerTest, LogFileSwitch) {
     
     // 清理
     std::remove(newLogFile.c_str());
-} 
\ No newline at end of file
+}
+
+// 测试异步模式：多线程写入后 flush，记录完整且批量写出
+TEST_F(LoggerTest, AsyncBatchesWrites) {
+    LoggerOptions options;
+    options.mode = LogMode::Async;
+    options.flushInterval = std::chrono::seconds(10);
+    Logger::getInstance().configure(options);
+    uint64_t writesBefore = Logger::getInstance().getStats().writes;
+
+    const int numThreads = 8;
+    const int messagesPerThread = 500;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < numThreads; ++i) {
+        threads.emplace_back([i, messagesPerThread]() {
+            for (int j = 0; j < messagesPerThread; ++j) {
+                Logger::getInstance().log("Thread " + std::to_string(i) + " Message " + std::to_string(j));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    Logger::getInstance().flush();
+
+    LoggerStats stats = Logger::getInstance().getStats();
+    EXPECT_EQ(countLines(testLogFile) + static_cast<int>(stats.dropped), numThreads * messagesPerThread);
+    EXPECT_LT(stats.writes - writesBefore, static_cast<uint64_t>(numThreads * messagesPerThread / 10));
+    EXPECT_EQ(stats.queueDepth, 0u);
+}
+
+// 测试异步模式下错误记录不等 flushInterval 立即写出
+TEST_F(LoggerTest, AsyncFlushesOnError) {
+    LoggerOptions options;
+    options.mode = LogMode::Async;
+    options.flushInterval = std::chrono::seconds(60);
+    Logger::getInstance().configure(options);
+
+    Logger::getInstance().log("buffered message");
+    CHAT_LOG_ERROR("Error writing something");
+    for (int i = 0; i < 500 && countLines(testLogFile) < 2; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(countLines(testLogFile), 2);
+}
+
+// 测试按级别过滤，以及级别未启用时不对消息表达式求值
+TEST_F(LoggerTest, LevelFiltering) {
+    int evaluated = 0;
+    auto message = [&evaluated](const std::string& text) {
+        ++evaluated;
+        return text;
+    };
+
+    CHAT_LOG_DEBUG(message("debug message"));
+    CHAT_LOG_INFO(message("info message"));
+    CHAT_LOG_WARN(message("warn message"));
+    EXPECT_EQ(evaluated, 2);
+    EXPECT_FALSE(Logger::getInstance().isEnabled(LogLevel::Debug));
+
+    Logger::getInstance().setLevel(LogLevel::Error);
+    CHAT_LOG_WARN(message("suppressed warning"));
+    CHAT_LOG_ERROR(message("error message"));
+    EXPECT_EQ(evaluated, 3);
+
+    Logger::getInstance().setLevel(LogLevel::Debug);
+    CHAT_LOG_DEBUG(message("second debug message"));
+    Logger::getInstance().setLevel(LogLevel::Off);
+    CHAT_LOG_ERROR(message("silenced error"));
+    EXPECT_EQ(evaluated, 4);
+
+    std::ifstream logFile(testLogFile);
+    std::vector<std::string> lines;
+    for (std::string line; std::getline(logFile, line);) {
+        lines.push_back(line);
+    }
+    ASSERT_EQ(lines.size(), 4u);
+    EXPECT_NE(lines[0].find("] [INFO] info message"), std::string::npos);
+    EXPECT_NE(lines[1].find("] [WARN] warn message"), std::string::npos);
+    EXPECT_NE(lines[2].find("] [ERROR] error message"), std::string::npos);
+    EXPECT_NE(lines[3].find("] [DEBUG] second debug message"), std::string::npos);
+}
+
+// 测试异步模式下切换日志文件，之前的记录写入原来的文件
+TEST_F(LoggerTest, AsyncLogFileSwitch) {
+    LoggerOptions options;
+    options.mode = LogMode::Async;
+    options.flushInterval = std::chrono::seconds(60);
+    Logger::getInstance().configure(options);
+
+    Logger::getInstance().log("First log file message");
+    std::string newLogFile = "new_test_log.txt";
+    Logger::getInstance().setLogFile(newLogFile);
+    Logger::getInstance().log("Second log file message");
+    // 切回同步模式时写完队列中的记录
+    Logger::getInstance().configure(LoggerOptions());
+
+    std::ifstream firstLogFile(testLogFile);
+    std::string line;
+    std::getline(firstLogFile, line);
+    EXPECT_NE(line.find("First log file message"), std::string::npos);
+    std::ifstream secondLogFile(newLogFile);
+    std::getline(secondLogFile, line);
+    EXPECT_NE(line.find("Second log file message"), std::string::npos);
+    EXPECT_EQ(countLines(newLogFile), 1);
+
+    std::remove(newLogFile.c_str());
+}
+
+// 测试按大小轮转并只保留最近的轮转文件
+TEST_F(LoggerTest, RotatesBySizeAndKeepsFiles) {
+    std::filesystem::remove_all(rotationDir);
+    std::filesystem::create_directories(rotationDir);
+    Logger::getInstance().setLogFile(rotationDir + "/chat.log");
+    LoggerOptions options;
+    options.rotateBytes = 1000;
+    options.keepFiles = 3;
+    Logger::getInstance().configure(options);
+    uint64_t rotationsBefore = Logger::getInstance().getStats().rotations;
+
+    const int numMessages = 200;
+    for (int i = 0; i < numMessages; ++i) {
+        Logger::getInstance().log("rotation message " + std::to_string(i));
+    }
+    EXPECT_GE(Logger::getInstance().getStats().rotations - rotationsBefore, 8u);
+    ASSERT_TRUE(waitForFiles(rotationDir, "chat.log", 3));
+
+    // 保留的文件加上当前文件恰好是最后若干条消息
+    std::vector<std::string> files = listFiles(rotationDir, "chat.log");
+    files.push_back(rotationDir + "/chat.log");
+    std::vector<int> numbers;
+    for (const auto& file : files) {
+        EXPECT_LE(std::filesystem::file_size(file), 1100u);
+        std::ifstream in(file);
+        for (std::string line; std::getline(in, line);) {
+            numbers.push_back(std::stoi(line.substr(line.rfind(' ') + 1)));
+        }
+    }
+    std::sort(numbers.begin(), numbers.end());
+    ASSERT_FALSE(numbers.empty());
+    EXPECT_EQ(numbers.back(), numMessages - 1);
+    EXPECT_EQ(numbers.back() - numbers.front() + 1, static_cast<int>(numbers.size()));
+
+    Logger::getInstance().setLogFile(testLogFile);
+    std::filesystem::remove_all(rotationDir);
+}
+
+// 测试异步模式下按时间轮转
+TEST_F(LoggerTest, RotatesByTime) {
+    std::filesystem::remove_all(rotationDir);
+    std::filesystem::create_directories(rotationDir);
+    Logger::getInstance().setLogFile(rotationDir + "/chat.log");
+    LoggerOptions options;
+    options.mode = LogMode::Async;
+    options.rotateInterval = std::chrono::seconds(1);
+    Logger::getInstance().configure(options);
+
+    Logger::getInstance().log("before rotation");
+    Logger::getInstance().flush();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+    Logger::getInstance().log("after rotation");
+    Logger::getInstance().flush();
+
+    std::vector<std::string> rotated = listFiles(rotationDir, "chat.log");
+    ASSERT_FALSE(rotated.empty());
+    EXPECT_GE(Logger::getInstance().getStats().rotations, 1u);
+    std::ifstream current(rotationDir + "/chat.log");
+    std::string line;
+    ASSERT_TRUE(std::getline(current, line));
+    EXPECT_NE(line.find("after rotation"), std::string::npos);
+    EXPECT_FALSE(std::getline(current, line));
+
+    Logger::getInstance().configure(LoggerOptions());
+    Logger::getInstance().setLogFile(testLogFile);
+    std::filesystem::remove_all(rotationDir);
+}
+
+#ifdef CHAT_HAVE_ZLIB
+// 测试轮转文件在后台压缩
+TEST_F(LoggerTest, CompressesRotatedFiles) {
+    std::filesystem::remove_all(rotationDir);
+    std::filesystem::create_directories(rotationDir);
+    Logger::getInstance().setLogFile(rotationDir + "/chat.log");
+    LoggerOptions options;
+    options.rotateBytes = 1;
+    options.compressRotated = true;
+    Logger::getInstance().configure(options);
+
+    Logger::getInstance().log("compressed message");
+    Logger::getInstance().log("current message");
+    ASSERT_TRUE(waitForFiles(rotationDir, "chat.log", 1, ".gz"));
+
+    std::vector<std::string> rotated = listFiles(rotationDir, "chat.log");
+    gzFile in = gzopen(rotated[0].c_str(), "rb");
+    ASSERT_NE(in, nullptr);
+    char buffer[256];
+    int size = gzread(in, buffer, sizeof(buffer));
+    gzclose(in);
+    ASSERT_GT(size, 0);
+    EXPECT_NE(std::string(buffer, static_cast<size_t>(size)).find("compressed message"), std::string::npos);
+
+    Logger::getInstance().setLogFile(testLogFile);
+    std::filesystem::remove_all(rotationDir);
+}
+#endif
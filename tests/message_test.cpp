@@ -1,5 +1,6 @@
 #include <gtest/gtest.h>
 #include "../src/common/message.hpp"
+#include "../src/common/wire_format.hpp"
 #include <chrono>
 #include <thread>
 
@@ -82,4 +83,114 @@ TEST_F(MessageTest, TimestampUpdate) {
     // 更新消息内容
     msg.setContent("Updated test");
     EXPECT_GT(msg.timestamp, initial_time);
-} 
\ No newline at end of file
+} 
+
+// 测试无异常解析接口
+TEST_F(MessageTest, ParseValid) {
+    Message msg("", "");
+    ParseError error = Message::parse("charlie @ Hello there | 2024-03-20 15:30:00", msg);
+    ASSERT_EQ(error, ParseError::None);
+    EXPECT_EQ(msg.username, "charlie");
+    EXPECT_EQ(msg.content, "Hello there");
+    EXPECT_EQ(msg.timestamp, Message::fromString("charlie @ Hello there | 2024-03-20 15:30:00").timestamp);
+}
+
+// 测试内容中包含 '@' 以及行尾 '\r' 的情况
+TEST_F(MessageTest, ParseContentWithAtSign) {
+    Message msg("", "");
+    ASSERT_EQ(Message::parse("dave @ mail me @ home | 2024-03-20 15:30:00\r", msg), ParseError::None);
+    EXPECT_EQ(msg.username, "dave");
+    EXPECT_EQ(msg.content, "mail me @ home");
+}
+
+// 测试各类错误码
+TEST_F(MessageTest, ParseErrors) {
+    Message msg("", "");
+    EXPECT_EQ(Message::parse("", msg), ParseError::MissingSeparator);
+    EXPECT_EQ(Message::parse("invalid format", msg), ParseError::MissingSeparator);
+    EXPECT_EQ(Message::parse("alice @ no bar", msg), ParseError::MissingSeparator);
+    EXPECT_EQ(Message::parse("  @ hi | 2024-03-20 15:30:00", msg), ParseError::EmptyUsername);
+    EXPECT_EQ(Message::parse("alice @   | 2024-03-20 15:30:00", msg), ParseError::EmptyContent);
+    EXPECT_EQ(Message::parse("alice @ hi |  ", msg), ParseError::EmptyTimestamp);
+    EXPECT_EQ(Message::parse("alice @ hi | 2024/03/20 15:30:00", msg), ParseError::InvalidTimestamp);
+    EXPECT_EQ(Message::parse("alice @ hi | 2024-13-20 15:30:00", msg), ParseError::InvalidTimestamp);
+    EXPECT_EQ(Message::parse("alice @ hi | 2024-03-20 15:30:00 junk", msg), ParseError::InvalidTimestamp);
+}
+
+// 测试跨小时的时间戳解析（小时缓存不应影响结果）
+TEST_F(MessageTest, ParseAcrossHours) {
+    Message first("", "");
+    Message second("", "");
+    ASSERT_EQ(Message::parse("a @ x | 2024-03-20 15:59:59", first), ParseError::None);
+    ASSERT_EQ(Message::parse("a @ x | 2024-03-20 16:00:00", second), ParseError::None);
+    EXPECT_EQ(second.timestamp - first.timestamp, 1);
+}
+
+// 测试二进制编码往返，内容可包含分隔符
+TEST_F(MessageTest, BinaryRoundTrip) {
+    Message msg("erin", "a @ b | c\nd");
+    msg.id = 300;
+    msg.room = "dev";
+    std::string frame = msg.toBinary();
+
+    Message decoded("", "");
+    ASSERT_EQ(Message::parseBinary(frame, decoded), ParseError::None);
+    EXPECT_EQ(decoded.username, "erin");
+    EXPECT_EQ(decoded.content, "a @ b | c\nd");
+    EXPECT_EQ(decoded.timestamp, msg.timestamp);
+    EXPECT_EQ(decoded.id, 300u);
+    EXPECT_EQ(decoded.room, "dev");
+    EXPECT_LT(frame.size(), msg.toString().size());
+}
+
+// 测试二进制帧的各类错误码
+TEST_F(MessageTest, ParseBinaryErrors) {
+    Message msg("erin", "hello");
+    std::string frame = msg.toBinary();
+    Message decoded("", "");
+
+    EXPECT_EQ(Message::parseBinary("", decoded), ParseError::Truncated);
+    for (size_t length = 1; length < frame.size(); ++length) {
+        EXPECT_EQ(Message::parseBinary(std::string_view(frame).substr(0, length), decoded),
+                  ParseError::Truncated) << "length " << length;
+    }
+    EXPECT_EQ(Message::parseBinary(frame + "x", decoded), ParseError::TrailingData);
+
+    std::string badVersion = frame;
+    badVersion[0] = static_cast<char>(kBinaryFormatVersion + 1);
+    EXPECT_EQ(Message::parseBinary(badVersion, decoded), ParseError::UnsupportedVersion);
+
+    EXPECT_EQ(Message::parseBinary(Message("", "x").toBinary(), decoded), ParseError::EmptyUsername);
+    EXPECT_EQ(Message::parseBinary(Message("x", "").toBinary(), decoded), ParseError::EmptyContent);
+}
+
+// 测试变长整数和 ZigZag 编码
+TEST_F(MessageTest, Varint) {
+    for (uint64_t value : {0ull, 1ull, 127ull, 128ull, 16383ull, 16384ull, ~0ull}) {
+        std::string buffer;
+        appendVarint(buffer, value);
+        std::string_view in(buffer);
+        uint64_t decoded = 0;
+        ASSERT_TRUE(readVarint(in, decoded));
+        EXPECT_EQ(decoded, value);
+        EXPECT_TRUE(in.empty());
+    }
+    for (int64_t value : {0ll, -1ll, 1ll, -1000ll, 1744768800000ll}) {
+        EXPECT_EQ(zigzagDecode(zigzagEncode(value)), value);
+    }
+    EXPECT_EQ(zigzagEncode(-1), 1u);
+
+    std::string_view overlong("\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\x01");
+    uint64_t value = 0;
+    EXPECT_FALSE(readVarint(overlong, value));
+}
+
+// 测试房间名校验
+TEST_F(MessageTest, RoomName) {
+    EXPECT_TRUE(isValidRoomName(kDefaultRoom));
+    EXPECT_TRUE(isValidRoomName("dev-ops_2"));
+    EXPECT_FALSE(isValidRoomName(""));
+    EXPECT_FALSE(isValidRoomName("two words"));
+    EXPECT_FALSE(isValidRoomName("tab\there"));
+    EXPECT_FALSE(isValidRoomName(std::string(kMaxRoomNameLength + 1, 'r')));
+}
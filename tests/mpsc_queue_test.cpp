@@ -0,0 +1,78 @@
+#include <gtest/gtest.h>
+#include "../src/common/mpsc_queue.hpp"
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace chat;
+
+// 测试容量取整和先进先出顺序
+TEST(MpscQueueTest, FifoAndCapacity) {
+    MpscQueue<int> queue(5);
+    EXPECT_EQ(queue.capacity(), 8u);
+
+    for (int i = 0; i < 8; ++i) {
+        EXPECT_TRUE(queue.tryPush(i));
+    }
+    EXPECT_FALSE(queue.tryPush(8));
+    EXPECT_EQ(queue.sizeApprox(), 8u);
+
+    int value = -1;
+    for (int i = 0; i < 8; ++i) {
+        ASSERT_TRUE(queue.tryPop(value));
+        EXPECT_EQ(value, i);
+    }
+    EXPECT_FALSE(queue.tryPop(value));
+}
+
+// 测试队列满时入队失败不会移走元素，析构时释放剩余元素
+TEST(MpscQueueTest, FullQueueKeepsItem) {
+    auto queue = std::make_unique<MpscQueue<std::string>>(2);
+    EXPECT_TRUE(queue->tryPush(std::string("a")));
+    EXPECT_TRUE(queue->tryPush(std::string("b")));
+
+    std::string item = "kept";
+    EXPECT_FALSE(queue->tryPush(std::move(item)));
+    EXPECT_EQ(item, "kept");
+
+    // 剩余的 std::string 由析构函数销毁（AddressSanitizer 会检查泄漏）
+    queue.reset();
+}
+
+// 测试多个生产者并发入队
+TEST(MpscQueueTest, MultipleProducers) {
+    constexpr int kProducers = 4;
+    constexpr int kPerProducer = 20000;
+    MpscQueue<int> queue(1024);
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < kProducers; ++p) {
+        producers.emplace_back([&queue, p]() {
+            for (int i = 0; i < kPerProducer; ++i) {
+                while (!queue.tryPush(p * kPerProducer + i)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    // 每个生产者的元素应按其入队顺序出队
+    std::vector<int> lastSeen(kProducers, -1);
+    int received = 0;
+    int value;
+    while (received < kProducers * kPerProducer) {
+        if (!queue.tryPop(value)) {
+            std::this_thread::yield();
+            continue;
+        }
+        int producer = value / kPerProducer;
+        EXPECT_GT(value, lastSeen[producer]);
+        lastSeen[producer] = value;
+        ++received;
+    }
+    for (auto& thread : producers) {
+        thread.join();
+    }
+    EXPECT_FALSE(queue.tryPop(value));
+}
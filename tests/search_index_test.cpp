@@ -0,0 +1,297 @@
+#include <gtest/gtest.h>
+#include "../src/server/history_query.hpp"
+#include "../src/server/search_index.hpp"
+#include <filesystem>
+#include <fstream>
+#include <memory>
+
+using namespace chat;
+
+class SearchIndexTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        testHistoryDir = "test_search_index";
+        indexDir = testHistoryDir + "/search";
+        std::filesystem::remove_all(testHistoryDir);
+        log = std::make_unique<HistoryLog>(testHistoryDir);
+    }
+
+    void TearDown() override {
+        log.reset();
+        std::filesystem::remove_all(testHistoryDir);
+    }
+
+    // 写入日志并加入索引
+    void persist(SearchIndex* index, const std::string& room, const std::string& content) {
+        Message msg("user", content);
+        msg.room = room;
+        uint64_t sequence = log->append(msg);
+        log->flush();
+        if (index) {
+            index->add(sequence, msg);
+        }
+    }
+
+    // 以查询字符串检索，返回匹配的序号（从新到旧）
+    static std::vector<uint64_t> find(const SearchIndex& index, const std::string& room, const std::string& text,
+                                      size_t limit = 100) {
+        SearchQuery query;
+        EXPECT_TRUE(parseSearchQuery("/search " + room + " " + text, query)) << text;
+        return index.search(room, query.phrases, HistoryStore::kLatest, limit);
+    }
+
+    // 索引目录中的段文件
+    std::vector<std::filesystem::path> segmentFiles() const {
+        std::vector<std::filesystem::path> files;
+        for (const auto& entry : std::filesystem::directory_iterator(indexDir)) {
+            if (entry.path().extension() == ".sidx") {
+                files.push_back(entry.path());
+            }
+        }
+        std::sort(files.begin(), files.end());
+        return files;
+    }
+
+    std::string testHistoryDir;
+    std::string indexDir;
+    std::unique_ptr<HistoryLog> log;
+};
+
+// 测试 UTF-8 分词：英文转小写，汉字逐字成词，标点和非法字节分隔
+TEST_F(SearchIndexTest, Tokenizes) {
+    EXPECT_EQ(tokenizeText("Hello, World! C++17"),
+              (std::vector<std::string>{"hello", "world", "c", "17"}));
+    EXPECT_EQ(tokenizeText("你好，世界"), (std::vector<std::string>{"你", "好", "世", "界"}));
+    EXPECT_EQ(tokenizeText("build失败了"), (std::vector<std::string>{"build", "失", "败", "了"}));
+    EXPECT_EQ(tokenizeText("café naïve"), (std::vector<std::string>{"café", "naïve"}));
+    EXPECT_EQ(tokenizeText("ab\xff\xfe" "cd"), (std::vector<std::string>{"ab", "cd"}));
+    EXPECT_TRUE(tokenizeText(std::string(kMaxTokenBytes + 1, 'x')).empty());
+    EXPECT_TRUE(tokenizeText(" ... ").empty());
+}
+
+// 测试 AND 与短语查询，查询限定在房间内
+TEST_F(SearchIndexTest, AndAndPhraseQueries) {
+    SearchIndex index(indexDir, *log);
+    persist(&index, "dev", "the build is broken again");       // 0
+    persist(&index, "dev", "broken build on the CI server");   // 1
+    persist(&index, "lobby", "the build is broken");           // 2
+    persist(&index, "dev", "今天服务器又挂了");                 // 3
+    persist(&index, "dev", "服务还在，器材坏了");               // 4
+
+    EXPECT_EQ(find(index, "dev", "build broken"), (std::vector<uint64_t>{1, 0}));
+    EXPECT_EQ(find(index, "dev", "\"build is broken\""), (std::vector<uint64_t>{0}));
+    EXPECT_EQ(find(index, "dev", "\"broken build\" ci"), (std::vector<uint64_t>{1}));
+    EXPECT_EQ(find(index, "lobby", "BUILD"), (std::vector<uint64_t>{2}));
+    EXPECT_TRUE(find(index, "dev", "build missing").empty());
+    // 不加引号的汉字串按短语匹配
+    EXPECT_EQ(find(index, "dev", "服务器"), (std::vector<uint64_t>{3}));
+    EXPECT_EQ(find(index, "dev", "服务 器"), (std::vector<uint64_t>{4, 3}));
+    EXPECT_EQ(find(index, "dev", "build", 1), (std::vector<uint64_t>{1}));
+
+    SearchQuery query;
+    EXPECT_FALSE(parseSearchQuery("/search dev", query));
+    EXPECT_FALSE(parseSearchQuery("/search dev 10 ...", query));
+    EXPECT_FALSE(parseSearchQuery("/search dev next x5 build", query));
+    ASSERT_TRUE(parseSearchQuery("/search dev 5 next b42 \"a b\" c", query));
+    EXPECT_EQ(query.limit, 5u);
+    EXPECT_EQ(query.before, 42u);
+    ASSERT_EQ(query.phrases.size(), 2u);
+    EXPECT_EQ(query.phrases[0], (std::vector<std::string>{"a", "b"}));
+    ASSERT_TRUE(parseSearchQuery("/search dev \"2024\" plans", query));
+    EXPECT_EQ(query.limit, kDefaultSearchLimit);
+    EXPECT_EQ(query.phrases.size(), 2u);
+}
+
+// 测试写段、合并和重新打开后从磁盘段查询，以游标翻页
+TEST_F(SearchIndexTest, PersistsMergesAndPages) {
+    SearchIndexOptions options;
+    options.memoryBytes = 2048;
+    {
+        SearchIndex index(indexDir, *log, options);
+        for (int i = 0; i < 1000; ++i) {
+            persist(&index, i % 2 ? "dev" : "lobby",
+                    "message " + std::to_string(i) + (i % 10 == 0 ? " needle in haystack" : " hay"));
+        }
+        // 写段在后台进行，尚未写出的冻结表同样可查
+        EXPECT_EQ(find(index, "lobby", "needle").size(), 100u);
+        EXPECT_TRUE(index.flush());
+        SearchIndexStats stats = index.getStats();
+        EXPECT_GT(stats.merges, 0u);
+        EXPECT_LT(stats.segments, 12u);
+        EXPECT_EQ(stats.indexedSequence, 1000u);
+        EXPECT_EQ(stats.memoryTerms, 0u);
+        EXPECT_EQ(segmentFiles().size(), stats.segments);
+    }
+
+    SearchIndex index(indexDir, *log, options);
+    EXPECT_EQ(index.getStats().indexedSequence, 1000u);
+    EXPECT_EQ(find(index, "lobby", "needle").size(), 100u);
+    EXPECT_EQ(find(index, "lobby", "\"needle in\" 500"), (std::vector<uint64_t>{500}));
+    EXPECT_TRUE(find(index, "dev", "needle").empty());
+
+    SearchQuery query;
+    ASSERT_TRUE(parseSearchQuery("/search lobby 30 \"in haystack\"", query));
+    std::vector<uint64_t> all;
+    size_t pages = 0;
+    for (;;) {
+        HistoryQueryResult result = executeSearchQuery(index, *log, query);
+        ++pages;
+        for (auto it = result.entries.rbegin(); it != result.entries.rend(); ++it) {
+            EXPECT_EQ(it->message.room, "lobby");
+            all.push_back(it->sequence);
+        }
+        if (result.cursor.empty()) {
+            break;
+        }
+        ASSERT_TRUE(parseSearchQuery("/search lobby 30 next " + result.cursor + " \"in haystack\"", query));
+    }
+    EXPECT_EQ(pages, 4u);
+    ASSERT_EQ(all.size(), 100u);
+    for (size_t i = 0; i < all.size(); ++i) {
+        ASSERT_EQ(all[i], 990 - i * 10);
+    }
+}
+
+// 测试从日志补齐未索引的消息，补齐期间的新消息排在其后
+TEST_F(SearchIndexTest, CatchesUpFromLog) {
+    {
+        SearchIndex index(indexDir, *log);
+        for (int i = 0; i < 100; ++i) {
+            persist(&index, "dev", "indexed " + std::to_string(i));
+        }
+        ASSERT_TRUE(index.flush());
+        // 写段之后的消息只在日志中
+        for (int i = 0; i < 50; ++i) {
+            persist(&index, "dev", "unflushed " + std::to_string(i));
+        }
+    }
+    for (int i = 0; i < 20; ++i) {
+        persist(nullptr, "dev", "offline " + std::to_string(i));
+    }
+
+    SearchIndex index(indexDir, *log);
+    EXPECT_EQ(index.getStats().indexedSequence, 100u);
+    index.startCatchUp();
+    persist(&index, "dev", "live unflushed offline indexed");
+    ASSERT_TRUE(index.waitUntilReady(std::chrono::seconds(30)));
+    EXPECT_EQ(index.getStats().indexedSequence, 171u);
+    EXPECT_EQ(find(index, "dev", "unflushed").size(), 51u);
+    EXPECT_EQ(find(index, "dev", "offline").size(), 21u);
+    EXPECT_EQ(find(index, "dev", "live"), (std::vector<uint64_t>{170}));
+}
+
+// 测试损坏的段以及超前于日志的段被删除并重新补齐
+TEST_F(SearchIndexTest, DropsBadSegments) {
+    SearchIndexOptions options;
+    options.memoryBytes = 1024;
+    {
+        SearchIndex index(indexDir, *log, options);
+        // 写段在后台进行，定期 flush 使段的划分不依赖后台线程的进度
+        for (int i = 0; i < 300; ++i) {
+            persist(&index, "dev", "word" + std::to_string(i % 7) + " common");
+            if (i % 50 == 49) {
+                index.flush();
+            }
+        }
+        index.flush();
+    }
+    std::vector<std::filesystem::path> files = segmentFiles();
+    ASSERT_GE(files.size(), 2u);
+    {
+        // 破坏最后一段中间的一个字节
+        std::fstream file(files.back(), std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(static_cast<std::streamoff>(std::filesystem::file_size(files.back()) / 2));
+        file.put('\x7f');
+    }
+
+    {
+        SearchIndex index(indexDir, *log, options);
+        EXPECT_EQ(segmentFiles().size(), files.size() - 1);
+        EXPECT_LT(index.getStats().indexedSequence, 300u);
+        index.startCatchUp();
+        ASSERT_TRUE(index.waitUntilReady(std::chrono::seconds(30)));
+        EXPECT_EQ(find(index, "dev", "common").size(), 100u);
+        EXPECT_EQ(find(index, "dev", "common", 1000).size(), 300u);
+        index.flush();
+    }
+
+    // 日志丢失尾部后，覆盖到日志之外的段被丢弃
+    std::string shortDir = testHistoryDir + "_short";
+    std::filesystem::remove_all(shortDir);
+    {
+        HistoryLog shortLog(shortDir);
+        Message msg("user", "common");
+        msg.room = "dev";
+        shortLog.append(msg);
+        shortLog.flush();
+        SearchIndex index(indexDir, shortLog, options);
+        EXPECT_EQ(index.getStats().segments, 0u);
+        index.startCatchUp();
+        ASSERT_TRUE(index.waitUntilReady(std::chrono::seconds(30)));
+        EXPECT_EQ(find(index, "dev", "common"), (std::vector<uint64_t>{0}));
+    }
+    std::filesystem::remove_all(shortDir);
+}
+
+// 测试用户索引：房间内与跨房间查询、游标翻页、写段后重新打开
+TEST_F(SearchIndexTest, IndexesUsers) {
+    SearchIndexOptions options;
+    options.memoryBytes = 1024;
+    options.keys = userIndexKeys;
+    std::string usersDir = testHistoryDir + "/users";
+    auto write = [this](SearchIndex& index, const std::string& user, const std::string& room) {
+        Message msg(user, "hello");
+        msg.room = room;
+        uint64_t sequence = log->append(msg);
+        log->flush();
+        index.add(sequence, msg);
+    };
+    {
+        SearchIndex index(usersDir, *log, options);
+        for (int i = 0; i < 600; ++i) {
+            write(index, i % 3 == 0 ? "alice" : "bob", i % 2 ? "dev" : "lobby");
+            if (i % 100 == 99) {
+                index.flush();
+            }
+        }
+        // 用户名不会被当作检索词切分
+        write(index, "Carol.Smith", "dev");
+        index.flush();
+        EXPECT_GT(index.getStats().segments, 1u);
+    }
+
+    SearchIndex index(usersDir, *log, options);
+    EXPECT_EQ(index.lookup(userIndexKey("", "alice"), HistoryStore::kLatest, 1000).size(), 200u);
+    EXPECT_EQ(index.lookup(userIndexKey("dev", "alice"), HistoryStore::kLatest, 1000).size(), 100u);
+    EXPECT_EQ(index.lookup(userIndexKey("dev", "Carol.Smith"), HistoryStore::kLatest, 10),
+              (std::vector<uint64_t>{600}));
+    EXPECT_TRUE(index.lookup(userIndexKey("dev", "carol"), HistoryStore::kLatest, 10).empty());
+    EXPECT_EQ(index.lookup(userIndexKey("lobby", "bob"), 10, 3), (std::vector<uint64_t>{8, 4, 2}));
+
+    UserQuery query;
+    EXPECT_FALSE(parseUserQuery("/from dev", query));
+    EXPECT_FALSE(parseUserQuery("/from dev alice 0", query));
+    EXPECT_FALSE(parseUserQuery("/from dev alice next f1-2", query));
+    ASSERT_TRUE(parseUserQuery("/from dev alice 40", query));
+    std::vector<uint64_t> all;
+    size_t pages = 0;
+    for (;;) {
+        HistoryQueryResult result = executeUserQuery(index, *log, query);
+        ++pages;
+        for (auto it = result.entries.rbegin(); it != result.entries.rend(); ++it) {
+            EXPECT_EQ(it->message.username, "alice");
+            EXPECT_EQ(it->message.room, "dev");
+            all.push_back(it->sequence);
+        }
+        if (result.cursor.empty()) {
+            break;
+        }
+        ASSERT_TRUE(parseUserQuery("/from dev alice 40 next " + result.cursor, query));
+    }
+    EXPECT_EQ(pages, 3u);
+    ASSERT_EQ(all.size(), 100u);
+    for (size_t i = 0; i < all.size(); ++i) {
+        ASSERT_EQ(all[i], 597 - i * 6);
+    }
+    EXPECT_EQ(makeUserEndMessage(query, {}).content, "/from-end dev 0");
+}
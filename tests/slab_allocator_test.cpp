@@ -0,0 +1,62 @@
+#include <gtest/gtest.h>
+#include "../src/common/slab_allocator.hpp"
+#include <deque>
+#include <string>
+#include <vector>
+
+using namespace chat;
+
+// 测试规格取整、槽位复用和大对象
+TEST(SlabAllocatorTest, SizeClassesAndReuse) {
+    EXPECT_EQ(SlabPool::slotSize(1), 16u);
+    EXPECT_EQ(SlabPool::slotSize(16), 16u);
+    EXPECT_EQ(SlabPool::slotSize(17), 32u);
+    EXPECT_EQ(SlabPool::slotSize(4096), 4096u);
+    EXPECT_EQ(SlabPool::slotSize(5000), 5000u);
+
+    SlabPool pool(4096);
+    void* a = pool.allocate(20);
+    void* b = pool.allocate(30);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(a) % 16, 0u);
+    EXPECT_EQ(static_cast<char*>(b) - static_cast<char*>(a), 32);
+    EXPECT_EQ(pool.getStats().chunks, 1u);
+    EXPECT_EQ(pool.getStats().usedBytes, 64u);
+
+    // 释放的槽位优先被再次分配
+    pool.deallocate(a, 20);
+    EXPECT_EQ(pool.allocate(32), a);
+
+    void* large = pool.allocate(10000);
+    EXPECT_EQ(pool.getStats().largeBytes, 10000u);
+    pool.deallocate(large, 10000);
+    pool.deallocate(a, 32);
+    pool.deallocate(b, 30);
+
+    SlabStats stats = pool.getStats();
+    EXPECT_EQ(stats.usedBytes, 0u);
+    EXPECT_EQ(stats.largeBytes, 0u);
+    EXPECT_EQ(stats.allocations, 4u);
+    EXPECT_EQ(stats.systemAllocations, 2u);
+}
+
+// 测试先进先出的消息队列在用量稳定后不再向系统申请内存
+TEST(SlabAllocatorTest, SteadyStateQueue) {
+    SlabPool pool;
+    std::deque<SlabString> queue;
+    auto push = [&pool, &queue](int i) {
+        queue.emplace_back("message payload that does not fit in SSO #" + std::to_string(i),
+                           SlabAllocator<char>(&pool));
+    };
+    for (int i = 0; i < 1000; ++i) {
+        push(i);
+    }
+    uint64_t warm = pool.getStats().systemAllocations;
+    for (int i = 1000; i < 100000; ++i) {
+        queue.pop_front();
+        push(i);
+    }
+    EXPECT_EQ(pool.getStats().systemAllocations, warm);
+    EXPECT_EQ(queue.front(), "message payload that does not fit in SSO #99000");
+    queue.clear();
+    EXPECT_EQ(pool.getStats().usedBytes, 0u);
+}
@@ -0,0 +1,65 @@
+#include <gtest/gtest.h>
+#include "../src/common/symbol_table.hpp"
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace chat;
+
+// 测试编号从 0 起连续分配，同一字符串得到同一编号
+TEST(SymbolTableTest, InternsStableIds) {
+    SymbolTable table;
+    EXPECT_EQ(table.find("alice"), SymbolTable::kInvalid);
+    EXPECT_EQ(table.intern("alice"), 0u);
+    EXPECT_EQ(table.intern("bob"), 1u);
+    EXPECT_EQ(table.intern(std::string("alice")), 0u);
+    EXPECT_EQ(table.intern(""), 2u);
+    EXPECT_EQ(table.find("bob"), 1u);
+    EXPECT_EQ(table.size(), 3u);
+    EXPECT_EQ(table.name(0), "alice");
+    EXPECT_EQ(table.name(2), "");
+    EXPECT_TRUE(table.name(3).empty());
+
+    // 跨越多个块后已返回的 string_view 仍然有效
+    std::string_view first = table.name(0);
+    for (int i = 0; i < 10000; ++i) {
+        uint32_t id = table.intern("user" + std::to_string(i));
+        ASSERT_EQ(id, static_cast<uint32_t>(i + 3));
+    }
+    EXPECT_EQ(first, "alice");
+    EXPECT_EQ(first.data(), table.name(0).data());
+    for (int i = 0; i < 10000; ++i) {
+        ASSERT_EQ(table.name(static_cast<uint32_t>(i + 3)), "user" + std::to_string(i));
+    }
+    EXPECT_GT(table.memoryBytes(), 10000u * 5);
+}
+
+// 测试并发驻留和不加锁的读取
+TEST(SymbolTableTest, ConcurrentInternAndRead) {
+    constexpr int kThreads = 4;
+    constexpr int kNames = 5000;
+    SymbolTable table;
+    std::vector<std::vector<uint32_t>> ids(kThreads, std::vector<uint32_t>(kNames));
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&table, &ids, t]() {
+            for (int i = 0; i < kNames; ++i) {
+                // 各线程以不同顺序驻留同一组名字
+                int n = t % 2 ? kNames - 1 - i : i;
+                std::string name = "name" + std::to_string(n);
+                uint32_t id = table.intern(name);
+                ids[t][n] = id;
+                ASSERT_EQ(table.name(id), name);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(table.size(), static_cast<size_t>(kNames));
+    for (int t = 1; t < kThreads; ++t) {
+        EXPECT_EQ(ids[t], ids[0]);
+    }
+}
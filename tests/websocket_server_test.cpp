@@ -235,4 +235,186 @@ TEST_F(WebSocketServerTest, ServerStartFailure) {
     if (serverThread2.joinable()) {
         serverThread2.join();
     }
-} 
\ No newline at end of file
+} 
+
+// 测试广播只分帧一次，各连接共享同一缓冲区
+TEST_F(WebSocketServerTest, BroadcastSharesFrame) {
+    server->start();
+    EXPECT_TRUE(waitForServerStart());
+
+    std::string uri = "ws://localhost:" + std::to_string(testPort);
+    auto sender = std::make_unique<ChatClient>("sender");
+    auto receiver = std::make_unique<ChatClient>("receiver");
+    sender->connect(uri);
+    receiver->connect(uri);
+
+    // 等待连接建立
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    ASSERT_TRUE(sender->isConnected());
+    ASSERT_TRUE(receiver->isConnected());
+
+    sender->send("shared frame");
+    EXPECT_TRUE(waitForMessage());
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    // 两个客户端都协商了二进制格式：一次分帧，两次共享发送，没有逐连接拷贝
+    BroadcastStats stats = server->getBroadcastStats();
+    EXPECT_EQ(stats.framesBuilt, 1u);
+    EXPECT_EQ(stats.sharedSends, 2u);
+    EXPECT_EQ(stats.payloadCopies, 0u);
+
+    sender->disconnect();
+    receiver->disconnect();
+    server->stop();
+}
+
+// 测试分片监听模式下跨分片广播
+TEST_F(WebSocketServerTest, ShardedListenersBroadcast) {
+    server = std::make_unique<ChatServer>(testPort, 4, 4);
+    server->start();
+    EXPECT_TRUE(waitForServerStart());
+
+    std::string uri = "ws://localhost:" + std::to_string(testPort);
+    std::atomic<int> delivered{0};
+    std::vector<std::unique_ptr<ChatClient>> clients;
+    for (int i = 0; i < 16; ++i) {
+        auto client = std::make_unique<ChatClient>("user" + std::to_string(i));
+        client->setMessageCallback([&delivered](const Message&) { delivered++; });
+        client->connect(uri);
+        clients.push_back(std::move(client));
+    }
+
+    // 等待连接建立
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    clients[0]->send("across shards");
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+
+    // 内核会把连接分配到不同分片，每个客户端都应收到广播
+    EXPECT_EQ(delivered.load(), 16);
+
+    for (auto& client : clients) {
+        client->disconnect();
+    }
+    server->stop();
+}
+
+// 测试房间广播只发往房间订阅者
+TEST_F(WebSocketServerTest, RoomBroadcast) {
+    server->start();
+    EXPECT_TRUE(waitForServerStart());
+
+    std::string uri = "ws://localhost:" + std::to_string(testPort);
+    std::atomic<int> devReceived{0};
+    std::atomic<int> lobbyReceived{0};
+    auto alice = std::make_unique<ChatClient>("alice");
+    auto bob = std::make_unique<ChatClient>("bob");
+    auto carol = std::make_unique<ChatClient>("carol");
+    bob->setMessageCallback([&devReceived](const Message& msg) {
+        if (msg.room == "dev") devReceived++;
+    });
+    carol->setMessageCallback([&lobbyReceived](const Message&) { lobbyReceived++; });
+    alice->connect(uri);
+    bob->connect(uri);
+    carol->connect(uri);
+
+    // 等待连接建立
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    EXPECT_EQ(server->getRoomSize(kDefaultRoom), 3u);
+
+    alice->send("/join dev");
+    bob->send("/join dev");
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    EXPECT_EQ(server->getRoomSize("dev"), 2u);
+
+    // 消息发往 alice 的当前房间 dev，carol 不应收到
+    alice->send("dev only");
+    EXPECT_TRUE(waitForMessage());
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    EXPECT_EQ(devReceived.load(), 1);
+    EXPECT_EQ(lobbyReceived.load(), 0);
+    {
+        std::lock_guard<std::mutex> lock(messageMutex);
+        ASSERT_FALSE(receivedMessages.empty());
+        EXPECT_EQ(receivedMessages[0].room, "dev");
+    }
+
+    alice->send("/leave dev");
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    EXPECT_EQ(server->getRoomSize("dev"), 1u);
+
+    alice->disconnect();
+    bob->disconnect();
+    carol->disconnect();
+    server->stop();
+}
+
+// 测试超过水位的连接被丢弃消息并断开
+TEST_F(WebSocketServerTest, SlowConsumerEviction) {
+    BackpressureOptions options;
+    options.highWatermark = 0;   // 任何积压都视为拥塞
+    options.lowWatermark = 0;
+    options.evictAfter = std::chrono::milliseconds(0);
+    server->setBackpressureOptions(options);
+    server->start();
+    EXPECT_TRUE(waitForServerStart());
+
+    std::string uri = "ws://localhost:" + std::to_string(testPort);
+    auto client = std::make_unique<ChatClient>("slow");
+    client->connect(uri);
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    EXPECT_EQ(server->getOutboundStats().connections, 1u);
+
+    client->send("will be dropped");
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+
+    OutboundStats stats = server->getOutboundStats();
+    EXPECT_GE(stats.droppedMessages, 1u);
+    EXPECT_EQ(stats.evictedConnections, 1u);
+    EXPECT_FALSE(client->isConnected());
+
+    server->stop();
+}
+
+// 测试耗时的查询在查询线程中执行，不阻塞 I/O 线程
+TEST_F(WebSocketServerTest, QueryDoesNotBlockIoThread) {
+    std::mutex releaseMutex;
+    std::condition_variable releaseCondition;
+    bool released = false;
+    std::atomic<bool> queryStarted{false};
+    server->setHistoryHandler([&](const HistoryQuery&) {
+        queryStarted = true;
+        std::unique_lock<std::mutex> lock(releaseMutex);
+        releaseCondition.wait(lock, [&released] { return released; });
+        return HistoryQueryResult{};
+    });
+    server->start();
+    EXPECT_TRUE(waitForServerStart());
+
+    std::string uri = "ws://localhost:" + std::to_string(testPort);
+    std::atomic<int> endMarkers{0};
+    auto client = std::make_unique<ChatClient>("alice");
+    client->setMessageCallback([&endMarkers](const Message& msg) {
+        if (msg.content.compare(0, kHistoryEndMarker.size(), kHistoryEndMarker) == 0) endMarkers++;
+    });
+    client->connect(uri);
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+
+    client->send("/history " + std::string(kDefaultRoom));
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    EXPECT_TRUE(queryStarted.load());
+
+    // 查询尚未完成时，唯一的 I/O 线程仍能处理普通消息
+    client->send("still responsive");
+    bool responsive = waitForMessage();
+    {
+        std::lock_guard<std::mutex> lock(releaseMutex);
+        released = true;
+    }
+    releaseCondition.notify_all();
+    EXPECT_TRUE(responsive);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    EXPECT_EQ(endMarkers.load(), 1);
+
+    client->disconnect();
+    server->stop();
+}